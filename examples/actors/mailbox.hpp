@@ -0,0 +1,107 @@
+#pragma once
+#include "../slab/slaballocators.hpp"
+#include "../typelist/typelist.hpp"
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/*
+    The mailbox of an actor: an intrusive multi-producer single-consumer queue in the style of Dmitry
+    Vyukov's, with the message stored inline in its node. A send is one allocation from the sending
+    thread's slab cache (no lock, no malloc), the message constructed in place, and one exchange on
+    the head of the list: senders never wait for each other nor for the receiver, whatever their
+    number. The receiver pops from the tail with loads and stores only.
+    The list always holds at least one link, so that head and tail never both need updating: the stub,
+    a link without a message, is pushed back whenever the last node is about to be popped.
+    Between the exchange and the link from the previous node, a push is half done: pop() then sees
+    nothing yet, even though the message has been counted by its sender, and the caller tries again
+    later.
+*/
+struct MailboxLink
+{
+  std::atomic<MailboxLink*> next{nullptr};
+};
+
+template <typename Message>
+struct MailboxNode : MailboxLink
+{
+  Message message;
+
+  template <typename... Args>
+  explicit MailboxNode(Args&&... args)
+    : message(std::forward<Args>(args)...)
+  { }
+};
+
+template <typename Message>
+class Mailbox
+{
+  using Node = MailboxNode<Message>;
+  using Slabs = SlabAllocators<TypeList<Node>>;
+
+  std::atomic<MailboxLink*> head; // the last link pushed, by the senders
+  alignas(64) MailboxLink* tail;  // the next link to pop, by the receiver
+  MailboxLink stub;
+
+  void push(MailboxLink* link) noexcept
+  {
+    link->next.store(nullptr, std::memory_order_relaxed);
+    MailboxLink* previous = head.exchange(link, std::memory_order_acq_rel);
+    previous->next.store(link, std::memory_order_release);
+  }
+
+  public:
+  using Box = typename Slabs::template Box<0>;
+
+  Mailbox()
+    : head(&stub)
+    , tail(&stub)
+  { }
+
+  Mailbox(Mailbox const&) = delete;
+  Mailbox& operator=(Mailbox const&) = delete;
+
+  ~Mailbox()
+  {
+    while(Box message = pop())
+    { }
+  }
+
+  // from any thread
+  template <typename... Args>
+  void send(Args&&... args)
+  {
+    push(Slabs::template make<0>(std::forward<Args>(args)...).release());
+  }
+
+  // by the receiver only: the oldest message, or an empty box if there is none yet
+  Box pop() noexcept
+  {
+    MailboxLink* first = tail;
+    MailboxLink* next = first->next.load(std::memory_order_acquire);
+    if(first == &stub)
+    {
+      if(next == nullptr)
+      {
+        return Box();
+      }
+      tail = first = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if(next == nullptr)
+    {
+      if(first != head.load(std::memory_order_acquire))
+      {
+        return Box(); // a push is half done
+      }
+      push(&stub);
+      next = first->next.load(std::memory_order_acquire);
+      if(next == nullptr)
+      {
+        return Box();
+      }
+    }
+    tail = next;
+    return Box(static_cast<Node*>(first));
+  }
+};
@@ -0,0 +1,280 @@
+#include "../bench/bench.hpp"
+#include "../variant/variant.hpp"
+#include "runtime.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+/*
+    Thousands of actors on a few workers. Ping-pong: pairs of players return a ball until its count
+    runs out, one message in flight per pair, so every message is an activation. Fan-out: a source
+    deals work to a thousand sinks, which then get their messages in batches. Before that, priorities
+    (one worker, a low priority actor flooded, then a high priority one called) and the counters per
+    message type.
+*/
+
+// counts down from the number of actors expected to finish; wait() returns when all have
+class Completion
+{
+  std::atomic<unsigned> left;
+
+  public:
+  explicit Completion(unsigned n)
+    : left(n)
+  { }
+
+  void done()
+  {
+    if(left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      left.notify_all();
+    }
+  }
+
+  void wait()
+  {
+    unsigned n;
+    while((n = left.load(std::memory_order_acquire)) != 0)
+    {
+      left.wait(n, std::memory_order_acquire);
+    }
+  }
+};
+
+struct Ball
+{
+  std::uint32_t left;
+};
+
+struct Serve
+{
+  std::uint32_t rounds;
+};
+
+class Player : public Actor<Player, Variant<Serve, Ball>>
+{
+  Completion& completion;
+
+  public:
+  Player* partner = nullptr;
+
+  explicit Player(Completion& completion)
+    : completion(completion)
+  { }
+
+  void handle(Serve const& serve)
+  {
+    partner->send(Ball{serve.rounds});
+  }
+
+  void handle(Ball const& ball)
+  {
+    if(ball.left == 0)
+    {
+      completion.done();
+    }
+    else
+    {
+      partner->send(Ball{ball.left - 1});
+    }
+  }
+};
+
+struct Work
+{
+  std::uint64_t value;
+};
+
+struct Flush
+{ };
+
+class Sink : public Actor<Sink, Variant<Work, Flush>>
+{
+  Completion& completion;
+
+  public:
+  std::uint64_t sum = 0;
+
+  explicit Sink(Completion& completion)
+    : completion(completion)
+  { }
+
+  void handle(Work const& work)
+  {
+    sum += work.value;
+  }
+
+  void handle(Flush const&)
+  {
+    completion.done();
+  }
+};
+
+struct Deal
+{
+  std::uint64_t messages;
+};
+
+class Source : public Actor<Source, Variant<Deal>>
+{
+  std::vector<Sink*> const& sinks;
+
+  public:
+  explicit Source(std::vector<Sink*> const& sinks)
+    : sinks(sinks)
+  { }
+
+  void handle(Deal const& deal)
+  {
+    for(std::uint64_t i = 0; i < deal.messages; ++i)
+    {
+      sinks[i % sinks.size()]->send(Work{i});
+    }
+    for(Sink* sink : sinks)
+    {
+      sink->send(Flush{});
+    }
+  }
+};
+
+class Alarm : public Actor<Alarm, Variant<Flush>>
+{
+  Sink const& low;
+  Completion& completion;
+
+  public:
+  std::uint64_t low_before = 0; // the messages the low priority sink had handled when this ran
+
+  Alarm(Sink const& low, Completion& completion)
+    : low(low)
+    , completion(completion)
+  { }
+
+  void handle(Flush const&)
+  {
+    low_before = low.count<Work>();
+    completion.done();
+  }
+};
+
+// sends `flood` messages to a low priority sink, then one to a high priority alarm
+class Flooder : public Actor<Flooder, Variant<Deal>>
+{
+  Sink& low;
+  Alarm& alarm;
+
+  public:
+  Flooder(Sink& low, Alarm& alarm)
+    : low(low)
+    , alarm(alarm)
+  { }
+
+  void handle(Deal const& deal)
+  {
+    for(std::uint64_t i = 0; i < deal.messages; ++i)
+    {
+      low.send(Work{i});
+    }
+    alarm.send(Flush{});
+  }
+};
+
+void priorities(std::uint64_t flood)
+{
+  Completion unused(1), completion(1);
+  ActorRuntime runtime(1);
+  Sink& low = runtime.spawn<Sink>(Priority::low, unused);
+  Alarm& alarm = runtime.spawn<Alarm>(Priority::high, low, completion);
+  Flooder& flooder = runtime.spawn<Flooder>(Priority::normal, low, alarm);
+  flooder.send(Deal{flood});
+  completion.wait();
+  std::cout << "priorities: on one worker, the high priority actor ran after " << alarm.low_before
+            << " of the " << flood << " messages to the low priority one, sent first" << std::endl;
+}
+
+double ping_pong(unsigned workers, unsigned pairs, std::uint32_t rounds)
+{
+  Completion completion(pairs);
+  ActorRuntime runtime(workers);
+  std::vector<Player*> players;
+  for(unsigned i = 0; i < 2 * pairs; ++i)
+  {
+    players.push_back(&runtime.spawn<Player>(Priority::normal, completion));
+  }
+  for(unsigned i = 0; i < pairs; ++i)
+  {
+    players[2 * i]->partner = players[2 * i + 1];
+    players[2 * i + 1]->partner = players[2 * i];
+  }
+  Stopwatch sw;
+  for(unsigned i = 0; i < pairs; ++i)
+  {
+    players[2 * i]->send(Serve{rounds});
+  }
+  completion.wait();
+  double ms = sw.elapsed_ms();
+  std::uint64_t balls = 0;
+  for(Player* p : players)
+  {
+    balls += p->count<Ball>();
+  }
+  if(balls != std::uint64_t(pairs) * (rounds + 1))
+  {
+    std::cout << "WRONG NUMBER OF BALLS " << balls << std::endl;
+  }
+  return double(balls) / ms * 1e3;
+}
+
+double fan_out(unsigned workers, unsigned sinks_count, std::uint64_t messages, bool print)
+{
+  Completion completion(sinks_count);
+  ActorRuntime runtime(workers);
+  std::vector<Sink*> sinks;
+  for(unsigned i = 0; i < sinks_count; ++i)
+  {
+    sinks.push_back(&runtime.spawn<Sink>(Priority::normal, completion));
+  }
+  Source& source = runtime.spawn<Source>(Priority::normal, sinks);
+  Stopwatch sw;
+  source.send(Deal{messages});
+  completion.wait();
+  double ms = sw.elapsed_ms();
+  std::uint64_t sum = 0, works = 0, flushes = 0;
+  for(Sink* sink : sinks)
+  {
+    sum += sink->sum;
+    works += sink->count<Work>();
+    flushes += sink->count<Flush>();
+  }
+  if(print)
+  {
+    std::cout << "fan-out counters: " << source.count<Deal>() << " Deal, " << works << " Work, "
+              << flushes << " Flush; sum " << (sum == messages * (messages - 1) / 2 ? "right" : "WRONG")
+              << std::endl;
+  }
+  return double(works + flushes) / ms * 1e3;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t n = size_arg(argc, argv, 2'000'000);
+  unsigned workers = std::max(2u, hardware_threads());
+  unsigned pairs = 1000;
+
+  priorities(10'000);
+  fan_out(workers, 1000, 100'000, true);
+
+  double best_ping = 0, best_fan = 0;
+  for(int rep = 0; rep < 3; ++rep)
+  {
+    auto rounds = std::uint32_t(std::max<std::size_t>(n / pairs, 1));
+    best_ping = std::max(best_ping, ping_pong(workers, pairs, rounds));
+    best_fan = std::max(best_fan, fan_out(workers, 1000, n, false));
+  }
+  std::cout << workers << " workers, millions of messages per second: ping-pong (" << pairs
+            << " pairs) " << best_ping / 1e6 << ", fan-out (1 to 1000) " << best_fan / 1e6 << std::endl;
+  return 0;
+}
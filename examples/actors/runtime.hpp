@@ -0,0 +1,315 @@
+#pragma once
+#include "../variant/findindexof.hpp"
+#include "../variant/variant.hpp"
+#include "mailbox.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+    A runtime for many small actors on a few threads. An actor is an object with a Mailbox of one
+    closed Variant of messages; the runtime runs it on one of its workers whenever it has messages,
+    and never on two at once, so an actor's state needs no lock.
+    - Scheduling: pending counts the messages sent and not yet handled. The sender that takes it from 0
+      to 1 makes the actor ready; an activation then handles a batch of at most activation_batch
+      messages, subtracts them, and makes the actor ready again if more arrived meanwhile. A busy actor
+      costs one scheduling per batch, not per message, and a message to an actor already waiting costs
+      no scheduling at all.
+    - Work stealing: each worker has its own ready queues, where the actors it activates or sends to
+      are put, and takes from them first; a worker with nothing to do steals from the other end of the
+      others' queues, and sleeps on a futex once there is nothing anywhere. The queues are short
+      std::deques under a mutex per worker: an actor is queued once per batch, and an uncontended lock
+      is small next to a batch of messages.
+    - Priorities: an actor is high, normal or low priority; a worker takes (and steals) from the high
+      queues first.
+    - Counters: the messages an actor handled, per type, indexed by FindIndexOfT in the list of its
+      message types. A message is counted before it is handled, with a plain store since only the
+      running activation writes, and the counters can be read at any time.
+*/
+
+enum class Priority : unsigned
+{
+  high,
+  normal,
+  low
+};
+
+constexpr unsigned priority_levels = 3;
+constexpr std::size_t activation_batch = 64;
+
+class ActorRuntime;
+
+class ActorBase
+{
+  friend class ActorRuntime;
+
+  std::atomic<std::size_t> pending{0};
+  ActorRuntime* runtime = nullptr;
+  Priority priority = Priority::normal;
+
+  protected:
+  // handles at most budget messages, returns how many
+  virtual std::size_t activate(std::size_t budget) = 0;
+
+  // after a message is in the mailbox
+  void notify_sent();
+
+  public:
+  virtual ~ActorBase() = default;
+
+  Priority get_priority() const noexcept
+  {
+    return priority;
+  }
+};
+
+class ActorRuntime
+{
+  struct alignas(64) Worker
+  {
+    std::mutex mutex;
+    std::array<std::deque<ActorBase*>, priority_levels> ready;
+  };
+
+  std::mutex actors_mutex;
+  std::vector<std::unique_ptr<ActorBase>> actors;
+  std::unique_ptr<Worker[]> workers;
+  unsigned worker_count;
+  std::vector<std::thread> threads;
+  std::atomic<bool> stopping{false};
+  std::atomic<unsigned> next_worker{0}; // where sends from outside the runtime go
+  std::atomic<std::uint32_t> epoch{0};  // bumped to wake the sleeping workers
+  std::atomic<unsigned> sleepers{0};
+
+  // the index of the calling worker in its runtime, or none
+  static constexpr unsigned none = ~0u;
+  static unsigned& current_worker() noexcept
+  {
+    thread_local unsigned index = none;
+    return index;
+  }
+
+  static ActorRuntime*& current_runtime() noexcept
+  {
+    thread_local ActorRuntime* runtime = nullptr;
+    return runtime;
+  }
+
+  // the first actor of the highest priority, from the front (own queues) or the back (stealing)
+  ActorBase* take(Worker& w, bool steal)
+  {
+    std::lock_guard<std::mutex> lock(w.mutex);
+    for(auto& queue : w.ready)
+    {
+      if(!queue.empty())
+      {
+        ActorBase* actor;
+        if(steal)
+        {
+          actor = queue.back();
+          queue.pop_back();
+        }
+        else
+        {
+          actor = queue.front();
+          queue.pop_front();
+        }
+        return actor;
+      }
+    }
+    return nullptr;
+  }
+
+  ActorBase* find_work(unsigned self)
+  {
+    if(ActorBase* actor = take(workers[self], false))
+    {
+      return actor;
+    }
+    for(unsigned i = 1; i < worker_count; ++i)
+    {
+      if(ActorBase* actor = take(workers[(self + i) % worker_count], true))
+      {
+        return actor;
+      }
+    }
+    return nullptr;
+  }
+
+  void run(ActorBase* actor)
+  {
+    std::size_t handled = actor->activate(activation_batch);
+    if(actor->pending.fetch_sub(handled, std::memory_order_acq_rel) != handled)
+    {
+      schedule(actor);
+    }
+  }
+
+  /*
+    The sleeping protocol is the one of BlockingWait in disruptor.hpp: a worker counts itself as a
+    sleeper, reads the epoch and looks for work once more; schedule() queues, then looks for
+    sleepers. The fences make sure that one of the two sees the other.
+  */
+  void work(unsigned self)
+  {
+    current_worker() = self;
+    current_runtime() = this;
+    while(!stopping.load(std::memory_order_acquire))
+    {
+      if(ActorBase* actor = find_work(self))
+      {
+        run(actor);
+        continue;
+      }
+      sleepers.fetch_add(1, std::memory_order_relaxed);
+      std::uint32_t e = epoch.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      ActorBase* actor = find_work(self);
+      if(actor == nullptr && !stopping.load(std::memory_order_acquire))
+      {
+        epoch.wait(e, std::memory_order_acquire);
+      }
+      sleepers.fetch_sub(1, std::memory_order_relaxed);
+      if(actor)
+      {
+        run(actor);
+      }
+    }
+  }
+
+  void wake_all() noexcept
+  {
+    epoch.fetch_add(1, std::memory_order_release);
+    epoch.notify_all();
+  }
+
+  public:
+  explicit ActorRuntime(unsigned worker_count)
+    : workers(new Worker[worker_count])
+    , worker_count(worker_count)
+  {
+    for(unsigned i = 0; i < worker_count; ++i)
+    {
+      threads.emplace_back([this, i] { work(i); });
+    }
+  }
+
+  ActorRuntime(ActorRuntime const&) = delete;
+  ActorRuntime& operator=(ActorRuntime const&) = delete;
+
+  // stops the workers; messages not handled yet are dropped with the actors
+  ~ActorRuntime()
+  {
+    stopping.store(true, std::memory_order_seq_cst);
+    wake_all();
+    for(auto& t : threads)
+    {
+      t.join();
+    }
+  }
+
+  // creates an actor owned by the runtime, alive until the runtime is destroyed
+  template <typename A, typename... Args>
+  A& spawn(Priority priority, Args&&... args)
+  {
+    auto actor = std::make_unique<A>(std::forward<Args>(args)...);
+    A& result = *actor;
+    actor->runtime = this;
+    actor->priority = priority;
+    std::lock_guard<std::mutex> lock(actors_mutex);
+    actors.push_back(std::move(actor));
+    return result;
+  }
+
+  /*
+    Queues a ready actor on the calling worker, or on the next one from outside. A worker queuing on
+    itself wakes the sleepers only if it now has more than the one actor it will take next: a chain
+    of messages between two actors keeps running on one worker without a wake-up per message.
+  */
+  void schedule(ActorBase* actor)
+  {
+    bool inside = current_runtime() == this;
+    unsigned w = inside ? current_worker()
+                        : next_worker.fetch_add(1, std::memory_order_relaxed) % worker_count;
+    bool surplus = !inside;
+    {
+      std::lock_guard<std::mutex> lock(workers[w].mutex);
+      auto& ready = workers[w].ready;
+      ready[unsigned(actor->priority)].push_back(actor);
+      surplus = surplus || ready[0].size() + ready[1].size() + ready[2].size() > 1;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(surplus && sleepers.load(std::memory_order_relaxed) != 0)
+    {
+      wake_all();
+    }
+  }
+};
+
+inline void ActorBase::notify_sent()
+{
+  if(pending.fetch_add(1, std::memory_order_acq_rel) == 0)
+  {
+    runtime->schedule(this);
+  }
+}
+
+/*
+    The base of an actor handling the messages of Message, a Variant<Msgs...>: Derived defines
+    handle(M&) for every M of Msgs (or a template), called through visit(). send() may be called from
+    any thread, inside or outside the runtime.
+*/
+template <typename Derived, typename Message>
+class Actor;
+
+template <typename Derived, typename... Msgs>
+class Actor<Derived, Variant<Msgs...>> : public ActorBase
+{
+  using Message = Variant<Msgs...>;
+
+  Mailbox<Message> mailbox;
+  std::array<std::atomic<std::uint64_t>, sizeof...(Msgs)> handled{};
+
+  protected:
+  std::size_t activate(std::size_t budget) override
+  {
+    std::size_t n = 0;
+    for(; n < budget; ++n)
+    {
+      typename Mailbox<Message>::Box node = mailbox.pop();
+      if(!node)
+      {
+        break;
+      }
+      node->message.template visit<void>([this](auto& m) {
+        auto& count = handled[FindIndexOfT<TypeList<Msgs...>, std::remove_cvref_t<decltype(m)>>::value];
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        static_cast<Derived*>(this)->handle(m);
+      });
+    }
+    return n;
+  }
+
+  public:
+  template <typename M>
+  void send(M&& message)
+  {
+    mailbox.send(std::forward<M>(message));
+    notify_sent();
+  }
+
+  // the messages of type M handled so far
+  template <typename M>
+  std::uint64_t count() const noexcept
+  {
+    return handled[FindIndexOfT<TypeList<Msgs...>, M>::value].load(std::memory_order_relaxed);
+  }
+};
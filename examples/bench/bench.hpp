@@ -0,0 +1,85 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+    Tiny helpers shared by the benchmark sections of the example executables. They are not meant to
+    replace a real benchmarking library: each measurement is simply the best wall-clock time of a few
+    repetitions, which is good enough to compare two implementations of the same thing.
+*/
+
+class Stopwatch
+{
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+
+  public:
+  void reset()
+  {
+    start = Clock::now();
+  }
+
+  double elapsed_ns() const
+  {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  }
+
+  double elapsed_ms() const
+  {
+    return elapsed_ns() / 1e6;
+  }
+};
+
+// prevent the optimizer from discarding a value (or the computation producing it)
+template <typename T>
+inline void do_not_optimize(T const& value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// best time in milliseconds of `reps` runs of f
+template <typename F>
+double time_ms(F&& f, unsigned reps = 3)
+{
+  double best = 0;
+  for(unsigned i = 0; i < reps; ++i)
+  {
+    Stopwatch sw;
+    f();
+    double ms = sw.elapsed_ms();
+    if(i == 0 || ms < best)
+    {
+      best = ms;
+    }
+  }
+  return best;
+}
+
+inline unsigned hardware_threads()
+{
+  unsigned n = std::thread::hardware_concurrency();
+  return n ? n : 1;
+}
+
+// 1, 2, 4, ... up to (and always including) the number of available cores
+inline std::vector<unsigned> thread_counts()
+{
+  std::vector<unsigned> counts;
+  unsigned hw = hardware_threads();
+  for(unsigned n = 1; n < hw; n *= 2)
+  {
+    counts.push_back(n);
+  }
+  counts.push_back(hw);
+  return counts;
+}
+
+// the size of a benchmark can be overridden from the command line: `./example 1000000`
+inline std::size_t size_arg(int argc, char** argv, std::size_t def, int pos = 1)
+{
+  return argc > pos ? std::stoull(argv[pos]) : def;
+}
@@ -0,0 +1,334 @@
+#pragma once
+#include "../serialize/binary.hpp"
+#include "bench.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+/*
+    A latency histogram in the style of HdrHistogram: log-linear buckets, so that every value is
+    counted with the same relative precision, in memory fixed at construction.
+    With p bits of precision, values below 2^(p+1) get a bucket each, and every power of two above
+    is split into 2^p buckets of equal width. The bucket of v is found with one count of leading
+    zeros and a shift: with k = max(0, msb(v) - p), it is k * 2^p + (v >> k). A percentile is
+    answered with the largest value of its bucket, which is within 2^-p of the exact value (0.8% for
+    the default 7 bits), whatever the magnitude: 1 us and 1 s both get three significant digits.
+    record() is a handful of instructions and no locked instruction: a histogram is filled by one
+    thread, each thread having its own. merge() adds one histogram into another with atomic
+    additions, so any number of threads can merge into a common one without a lock, even while the
+    sources are still being recorded into; the common one must not be recorded into itself.
+    Values above the configured highest are counted as the highest.
+*/
+class LatencyHistogram
+{
+  unsigned precision;
+  std::uint64_t highest;
+  std::size_t bucket_count;
+  std::unique_ptr<std::atomic<std::uint64_t>[]> counts;
+  std::atomic<std::uint64_t> total{0};
+  std::atomic<std::uint64_t> sum{0};
+  std::atomic<std::uint64_t> lowest_value{std::numeric_limits<std::uint64_t>::max()};
+  std::atomic<std::uint64_t> highest_value{0};
+
+  static std::size_t index_of(std::uint64_t v, unsigned precision) noexcept
+  {
+    unsigned msb = v == 0 ? 0 : unsigned(63 - std::countl_zero(v));
+    unsigned shift = msb > precision ? msb - precision : 0;
+    return (std::size_t(shift) << precision) + std::size_t(v >> shift);
+  }
+
+  std::size_t index_of(std::uint64_t v) const noexcept
+  {
+    return index_of(v, precision);
+  }
+
+  // the largest value counted in bucket i
+  std::uint64_t highest_at(std::size_t i) const noexcept
+  {
+    std::size_t sub_buckets = std::size_t(1) << precision;
+    unsigned shift = i < 2 * sub_buckets ? 0 : unsigned((i >> precision) - 1);
+    std::uint64_t sub = i - (std::size_t(shift) << precision);
+    return ((sub + 1) << shift) - 1;
+  }
+
+  // single writer: no read-modify-write
+  static void add_owned(std::atomic<std::uint64_t>& a, std::uint64_t n) noexcept
+  {
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  static void lower_to(std::atomic<std::uint64_t>& a, std::uint64_t v) noexcept
+  {
+    std::uint64_t current = a.load(std::memory_order_relaxed);
+    while(v < current && !a.compare_exchange_weak(current, v, std::memory_order_relaxed))
+    { }
+  }
+
+  static void raise_to(std::atomic<std::uint64_t>& a, std::uint64_t v) noexcept
+  {
+    std::uint64_t current = a.load(std::memory_order_relaxed);
+    while(v > current && !a.compare_exchange_weak(current, v, std::memory_order_relaxed))
+    { }
+  }
+
+  public:
+  // by default up to an hour in nanoseconds, with 7 bits of precision
+  explicit LatencyHistogram(std::uint64_t highest = 3'600'000'000'000, unsigned precision = 7)
+    : precision(precision)
+    , highest(highest)
+  {
+    if(precision < 1 || precision > 20 || highest < 1)
+    {
+      throw std::invalid_argument("LatencyHistogram: precision must be 1 to 20 bits, highest > 0");
+    }
+    bucket_count = index_of(highest, precision) + 1;
+    counts.reset(new std::atomic<std::uint64_t>[bucket_count]);
+    reset();
+  }
+
+  // not while other is recorded or merged into
+  LatencyHistogram(LatencyHistogram&& other) noexcept
+    : precision(other.precision)
+    , highest(other.highest)
+    , bucket_count(other.bucket_count)
+    , counts(std::move(other.counts))
+    , total(other.total.load(std::memory_order_relaxed))
+    , sum(other.sum.load(std::memory_order_relaxed))
+    , lowest_value(other.lowest_value.load(std::memory_order_relaxed))
+    , highest_value(other.highest_value.load(std::memory_order_relaxed))
+  {
+    other.bucket_count = 0;
+    other.total.store(0, std::memory_order_relaxed);
+  }
+
+  LatencyHistogram& operator=(LatencyHistogram&&) = delete;
+
+  void reset() noexcept
+  {
+    for(std::size_t i = 0; i < bucket_count; ++i)
+    {
+      counts[i].store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    lowest_value.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+    highest_value.store(0, std::memory_order_relaxed);
+  }
+
+  // by the owning thread only
+  void record(std::uint64_t v) noexcept
+  {
+    v = std::min(v, highest);
+    add_owned(counts[index_of(v)], 1);
+    add_owned(total, 1);
+    add_owned(sum, v);
+    if(v < lowest_value.load(std::memory_order_relaxed))
+    {
+      lowest_value.store(v, std::memory_order_relaxed);
+    }
+    if(v > highest_value.load(std::memory_order_relaxed))
+    {
+      highest_value.store(v, std::memory_order_relaxed);
+    }
+  }
+
+  // adds the counts of other, which must have the same precision and highest value
+  void merge(LatencyHistogram const& other) noexcept
+  {
+    std::size_t n = std::min(bucket_count, other.bucket_count);
+    for(std::size_t i = 0; i < n; ++i)
+    {
+      if(std::uint64_t c = other.counts[i].load(std::memory_order_relaxed))
+      {
+        counts[i].fetch_add(c, std::memory_order_relaxed);
+      }
+    }
+    total.fetch_add(other.total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    sum.fetch_add(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    lower_to(lowest_value, other.lowest_value.load(std::memory_order_relaxed));
+    raise_to(highest_value, other.highest_value.load(std::memory_order_relaxed));
+  }
+
+  std::uint64_t count() const noexcept
+  {
+    return total.load(std::memory_order_relaxed);
+  }
+
+  std::uint64_t min() const noexcept
+  {
+    return count() ? lowest_value.load(std::memory_order_relaxed) : 0;
+  }
+
+  std::uint64_t max() const noexcept
+  {
+    return highest_value.load(std::memory_order_relaxed);
+  }
+
+  double mean() const noexcept
+  {
+    return count() ? double(sum.load(std::memory_order_relaxed)) / double(count()) : 0;
+  }
+
+  // the value below which `percent` of the values fall, to the precision of the histogram
+  std::uint64_t percentile(double percent) const noexcept
+  {
+    std::uint64_t n = count();
+    if(n == 0)
+    {
+      return 0;
+    }
+    percent = std::clamp(percent, 0.0, 100.0);
+    auto rank = std::uint64_t(std::ceil(percent / 100 * double(n)));
+    rank = std::clamp<std::uint64_t>(rank, 1, n);
+    std::uint64_t seen = 0;
+    for(std::size_t i = 0; i < bucket_count; ++i)
+    {
+      seen += counts[i].load(std::memory_order_relaxed);
+      if(seen >= rank)
+      {
+        return std::min(highest_at(i), max());
+      }
+    }
+    return max();
+  }
+
+  // one line: count, mean and the usual percentiles, in the unit of the values
+  void print(std::ostream& os, char const* unit = "ns") const
+  {
+    os << count() << " values, mean " << mean() << ", p50 " << percentile(50) << ", p90 "
+       << percentile(90) << ", p99 " << percentile(99) << ", p99.9 " << percentile(99.9)
+       << ", p99.99 " << percentile(99.99) << ", max " << max() << " " << unit;
+  }
+
+  /*
+    The counts are written as LEB128 varints, with each run of empty buckets written as one varint
+    too (a count c as 2c, a run of r empty buckets as 2r + 1): a histogram with a few hundred
+    distinct buckets takes a few hundred bytes, not bucket_count * 8.
+  */
+  void serialize(std::vector<std::byte>& out) const
+  {
+    std::vector<std::byte> encoded;
+    auto put = [&](std::uint64_t v) {
+      while(v >= 0x80)
+      {
+        encoded.push_back(std::byte(v | 0x80));
+        v >>= 7;
+      }
+      encoded.push_back(std::byte(v));
+    };
+    std::uint64_t empty_run = 0;
+    for(std::size_t i = 0; i < bucket_count; ++i)
+    {
+      std::uint64_t c = counts[i].load(std::memory_order_relaxed);
+      if(c == 0)
+      {
+        ++empty_run;
+        continue;
+      }
+      if(empty_run)
+      {
+        put(empty_run * 2 + 1);
+        empty_run = 0;
+      }
+      put(c * 2);
+    }
+    BinaryWriter writer(out);
+    writer.write(std::uint8_t(precision));
+    writer.write(highest);
+    writer.write(sum.load(std::memory_order_relaxed));
+    writer.write(min());
+    writer.write(max());
+    writer.write(encoded);
+  }
+
+  // the header is checked before the counts are allocated: at most max_bytes of them, since a
+  // short input can describe a histogram of any size (its empty buckets take nothing)
+  static LatencyHistogram deserialize(std::vector<std::byte> const& in,
+                                      std::size_t max_bytes = std::size_t(64) << 20)
+  {
+    BinaryReader reader(in);
+    std::uint8_t precision;
+    std::uint64_t highest, sum, lowest, max;
+    std::vector<std::byte> encoded;
+    reader.read(precision);
+    reader.read(highest);
+    reader.read(sum);
+    reader.read(lowest);
+    reader.read(max);
+    reader.read(encoded);
+    if(precision < 1 || precision > 20 || highest < 1 ||
+       index_of(highest, precision) >= max_bytes / sizeof(std::uint64_t))
+    {
+      throw std::runtime_error("LatencyHistogram: invalid header or too large");
+    }
+
+    LatencyHistogram h(highest, precision);
+    std::size_t at = 0;
+    std::size_t bucket = 0;
+    std::uint64_t total = 0;
+    while(at < encoded.size())
+    {
+      std::uint64_t v = 0;
+      for(unsigned shift = 0;; shift += 7)
+      {
+        if(at == encoded.size() || shift > 63)
+        {
+          throw std::runtime_error("LatencyHistogram: invalid encoding");
+        }
+        auto b = std::uint64_t(encoded[at++]);
+        v |= (b & 0x7F) << shift;
+        if(b < 0x80)
+        {
+          break;
+        }
+      }
+      if(v & 1)
+      {
+        if(v / 2 > h.bucket_count - bucket)
+        {
+          throw std::runtime_error("LatencyHistogram: invalid encoding");
+        }
+        bucket += v / 2;
+        continue;
+      }
+      if(bucket >= h.bucket_count)
+      {
+        throw std::runtime_error("LatencyHistogram: invalid encoding");
+      }
+      h.counts[bucket++].store(v / 2, std::memory_order_relaxed);
+      total += v / 2;
+    }
+    h.total.store(total, std::memory_order_relaxed);
+    h.sum.store(sum, std::memory_order_relaxed);
+    h.lowest_value.store(total ? lowest : std::numeric_limits<std::uint64_t>::max(),
+                         std::memory_order_relaxed);
+    h.highest_value.store(max, std::memory_order_relaxed);
+    return h;
+  }
+
+  // the memory taken by the counts
+  std::size_t bytes() const noexcept
+  {
+    return bucket_count * sizeof(std::uint64_t);
+  }
+};
+
+// the latency in nanoseconds of each of n calls of f(i), timed one by one
+template <typename F>
+void record_latencies(LatencyHistogram& histogram, std::size_t n, F&& f)
+{
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    Stopwatch sw;
+    f(i);
+    histogram.record(std::uint64_t(sw.elapsed_ns()));
+  }
+}
@@ -0,0 +1,227 @@
+#pragma once
+#include "../tuple/tuplehash.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BLOCKED_BLOOM_AVX2 1
+#include <immintrin.h>
+#endif
+
+/*
+    Blocked Bloom filter for Tuple keys, used to reject keys before an expensive lookup (e.g. the
+    probe side of a semi-join).
+    A classic Bloom filter touches k random cache lines per key. Here the first half of the key hash
+    selects one 64-byte block (a cache line), and all k = 8 bits of the key are set inside that block,
+    one bit in each of its eight 64-bit words. The bit inside word i is taken from the top 6 bits of
+    (low half of the hash * salt[i]), with the odd salts of the Parquet split-block filter.
+    So insert and lookup cost a single cache miss, and a lookup is "are these 8 bits all set?",
+    which is two 256-bit AND-tests with AVX2. The AVX2 code is compiled for that instruction set
+    alone (target("avx2")), whatever the flags of the build, and chosen at run time when the CPU
+    has it (__builtin_cpu_supports); other CPUs and compilers run the scalar loop.
+    Blocks are not uniformly loaded, so the price is a higher false-positive rate than a classic
+    filter with the same number of bits, and k = 8 only pays off from about 8 bits per key.
+    Measured with 10M keys (see main.cpp):
+
+        bits per key   expected FPR   measured FPR
+              4          31.9 %         31.8 %
+              6           9.3 %          9.3 %
+              8           2.9 %          2.9 %
+             10           1.05 %         1.05 %
+             12           0.42 %         0.42 %
+             16           0.091 %        0.094 %
+
+    contains_batch() tests a column of keys: the keys are hashed in one pass (hash_tuple_batch), the
+    blocks of the next group of keys are prefetched, and only then tested, so that the cache misses
+    of different keys overlap instead of being paid one after the other.
+*/
+
+template <typename Key>
+class BlockedBloomFilter
+{
+  struct alignas(64) Block
+  {
+    std::uint64_t words[8];
+  };
+
+  static constexpr std::uint32_t salts[8] = {0x47b6137bU,
+                                             0x44974d91U,
+                                             0x8824ad5bU,
+                                             0xa2b7289dU,
+                                             0x705495c7U,
+                                             0x2df1424bU,
+                                             0x9efc4947U,
+                                             0x5c6bfb31U};
+
+  // keys hashed and prefetched ahead of being tested by contains_batch()
+  static constexpr std::size_t batch = 32;
+
+  std::vector<Block> blocks;
+
+  // the high half of the hash selects the block, without a modulo
+  Block const& block_of(std::uint64_t hash) const
+  {
+    return blocks[((hash >> 32) * blocks.size()) >> 32];
+  }
+
+  Block& block_of(std::uint64_t hash)
+  {
+    return blocks[((hash >> 32) * blocks.size()) >> 32];
+  }
+
+  static std::uint64_t bit_in_word(std::uint32_t h, unsigned i)
+  {
+    return std::uint64_t(1) << ((h * salts[i]) >> 26);
+  }
+
+  static bool test_block_scalar(Block const& block, std::uint32_t h)
+  {
+    std::uint64_t missing = 0;
+    for(unsigned i = 0; i < 8; ++i)
+    {
+      missing |= ~block.words[i] & bit_in_word(h, i);
+    }
+    return missing == 0;
+  }
+
+#if defined(BLOCKED_BLOOM_AVX2)
+  __attribute__((target("avx2"))) static bool test_block_avx2(Block const& block, std::uint32_t h)
+  {
+    __m256i salt = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(salts));
+    __m256i pos = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(h), salt), 26);
+    __m256i one = _mm256_set1_epi64x(1);
+    __m256i lo = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(pos)));
+    __m256i hi = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(pos, 1)));
+    __m256i w0 = _mm256_load_si256(reinterpret_cast<__m256i const*>(block.words));
+    __m256i w1 = _mm256_load_si256(reinterpret_cast<__m256i const*>(block.words + 4));
+    // testc(a, b) is 1 if every bit set in b is set in a
+    return _mm256_testc_si256(w0, lo) & _mm256_testc_si256(w1, hi);
+  }
+
+  // the whole loop is compiled for AVX2, so that test_block_avx2 is inlined into it
+  __attribute__((target("avx2"))) void test_hashes_avx2(std::uint64_t const* hashes, std::size_t n,
+                                                        bool* out) const
+  {
+    for(std::size_t j = 0; j < n; ++j)
+    {
+      out[j] = test_block_avx2(block_of(hashes[j]), static_cast<std::uint32_t>(hashes[j]));
+    }
+  }
+
+  static inline bool const has_avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+  static bool test_block(Block const& block, std::uint32_t h)
+  {
+#if defined(BLOCKED_BLOOM_AVX2)
+    if(has_avx2)
+    {
+      return test_block_avx2(block, h);
+    }
+#endif
+    return test_block_scalar(block, h);
+  }
+
+  // out[j] = the block of hashes[j] holds its bits, for the n hashes
+  void test_hashes(std::uint64_t const* hashes, std::size_t n, bool* out) const
+  {
+#if defined(BLOCKED_BLOOM_AVX2)
+    if(has_avx2)
+    {
+      test_hashes_avx2(hashes, n, out);
+      return;
+    }
+#endif
+    for(std::size_t j = 0; j < n; ++j)
+    {
+      out[j] = test_block_scalar(block_of(hashes[j]), static_cast<std::uint32_t>(hashes[j]));
+    }
+  }
+
+  public:
+  // a filter sized for `expected_keys` keys with `bits_per_key` bits each
+  explicit BlockedBloomFilter(std::size_t expected_keys, double bits_per_key = 10)
+    : blocks(std::max<std::size_t>(1, std::ceil(expected_keys * bits_per_key / 512)))
+  { }
+
+  // builds the filter of a whole column of keys
+  static BlockedBloomFilter from_column(std::vector<Key> const& column, double bits_per_key = 10)
+  {
+    BlockedBloomFilter filter(column.size(), bits_per_key);
+    std::uint64_t hashes[batch];
+    for(std::size_t i = 0; i < column.size(); i += batch)
+    {
+      std::size_t n = std::min(batch, column.size() - i);
+      hash_tuple_batch(column.data() + i, n, hashes);
+      for(std::size_t j = 0; j < n; ++j)
+      {
+        filter.insert_hash(hashes[j]);
+      }
+    }
+    return filter;
+  }
+
+  void insert(Key const& key)
+  {
+    insert_hash(hash_tuple(key));
+  }
+
+  void insert_hash(std::uint64_t hash)
+  {
+    Block& block = block_of(hash);
+    for(unsigned i = 0; i < 8; ++i)
+    {
+      block.words[i] |= bit_in_word(static_cast<std::uint32_t>(hash), i);
+    }
+  }
+
+  // false means the key was certainly never inserted
+  bool contains(Key const& key) const
+  {
+    return contains_hash(hash_tuple(key));
+  }
+
+  bool contains_hash(std::uint64_t hash) const
+  {
+    return test_block(block_of(hash), static_cast<std::uint32_t>(hash));
+  }
+
+  // out[i] = contains(keys[i]) for the n keys
+  void contains_batch(Key const* keys, std::size_t n, bool* out) const
+  {
+    std::uint64_t hashes[batch];
+    for(std::size_t i = 0; i < n; i += batch)
+    {
+      std::size_t m = std::min(batch, n - i);
+      hash_tuple_batch(keys + i, m, hashes);
+      for(std::size_t j = 0; j < m; ++j)
+      {
+        __builtin_prefetch(&block_of(hashes[j]));
+      }
+      test_hashes(hashes, m, out + i);
+    }
+  }
+
+  std::size_t size_in_bytes() const
+  {
+    return blocks.size() * sizeof(Block);
+  }
+
+  // false-positive rate predicted for a filter with `bits_per_key` bits per key: the number of keys
+  // in a block is Poisson distributed, and a block holding n keys answers "yes" to an absent key with
+  // probability (1 - (63/64)^n)^8
+  static double expected_false_positive_rate(double bits_per_key)
+  {
+    double lambda = 512 / bits_per_key;
+    double poisson = std::exp(-lambda); // P(n = 0)
+    double fpr = 0;
+    for(unsigned n = 0; n < 4 * lambda + 64; ++n)
+    {
+      fpr += poisson * std::pow(1 - std::pow(63.0 / 64.0, n), 8);
+      poisson *= lambda / (n + 1);
+    }
+    return fpr;
+  }
+};
@@ -0,0 +1,88 @@
+#include "../bench/bench.hpp"
+#include "blockedbloom.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using Key = Tuple<long long, int>; // (customer, region)
+
+// keys with an even customer id are inserted, keys with an odd one never are
+std::vector<Key> make_keys(std::size_t n, bool present, std::uint64_t seed)
+{
+  std::mt19937_64 rng(seed);
+  std::vector<Key> keys;
+  keys.reserve(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    long long customer = static_cast<long long>(rng() >> 2) * 2 + (present ? 0 : 1);
+    keys.emplace_back(customer, static_cast<int>(rng() % 32));
+  }
+  return keys;
+}
+
+int main(int argc, char** argv)
+{
+  // semi-join pre-filter: only orders whose (customer, region) may exist go to the real lookup
+  std::vector<Tuple<std::string, int>> customers{{"alice", 1}, {"bob", 2}, {"carol", 1}};
+  auto filter = BlockedBloomFilter<Tuple<std::string, int>>::from_column(customers);
+  std::cout << std::boolalpha << "contains (bob, 2): " << filter.contains({"bob", 2}) << std::endl;
+  std::cout << "contains (bob, 3): " << filter.contains({"bob", 3}) << std::endl;
+
+  // false-positive rate versus bits per key
+  std::size_t fpr_keys = size_arg(argc, argv, 10'000'000, 2);
+  std::vector<Key> inserted = make_keys(fpr_keys, true, 1);
+  std::vector<Key> absent = make_keys(1'000'000, false, 2);
+  std::unique_ptr<bool[]> out(new bool[absent.size()]);
+  std::cout << "bits/key  expected FPR  measured FPR   (" << fpr_keys << " keys)" << std::endl;
+  for(double bits : {4.0, 6.0, 8.0, 10.0, 12.0, 16.0})
+  {
+    auto f = BlockedBloomFilter<Key>::from_column(inserted, bits);
+    f.contains_batch(absent.data(), absent.size(), out.get());
+    std::size_t positives = 0;
+    for(std::size_t i = 0; i < absent.size(); ++i)
+    {
+      positives += out[i];
+    }
+    std::cout << std::setw(8) << bits << std::setw(13)
+              << 100 * BlockedBloomFilter<Key>::expected_false_positive_rate(bits) << " %"
+              << std::setw(12) << 100.0 * positives / absent.size() << " %" << std::endl;
+  }
+  inserted = {};
+
+  // throughput of a filter holding n keys, probed with 10M keys (half of them present)
+  std::size_t n = size_arg(argc, argv, 100'000'000);
+  std::size_t probes = std::min<std::size_t>(n, 10'000'000);
+  std::vector<Key> column = make_keys(n, true, 3);
+  Stopwatch sw;
+  auto big = BlockedBloomFilter<Key>::from_column(column, 10);
+  double build_ms = sw.elapsed_ms();
+  std::vector<Key> lookups(column.begin(), column.begin() + probes / 2);
+  std::vector<Key> misses = make_keys(probes - probes / 2, false, 4);
+  lookups.insert(lookups.end(), misses.begin(), misses.end());
+  std::shuffle(lookups.begin(), lookups.end(), std::mt19937_64(5));
+  column = {};
+  out.reset(new bool[lookups.size()]);
+
+  std::cout << "filter of " << n << " keys, " << big.size_in_bytes() / (1 << 20) << " MiB, built in "
+            << build_ms << " ms (" << n / build_ms / 1e3 << " Mkeys/s)" << std::endl;
+  std::size_t hits = 0;
+  double one_ms = time_ms([&] {
+    hits = 0;
+    for(Key const& key : lookups)
+    {
+      hits += big.contains(key);
+    }
+  });
+  std::cout << "  contains():       " << probes / one_ms / 1e3 << " Mkeys/s, " << hits << " hits"
+            << std::endl;
+  double batch_ms = time_ms([&] {
+    big.contains_batch(lookups.data(), lookups.size(), out.get());
+    do_not_optimize(out[0]);
+  });
+  std::cout << "  contains_batch(): " << probes / batch_ms / 1e3 << " Mkeys/s" << std::endl;
+  return 0;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "../tuple/makeindexlist.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+    Bit-packing of groups of 128 unsigned 32-bit values, the primitive underneath the
+    frame-of-reference, delta and dictionary codecs.
+    The layout is the "vertical" one of SIMD-BP128 (Lemire, Boytsov): value i belongs to lane i % 4,
+    and every lane is packed into its own sequence of 32-bit words, the words of the 4 lanes being
+    interleaved. A group packed with W bits per value takes exactly 4 * W words, and unpacking it is
+    the same sequence of shifts and masks applied to 4 lanes at once, i.e. to one SSE2 register.
+    unpack128<W>() is instantiated for every W, so that all the shift counts are constants and the
+    32 steps are fully unrolled; unpack() dispatches on the runtime width with a table of them.
+*/
+
+constexpr std::size_t pack_group = 128;
+
+// words taken by a group packed with `width` bits per value
+constexpr std::size_t packed_words(unsigned width)
+{
+  return 4 * width;
+}
+
+// out must hold packed_words(width) zeroed words
+inline void pack128(std::uint32_t const* in, unsigned width, std::uint32_t* out)
+{
+  if(width == 0)
+  {
+    return;
+  }
+  for(unsigned k = 0; k < 32; ++k)
+  {
+    unsigned bit = k * width, word = bit / 32, shift = bit % 32;
+    for(unsigned lane = 0; lane < 4; ++lane)
+    {
+      std::uint32_t value = in[4 * k + lane];
+      out[4 * word + lane] |= value << shift;
+      if(shift + width > 32)
+      {
+        out[4 * (word + 1) + lane] |= value >> (32 - shift);
+      }
+    }
+  }
+}
+
+template <unsigned W>
+void unpack128(std::uint32_t const* in, std::uint32_t* out)
+{
+  if constexpr(W == 0)
+  {
+    std::memset(out, 0, pack_group * sizeof(std::uint32_t));
+  }
+  else
+  {
+    constexpr std::uint32_t mask = W == 32 ? ~std::uint32_t(0) : (std::uint32_t(1) << W) - 1;
+#if defined(__SSE2__)
+    __m128i const* src = reinterpret_cast<__m128i const*>(in);
+    __m128i* dst = reinterpret_cast<__m128i*>(out);
+    __m128i const vmask = _mm_set1_epi32(static_cast<int>(mask));
+#pragma GCC unroll 32
+    for(unsigned k = 0; k < 32; ++k)
+    {
+      unsigned bit = k * W, word = bit / 32, shift = bit % 32;
+      __m128i v = _mm_srli_epi32(_mm_loadu_si128(src + word), shift);
+      if(shift + W > 32)
+      {
+        v = _mm_or_si128(v, _mm_slli_epi32(_mm_loadu_si128(src + word + 1), 32 - shift));
+      }
+      _mm_storeu_si128(dst + k, _mm_and_si128(v, vmask));
+    }
+#else
+#pragma GCC unroll 32
+    for(unsigned k = 0; k < 32; ++k)
+    {
+      unsigned bit = k * W, word = bit / 32, shift = bit % 32;
+      for(unsigned lane = 0; lane < 4; ++lane)
+      {
+        std::uint32_t v = in[4 * word + lane] >> shift;
+        if(shift + W > 32)
+        {
+          v |= in[4 * (word + 1) + lane] << (32 - shift);
+        }
+        out[4 * k + lane] = v & mask;
+      }
+    }
+#endif
+  }
+}
+
+using UnpackFn = void (*)(std::uint32_t const*, std::uint32_t*);
+
+template <unsigned... Widths>
+constexpr auto make_unpack_table(ValueList<unsigned, Widths...>)
+{
+  struct Table
+  {
+    UnpackFn fn[sizeof...(Widths)];
+  };
+  return Table{{&unpack128<Widths>...}};
+}
+
+// unpacks a group of 128 values packed with `width` (0 to 32) bits each
+inline void unpack(std::uint32_t const* in, unsigned width, std::uint32_t* out)
+{
+  static constexpr auto table = make_unpack_table(MakeIndexList<33>{});
+  table.fn[width](in, out);
+}
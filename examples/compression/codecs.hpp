@@ -0,0 +1,403 @@
+#pragma once
+#include "../tuple/tuple.hpp"
+#include "../tuple/tupletypelist.hpp"
+#include "bitpack.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+/*
+    Lightweight compression of integer columns. A column is cut in blocks of 1024 values and every
+    block is encoded with whichever of these codecs gives the smallest output:
+    - FrameOfReference: value - min of the block, bit-packed (ids, small counters);
+    - Delta: difference with the previous value - min difference, bit-packed (timestamps, sorted
+      keys);
+    - Dictionary: index into the sorted distinct values of the block, bit-packed (few distinct
+      values spread over a wide range, e.g. status codes);
+    - RunLength: (value, length) pairs (sorted or clustered low-cardinality data);
+    - Plain: the values as they are, when nothing else helps.
+    Every block also keeps its min and max (a "zone map"), so a filter can skip a whole block, or
+    accept it, without decoding it.
+    Decoding goes through the SIMD unpack kernels of bitpack.hpp. scan() decodes one block at a
+    time into a buffer that stays in L1 and hands it to a filter kernel, so the uncompressed column
+    is never materialized.
+*/
+
+enum class Codec : unsigned char
+{
+  Plain,
+  FrameOfReference,
+  Delta,
+  Dictionary,
+  RunLength
+};
+
+constexpr char const* codec_name(Codec c)
+{
+  constexpr char const* names[] = {"plain", "for", "delta", "dictionary", "rle"};
+  return names[static_cast<unsigned>(c)];
+}
+
+// filter kernel: number of values in [lo, hi]; branch-free, so the compiler vectorizes it
+template <typename T>
+std::size_t count_between(T const* values, std::size_t n, T lo, T hi)
+{
+  std::size_t count = 0;
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    count += (values[i] >= lo) & (values[i] <= hi);
+  }
+  return count;
+}
+
+template <typename T>
+class CompressedColumn
+{
+  static_assert(std::is_integral_v<T>, "only integer columns can be compressed");
+
+  public:
+  static constexpr std::size_t block_size = 1024;
+
+  private:
+  // arithmetic is done on 64-bit unsigned values, where wrap-around is well defined: the
+  // difference of two values of T is then exact as long as it fits, whatever the signedness of T
+  using U = std::uint64_t;
+
+  static U widen(T v)
+  {
+    return static_cast<U>(v);
+  }
+
+  struct Block
+  {
+    Codec codec;
+    unsigned char width; // bits per packed value
+    std::uint32_t count; // values in the block
+    std::uint32_t aux_count; // dictionary size or number of runs
+    std::size_t words_at; // packed data (or run lengths) in `words`
+    std::size_t values_at; // plain values, dictionary or run values in `values`
+    U base; // min (for), first value (delta)
+    U step; // min difference (delta)
+    T min, max;
+  };
+
+  std::vector<Block> blocks;
+  std::vector<std::uint32_t> words;
+  std::vector<T> values;
+  std::size_t rows = 0;
+
+  static std::size_t groups(std::size_t n)
+  {
+    return (n + pack_group - 1) / pack_group;
+  }
+
+  // bytes of n residuals packed with the given width
+  static std::size_t packed_bytes(std::size_t n, unsigned width)
+  {
+    return groups(n) * packed_words(width) * sizeof(std::uint32_t);
+  }
+
+  static unsigned width_of(U range)
+  {
+    return std::bit_width(range);
+  }
+
+  void pack_residuals(std::uint32_t const* residuals, std::size_t n, unsigned width)
+  {
+    std::uint32_t group[pack_group];
+    for(std::size_t g = 0; g < groups(n); ++g)
+    {
+      std::size_t first = g * pack_group, m = std::min(pack_group, n - first);
+      std::copy(residuals + first, residuals + first + m, group);
+      std::fill(group + m, group + pack_group, 0);
+      words.resize(words.size() + packed_words(width));
+      pack128(group, width, words.data() + words.size() - packed_words(width));
+    }
+  }
+
+  void unpack_residuals(Block const& b, std::uint32_t* residuals) const
+  {
+    std::uint32_t const* in = words.data() + b.words_at;
+    for(std::size_t g = 0; g < groups(b.count); ++g)
+    {
+      unpack(in + g * packed_words(b.width), b.width, residuals + g * pack_group);
+    }
+  }
+
+  void encode_block(T const* data, std::size_t n)
+  {
+    Block b{};
+    b.count = static_cast<std::uint32_t>(n);
+    b.words_at = words.size();
+    b.values_at = values.size();
+    b.min = *std::min_element(data, data + n);
+    b.max = *std::max_element(data, data + n);
+    constexpr std::size_t unusable = std::numeric_limits<std::size_t>::max();
+
+    // frame of reference
+    U range = widen(b.max) - widen(b.min);
+    std::size_t for_bytes = range >> 32 ? unusable : packed_bytes(n, width_of(range));
+
+    // delta
+    std::int64_t min_d = 0, max_d = 0;
+    for(std::size_t i = 1; i < n; ++i)
+    {
+      auto d = static_cast<std::int64_t>(widen(data[i]) - widen(data[i - 1]));
+      min_d = i == 1 ? d : std::min(min_d, d);
+      max_d = i == 1 ? d : std::max(max_d, d);
+    }
+    U delta_range = U(max_d) - U(min_d);
+    std::size_t delta_bytes = delta_range >> 32 ? unusable : packed_bytes(n, width_of(delta_range));
+
+    // run length
+    std::size_t runs = 1;
+    for(std::size_t i = 1; i < n; ++i)
+    {
+      runs += data[i] != data[i - 1];
+    }
+    std::size_t rle_bytes = runs * (sizeof(T) + sizeof(std::uint32_t));
+
+    // dictionary
+    std::vector<T> dict(data, data + n);
+    std::sort(dict.begin(), dict.end());
+    dict.erase(std::unique(dict.begin(), dict.end()), dict.end());
+    std::size_t dict_bytes = dict.size() * sizeof(T) + packed_bytes(n, width_of(dict.size() - 1));
+
+    std::size_t best = std::min({for_bytes, delta_bytes, dict_bytes, rle_bytes, n * sizeof(T)});
+    std::uint32_t residuals[block_size];
+    if(best == for_bytes)
+    {
+      b.codec = Codec::FrameOfReference;
+      b.width = width_of(range);
+      b.base = widen(b.min);
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        residuals[i] = static_cast<std::uint32_t>(widen(data[i]) - b.base);
+      }
+      pack_residuals(residuals, n, b.width);
+    }
+    else if(best == delta_bytes)
+    {
+      b.codec = Codec::Delta;
+      b.width = width_of(delta_range);
+      b.base = widen(data[0]);
+      b.step = U(min_d);
+      residuals[0] = 0;
+      for(std::size_t i = 1; i < n; ++i)
+      {
+        residuals[i] = static_cast<std::uint32_t>(widen(data[i]) - widen(data[i - 1]) - b.step);
+      }
+      pack_residuals(residuals, n, b.width);
+    }
+    else if(best == dict_bytes)
+    {
+      b.codec = Codec::Dictionary;
+      b.width = width_of(dict.size() - 1);
+      b.aux_count = static_cast<std::uint32_t>(dict.size());
+      values.insert(values.end(), dict.begin(), dict.end());
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        auto code = std::lower_bound(dict.begin(), dict.end(), data[i]) - dict.begin();
+        residuals[i] = static_cast<std::uint32_t>(code);
+      }
+      pack_residuals(residuals, n, b.width);
+    }
+    else if(best == rle_bytes)
+    {
+      b.codec = Codec::RunLength;
+      b.aux_count = static_cast<std::uint32_t>(runs);
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        if(i == 0 || data[i] != data[i - 1])
+        {
+          values.push_back(data[i]);
+          words.push_back(0);
+        }
+        ++words.back();
+      }
+    }
+    else
+    {
+      b.codec = Codec::Plain;
+      values.insert(values.end(), data, data + n);
+    }
+    blocks.push_back(b);
+  }
+
+  public:
+  CompressedColumn(T const* data, std::size_t n)
+    : rows(n)
+  {
+    for(std::size_t i = 0; i < n; i += block_size)
+    {
+      encode_block(data + i, std::min(block_size, n - i));
+    }
+  }
+
+  explicit CompressedColumn(std::vector<T> const& data)
+    : CompressedColumn(data.data(), data.size())
+  { }
+
+  std::size_t size() const
+  {
+    return rows;
+  }
+
+  std::size_t block_count() const
+  {
+    return blocks.size();
+  }
+
+  Codec block_codec(std::size_t b) const
+  {
+    return blocks[b].codec;
+  }
+
+  std::size_t compressed_bytes() const
+  {
+    return blocks.size() * sizeof(Block) + words.size() * sizeof(std::uint32_t)
+           + values.size() * sizeof(T);
+  }
+
+  // number of blocks encoded with each codec
+  std::array<std::size_t, 5> codec_histogram() const
+  {
+    std::array<std::size_t, 5> h{};
+    for(Block const& b : blocks)
+    {
+      ++h[static_cast<unsigned>(b.codec)];
+    }
+    return h;
+  }
+
+  // decodes block b into out, which must have room for block_size values; returns its size
+  std::size_t decode_block(std::size_t b, T* out) const
+  {
+    Block const& block = blocks[b];
+    std::size_t n = block.count;
+    std::uint32_t residuals[block_size];
+    switch(block.codec)
+    {
+    case Codec::FrameOfReference:
+      unpack_residuals(block, residuals);
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        out[i] = static_cast<T>(block.base + residuals[i]);
+      }
+      break;
+    case Codec::Delta:
+    {
+      unpack_residuals(block, residuals);
+      U v = block.base;
+      out[0] = static_cast<T>(v);
+      for(std::size_t i = 1; i < n; ++i)
+      {
+        v += block.step + residuals[i];
+        out[i] = static_cast<T>(v);
+      }
+      break;
+    }
+    case Codec::Dictionary:
+    {
+      unpack_residuals(block, residuals);
+      T const* dict = values.data() + block.values_at;
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        out[i] = dict[residuals[i]];
+      }
+      break;
+    }
+    case Codec::RunLength:
+      for(std::size_t r = 0; r < block.aux_count; ++r)
+      {
+        std::uint32_t length = words[block.words_at + r];
+        std::fill(out, out + length, values[block.values_at + r]);
+        out += length;
+      }
+      break;
+    case Codec::Plain:
+      std::memcpy(out, values.data() + block.values_at, n * sizeof(T));
+      break;
+    }
+    return n;
+  }
+
+  std::vector<T> decode() const
+  {
+    std::vector<T> out(rows + block_size);
+    std::size_t at = 0;
+    for(std::size_t b = 0; b < blocks.size(); ++b)
+    {
+      at += decode_block(b, out.data() + at);
+    }
+    out.resize(rows);
+    return out;
+  }
+
+  // calls f(values, n, first_row) for every block, decoded into a buffer that stays in cache
+  template <typename F>
+  void scan(F&& f) const
+  {
+    T buffer[block_size];
+    std::size_t first_row = 0;
+    for(std::size_t b = 0; b < blocks.size(); ++b)
+    {
+      std::size_t n = decode_block(b, buffer);
+      f(static_cast<T const*>(buffer), n, first_row);
+      first_row += n;
+    }
+  }
+
+  // number of values in [lo, hi]: blocks are skipped or accepted from their min/max when possible
+  std::size_t count_between(T lo, T hi) const
+  {
+    T buffer[block_size];
+    std::size_t count = 0;
+    for(std::size_t b = 0; b < blocks.size(); ++b)
+    {
+      Block const& block = blocks[b];
+      if(block.max < lo || hi < block.min)
+      {
+        continue;
+      }
+      if(lo <= block.min && block.max <= hi)
+      {
+        count += block.count;
+        continue;
+      }
+      if(block.codec == Codec::FrameOfReference)
+      {
+        // filter the residuals directly: [lo, hi] becomes [lo - base, hi - base] (clamped to the
+        // block by the tests above), and the comparisons work on 32-bit lanes
+        std::uint32_t residuals[block_size];
+        unpack_residuals(block, residuals);
+        auto rlo = static_cast<std::uint32_t>(widen(std::max(lo, block.min)) - block.base);
+        auto rhi = static_cast<std::uint32_t>(widen(std::min(hi, block.max)) - block.base);
+        count += ::count_between(static_cast<std::uint32_t const*>(residuals), block.count, rlo, rhi);
+        continue;
+      }
+      std::size_t n = decode_block(b, buffer);
+      count += ::count_between(static_cast<T const*>(buffer), n, lo, hi);
+    }
+    return count;
+  }
+};
+
+// compresses the I-th field of a table of Tuple rows; the field must have an integer type
+template <unsigned I, typename Row>
+CompressedColumn<FieldType<Row, I>> compress_field(std::vector<Row> const& rows)
+{
+  std::vector<FieldType<Row, I>> column;
+  column.reserve(rows.size());
+  for(Row const& row : rows)
+  {
+    column.push_back(get<I>(row));
+  }
+  return CompressedColumn<FieldType<Row, I>>(column);
+}
@@ -0,0 +1,93 @@
+#include "../bench/bench.hpp"
+#include "codecs.hpp"
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// (timestamp in us, user id, retries, http status, region)
+using Event = Tuple<long long, int, short, int, unsigned char>;
+
+std::vector<Event> make_events(std::size_t n)
+{
+  std::mt19937_64 rng(11);
+  std::vector<Event> rows;
+  rows.reserve(n);
+  long long ts = 1'700'000'000'000'000;
+  int const statuses[] = {200, 200, 200, 201, 404, 500, 503};
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    ts += rng() % 1000;
+    int user = 1'000'000 + static_cast<int>(rng() % 65536);
+    short retries = static_cast<short>(std::countr_zero(rng() | 0x80) / 2);
+    int status = statuses[rng() % 7];
+    auto region = static_cast<unsigned char>(i / 5000 % 16);
+    rows.emplace_back(ts, user, retries, status, region);
+  }
+  return rows;
+}
+
+template <unsigned I>
+void report(char const* name, std::vector<Event> const& rows)
+{
+  using T = FieldType<Event, I>;
+  auto column = compress_field<I>(rows);
+  std::vector<T> plain = column.decode();
+  bool exact = true;
+  for(std::size_t i = 0; i < rows.size(); ++i)
+  {
+    exact = exact && plain[i] == get<I>(rows[i]);
+  }
+
+  std::size_t raw = rows.size() * sizeof(T);
+  std::cout << std::left << std::setw(10) << name << std::right << std::setw(8)
+            << double(raw) / column.compressed_bytes() << "x  ";
+  auto histogram = column.codec_histogram();
+  for(unsigned c = 0; c < histogram.size(); ++c)
+  {
+    if(histogram[c])
+    {
+      std::cout << codec_name(static_cast<Codec>(c)) << ":" << histogram[c] << " ";
+    }
+  }
+  std::cout << (exact ? "" : "(DECODE MISMATCH)") << std::endl;
+
+  double decode_ms = time_ms([&] {
+    column.scan([](T const* values, std::size_t n, std::size_t) { do_not_optimize(values[n - 1]); });
+  });
+  // a filter on the middle of the value range, on the compressed and on the plain column
+  T lo = plain[plain.size() / 3], hi = plain[plain.size() / 2];
+  if(hi < lo)
+  {
+    std::swap(lo, hi);
+  }
+  std::size_t compressed_hits = 0, plain_hits = 0;
+  double filter_ms = time_ms([&] { compressed_hits = column.count_between(lo, hi); });
+  double plain_ms = time_ms([&] { plain_hits = count_between(plain.data(), plain.size(), lo, hi); });
+  std::cout << "          decode " << raw / decode_ms / 1e6 << " GB/s, filter "
+            << filter_ms << " ms (plain column: " << plain_ms << " ms)"
+            << (compressed_hits == plain_hits ? "" : " (FILTER MISMATCH)") << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  std::vector<int> small;
+  for(int i = 0; i < 1000; ++i)
+  {
+    small.push_back(100 + i % 7);
+  }
+  CompressedColumn<int> column(small);
+  std::cout << "1000 ints in a " << codec_name(column.block_codec(0)) << " block of "
+            << column.compressed_bytes() << " bytes, values in [102, 103]: "
+            << column.count_between(102, 103) << std::endl;
+
+  std::size_t n = size_arg(argc, argv, 10'000'000);
+  std::vector<Event> rows = make_events(n);
+  std::cout << "column    ratio     blocks per codec (" << n << " rows)" << std::endl;
+  report<0>("timestamp", rows);
+  report<1>("user", rows);
+  report<2>("retries", rows);
+  report<3>("status", rows);
+  report<4>("region", rows);
+  return 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "stringpool.hpp"
+#include <compare>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/*
+    Dictionary-encoded string field for tuples: Tuple<int, double, DictString> instead of
+    Tuple<int, double, std::string>. A DictString is a 32-bit code into a shared StringPool plus the
+    address of that pool. It is trivially copyable, never allocates, and copying a row copies
+    16 bytes instead of a std::string (and its heap buffer when the text does not fit the SSO).
+    - Two DictStrings of the same pool are equal iff their codes are: no character is compared.
+      Values of different pools fall back to comparing the text.
+    - The hash is the hash of the text, precomputed by the pool, so hashing is a single lookup and
+      equal strings of different pools still hash the same, as std::hash requires.
+    - The text is only decoded when it is needed, e.g. for printing or ordering.
+*/
+class DictString
+{
+  StringPool const* pool = nullptr;
+  std::uint32_t code = 0;
+
+  public:
+  // the empty string, not attached to any pool
+  DictString() = default;
+
+  DictString(StringPool& pool, std::string_view text)
+    : pool(&pool)
+    , code(pool.intern(text))
+  { }
+
+  StringPool const* get_pool() const
+  {
+    return pool;
+  }
+
+  std::uint32_t get_code() const
+  {
+    return code;
+  }
+
+  std::string_view view() const
+  {
+    return pool ? pool->view(code) : std::string_view{};
+  }
+
+  operator std::string_view() const
+  {
+    return view();
+  }
+
+  std::string str() const
+  {
+    return std::string(view());
+  }
+
+  std::uint64_t hash() const
+  {
+    return pool ? pool->hash(code) : std::hash<std::string_view>{}(std::string_view{});
+  }
+
+  friend bool operator==(DictString const& lhs, DictString const& rhs)
+  {
+    if(lhs.pool == rhs.pool)
+    {
+      return lhs.code == rhs.code;
+    }
+    return lhs.view() == rhs.view();
+  }
+
+  // codes are given in insertion order, so ordering has to look at the text
+  friend std::strong_ordering operator<=>(DictString const& lhs, DictString const& rhs)
+  {
+    return lhs.view() <=> rhs.view();
+  }
+
+  friend std::ostream& operator<<(std::ostream& strm, DictString const& s)
+  {
+    return strm << s.view();
+  }
+};
+
+template <>
+struct std::hash<DictString>
+{
+  std::size_t operator()(DictString const& s) const
+  {
+    return s.hash();
+  }
+};
@@ -0,0 +1,130 @@
+#include "../bench/bench.hpp"
+#include "../groupby/groupby.hpp"
+#include "../tuple/tupleio.hpp"
+#include "dictstring.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+// count every heap allocation made by the program, to compare the memory of the two layouts
+// (GCC flags free() on memory from operator new even when operator new itself calls malloc)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+static std::size_t allocations = 0;
+static std::size_t allocated_bytes = 0;
+
+void* operator new(std::size_t size)
+{
+  ++allocations;
+  allocated_bytes += size;
+  if(void* p = std::malloc(size ? size : 1))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  ::operator delete(p);
+}
+
+// 1000 distinct strings, long enough not to fit in the small string buffer of std::string
+std::vector<std::string> const& categories()
+{
+  static std::vector<std::string> names = [] {
+    std::vector<std::string> v;
+    for(int i = 0; i < 1000; ++i)
+    {
+      v.push_back("product-category-" + std::to_string(i));
+    }
+    return v;
+  }();
+  return names;
+}
+
+std::string const& category(std::size_t i)
+{
+  return categories()[i % categories().size()];
+}
+
+template <typename Row, typename Make>
+std::vector<Row> make_rows(char const* name, std::size_t n, Make make)
+{
+  std::size_t allocs = allocations, bytes = allocated_bytes;
+  std::vector<Row> rows;
+  rows.reserve(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    rows.push_back(make(i));
+  }
+  std::cout << "  " << name << ": sizeof(row) = " << sizeof(Row) << ", "
+            << allocations - allocs << " allocations, "
+            << (allocated_bytes - bytes) / (1 << 20) << " MiB" << std::endl;
+  return rows;
+}
+
+int main(int argc, char** argv)
+{
+  StringPool pool;
+  Tuple<int, double, DictString> t1(17, 3.14, DictString(pool, "Hello, World!"));
+  Tuple<int, double, DictString> t2(17, 3.14, DictString(pool, "Hello, World!"));
+  std::cout << std::boolalpha << "t1 is: " << t1 << std::endl;
+  std::cout << "t1 == t2 is: " << (t1 == t2) << ", both use code " << get<2>(t2).get_code()
+            << std::endl;
+
+  std::size_t n = size_arg(argc, argv, 10'000'000);
+  categories();
+  std::cout << "memory of " << n << " rows (1000 distinct strings):" << std::endl;
+  auto string_rows = make_rows<Tuple<int, double, std::string>>("std::string", n, [](std::size_t i) {
+    return Tuple<int, double, std::string>(int(i), 1.0 * i, category(i));
+  });
+  auto dict_rows = make_rows<Tuple<int, double, DictString>>("DictString ", n, [&](std::size_t i) {
+    return Tuple<int, double, DictString>(int(i), 1.0 * i, DictString(pool, category(i)));
+  });
+  std::cout << "  (the string pool holds " << pool.size() << " strings in "
+            << pool.memory_bytes() / 1024 << " KiB)" << std::endl;
+
+  std::cout << "scan: count rows where field 2 == \"" << category(42) << "\"" << std::endl;
+  std::string const wanted = category(42);
+  std::size_t hits = 0;
+  double string_ms = time_ms([&] {
+    hits = 0;
+    for(auto const& row : string_rows)
+    {
+      hits += get<2>(row) == wanted;
+    }
+  });
+  std::cout << "  std::string: " << string_ms << " ms, " << hits << " hits" << std::endl;
+  double dict_ms = time_ms([&] {
+    // the probe is encoded once, then every row is a 32-bit compare
+    DictString probe(pool, wanted);
+    hits = 0;
+    for(auto const& row : dict_rows)
+    {
+      hits += get<2>(row) == probe;
+    }
+  });
+  std::cout << "  DictString:  " << dict_ms << " ms, " << hits << " hits" << std::endl;
+
+  std::cout << "GROUP BY field 2, COUNT(*):" << std::endl;
+  double group_string_ms =
+    time_ms([&] { do_not_optimize(group_by<2>(string_rows, make_Tuple(Count{})).size()); });
+  std::cout << "  std::string: " << group_string_ms << " ms" << std::endl;
+  double group_dict_ms =
+    time_ms([&] { do_not_optimize(group_by<2>(dict_rows, make_Tuple(Count{})).size()); });
+  std::cout << "  DictString:  " << group_dict_ms << " ms" << std::endl;
+
+  std::cout << "copy all the rows:" << std::endl;
+  double copy_string_ms = time_ms([&] { do_not_optimize(std::vector(string_rows).size()); });
+  std::cout << "  std::string: " << copy_string_ms << " ms" << std::endl;
+  double copy_dict_ms = time_ms([&] { do_not_optimize(std::vector(dict_rows).size()); });
+  std::cout << "  DictString:  " << copy_dict_ms << " ms" << std::endl;
+  return 0;
+}
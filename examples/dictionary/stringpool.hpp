@@ -0,0 +1,156 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+    Append-only pool of distinct strings. Each string is stored once and identified by a dense 32-bit
+    code, handed out in insertion order. Strings are never removed or moved, so a code (and the
+    string_view it decodes to) stays valid for the lifetime of the pool.
+    intern() takes a lock, since it may append. view() and hash() do not: the entries live in
+    segments of doubling size that are never reallocated, so decoding a code is two array accesses,
+    and it is safe while another thread is interning (as long as the code was obtained through some
+    synchronization with the thread that interned it, as is always the case in practice).
+*/
+class StringPool
+{
+  struct Entry
+  {
+    std::string_view text;
+    std::uint64_t hash; // std::hash<std::string_view> of text, computed once
+  };
+
+  // segment s holds first_segment << s entries, so 32 segments cover every 32-bit code
+  static constexpr std::size_t first_segment = 64;
+  static constexpr std::size_t max_segments = 32;
+  // the characters of the strings are copied in chunks of at least this many bytes
+  static constexpr std::size_t chunk_size = 64 * 1024;
+
+  std::atomic<Entry*> segments[max_segments] = {};
+  std::atomic<std::uint32_t> count{0};
+
+  mutable std::mutex mutex; // guards everything below, i.e. the writer's side
+  std::unordered_map<std::string_view, std::uint32_t> codes;
+  std::vector<std::unique_ptr<Entry[]>> owned_segments;
+  std::vector<std::unique_ptr<char[]>> chunks;
+  char* chunk_pos = nullptr;
+  std::size_t chunk_left = 0;
+  std::size_t bytes = 0;
+
+  static std::size_t segment_of(std::uint32_t code)
+  {
+    return std::bit_width(code / first_segment + 1) - 1;
+  }
+
+  static std::size_t offset_in_segment(std::uint32_t code, std::size_t segment)
+  {
+    return code - first_segment * ((std::size_t(1) << segment) - 1);
+  }
+
+  Entry const& entry(std::uint32_t code) const
+  {
+    std::size_t s = segment_of(code);
+    return segments[s].load(std::memory_order_acquire)[offset_in_segment(code, s)];
+  }
+
+  // copies the characters into the current chunk (or a new one) and returns the stable copy
+  std::string_view store(std::string_view s)
+  {
+    if(s.empty())
+    {
+      // nothing to copy, and there may be no chunk yet: memcpy wants valid pointers even for 0 bytes
+      return std::string_view();
+    }
+    if(s.size() > chunk_left)
+    {
+      std::size_t size = std::max(chunk_size, s.size());
+      chunks.emplace_back(new char[size]);
+      chunk_pos = chunks.back().get();
+      chunk_left = size;
+      bytes += size;
+    }
+    std::memcpy(chunk_pos, s.data(), s.size());
+    std::string_view copy(chunk_pos, s.size());
+    chunk_pos += s.size();
+    chunk_left -= s.size();
+    return copy;
+  }
+
+  public:
+  StringPool() = default;
+  StringPool(StringPool const&) = delete;
+  StringPool& operator=(StringPool const&) = delete;
+
+  // the code of s, adding s to the pool if it is not there yet
+  std::uint32_t intern(std::string_view s)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(auto it = codes.find(s); it != codes.end())
+    {
+      return it->second;
+    }
+    std::uint32_t code = count.load(std::memory_order_relaxed);
+    if(code == std::numeric_limits<std::uint32_t>::max())
+    {
+      throw std::length_error("StringPool: too many distinct strings");
+    }
+    std::size_t seg = segment_of(code);
+    if(seg == owned_segments.size())
+    {
+      owned_segments.emplace_back(new Entry[first_segment << seg]);
+      bytes += (first_segment << seg) * sizeof(Entry);
+      segments[seg].store(owned_segments.back().get(), std::memory_order_release);
+    }
+    std::string_view text = store(s);
+    owned_segments[seg][offset_in_segment(code, seg)] = {text, std::hash<std::string_view>{}(text)};
+    codes.emplace(text, code);
+    count.store(code + 1, std::memory_order_release);
+    return code;
+  }
+
+  // the code of s, if s was interned
+  std::optional<std::uint32_t> find(std::string_view s) const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(auto it = codes.find(s); it != codes.end())
+    {
+      return it->second;
+    }
+    return std::nullopt;
+  }
+
+  std::string_view view(std::uint32_t code) const
+  {
+    return entry(code).text;
+  }
+
+  std::uint64_t hash(std::uint32_t code) const
+  {
+    return entry(code).hash;
+  }
+
+  // number of distinct strings
+  std::size_t size() const
+  {
+    return count.load(std::memory_order_acquire);
+  }
+
+  // bytes held by the characters and the entries (the lookup map is not included)
+  std::size_t memory_bytes() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+  }
+};
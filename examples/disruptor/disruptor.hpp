@@ -0,0 +1,344 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/*
+    A multicast ring in the style of the LMAX Disruptor: one producer, any number of consumers, and
+    every consumer sees every event, from a single pre-allocated array instead of a queue per consumer.
+    - Events are trivially copyable (typically Tuples of numbers) and written in place: the producer
+      claims sequence numbers, fills ring[s] and publishes up to the last one claimed, by storing it
+      in the cursor. claim(n) and publish() work on batches: one store, and one wake-up if any, for
+      n events.
+    - Each consumer owns a Sequence, the last event it is done with, and reads through a Barrier: the
+      events it may read are those published and already processed by the consumers it depends on.
+      With no dependency a consumer follows the producer; with some it forms a later stage (persist
+      only what was journaled), and a stage takes at once everything that is available, a batch.
+    - The producer never overtakes the consumers: it waits for the slowest of the gating sequences,
+      those of the last stage, before reusing a slot.
+    Sequences are 64-bit and never wrap; each sits alone on its cache line, written by one thread only.
+    Nothing is locked, and there is no atomic read-modify-write on the way of an event.
+    How a consumer waits for events is the Wait policy:
+    - BusySpinWait spins: the lowest latency, and a core per consumer, useless with fewer cores than
+      threads;
+    - YieldingWait spins a little, then yields the core between checks;
+    - BlockingWait sleeps on a futex (std::atomic::wait, a futex on Linux) once nothing is available,
+      and the producer and the stages wake the sleepers after publishing; while nobody sleeps, that is
+      one load more per batch.
+    halt() tells the consumers to return once they have processed everything published.
+*/
+
+inline void cpu_relax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#endif
+}
+
+// a sequence number alone on its cache line: the producer's cursor, or how far a consumer has got
+struct alignas(64) Sequence
+{
+  std::atomic<std::int64_t> value{-1};
+
+  std::int64_t get() const noexcept
+  {
+    return value.load(std::memory_order_acquire);
+  }
+
+  void set(std::int64_t v) noexcept
+  {
+    value.store(v, std::memory_order_release);
+  }
+};
+
+// available() is the last sequence that may be read; the waits return once it reaches seq, or halted
+class BusySpinWait
+{
+  public:
+  template <typename Available>
+  std::int64_t wait_for(std::int64_t seq, Available const& available, std::atomic<bool> const& halted)
+  {
+    std::int64_t a;
+    while((a = available()) < seq && !halted.load(std::memory_order_relaxed))
+    {
+      cpu_relax();
+    }
+    return a;
+  }
+
+  void signal() noexcept
+  { }
+
+  void signal_all() noexcept
+  { }
+};
+
+class YieldingWait
+{
+  public:
+  template <typename Available>
+  std::int64_t wait_for(std::int64_t seq, Available const& available, std::atomic<bool> const& halted)
+  {
+    std::int64_t a;
+    for(unsigned spins = 0; (a = available()) < seq && !halted.load(std::memory_order_relaxed); ++spins)
+    {
+      if(spins < 100)
+      {
+        cpu_relax();
+      }
+      else
+      {
+        std::this_thread::yield();
+      }
+    }
+    return a;
+  }
+
+  void signal() noexcept
+  { }
+
+  void signal_all() noexcept
+  { }
+};
+
+/*
+    A consumer registers as a sleeper, then reads the epoch, then checks for events; a publisher
+    stores its sequence, then checks for sleepers, and bumps the epoch and wakes them if there are
+    any. The two fences order each side's store before its load, so that either the publisher sees
+    the sleeper or the sleeper sees the events; and a bump between the sleeper's read of the epoch
+    and its wait() makes the wait return at once.
+*/
+class BlockingWait
+{
+  std::atomic<std::uint32_t> epoch{0};
+  std::atomic<std::uint32_t> sleepers{0};
+
+  public:
+  template <typename Available>
+  std::int64_t wait_for(std::int64_t seq, Available const& available, std::atomic<bool> const& halted)
+  {
+    std::int64_t a = available();
+    if(a >= seq)
+    {
+      return a;
+    }
+    sleepers.fetch_add(1, std::memory_order_relaxed);
+    while(true)
+    {
+      std::uint32_t e = epoch.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if((a = available()) >= seq || halted.load(std::memory_order_relaxed))
+      {
+        break;
+      }
+      epoch.wait(e, std::memory_order_acquire);
+    }
+    sleepers.fetch_sub(1, std::memory_order_relaxed);
+    return a;
+  }
+
+  void signal() noexcept
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(sleepers.load(std::memory_order_relaxed) != 0)
+    {
+      signal_all();
+    }
+  }
+
+  void signal_all() noexcept
+  {
+    epoch.fetch_add(1, std::memory_order_release);
+    epoch.notify_all();
+  }
+};
+
+template <typename Event, typename Wait = YieldingWait>
+class MulticastRing
+{
+  static_assert(std::is_trivially_copyable_v<Event>, "events are copied as bytes");
+
+  std::unique_ptr<Event[]> slots;
+  std::int64_t size;
+  Sequence cursor; // the last sequence published
+  std::vector<Sequence const*> gating;
+  std::atomic<bool> halted{false};
+  Wait wait;
+
+  // the producer's own, on a line of their own
+  struct alignas(64)
+  {
+    std::int64_t claimed = -1;
+    std::int64_t slowest = -1; // the slowest gating sequence, when last read
+  } producer;
+
+  std::int64_t slowest_gating() const noexcept
+  {
+    std::int64_t slowest = cursor.value.load(std::memory_order_relaxed);
+    for(Sequence const* s : gating)
+    {
+      slowest = std::min(slowest, s->get());
+    }
+    return slowest;
+  }
+
+  public:
+  // what a consumer may read: published, and done with by the consumers it depends on
+  class Barrier
+  {
+    MulticastRing* ring;
+    std::vector<Sequence const*> dependencies;
+
+    std::int64_t available() const noexcept
+    {
+      std::int64_t a = ring->cursor.get();
+      for(Sequence const* s : dependencies)
+      {
+        a = std::min(a, s->get());
+      }
+      return a;
+    }
+
+    public:
+    Barrier(MulticastRing& ring, std::initializer_list<Sequence const*> dependencies)
+      : ring(&ring)
+      , dependencies(dependencies)
+    { }
+
+    // the last sequence available, at least seq unless the ring is halted
+    std::int64_t wait_for(std::int64_t seq) const
+    {
+      return ring->wait.wait_for(seq, [this] { return available(); }, ring->halted);
+    }
+  };
+
+  // capacity is a power of two
+  explicit MulticastRing(std::size_t capacity)
+    : slots(new Event[capacity])
+    , size(std::int64_t(capacity))
+  {
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  }
+
+  MulticastRing(MulticastRing const&) = delete;
+  MulticastRing& operator=(MulticastRing const&) = delete;
+
+  std::size_t capacity() const noexcept
+  {
+    return std::size_t(size);
+  }
+
+  Event& operator[](std::int64_t seq) noexcept
+  {
+    return slots[seq & (size - 1)];
+  }
+
+  Event const& operator[](std::int64_t seq) const noexcept
+  {
+    return slots[seq & (size - 1)];
+  }
+
+  // the sequences of the last stage, which the producer must not overtake; before producing
+  void add_gating(Sequence const& consumer)
+  {
+    gating.push_back(&consumer);
+  }
+
+  Barrier barrier(std::initializer_list<Sequence const*> dependencies = {})
+  {
+    return Barrier(*this, dependencies);
+  }
+
+  // claims the next n slots and returns the last sequence claimed; by the producer only
+  std::int64_t claim(std::int64_t n = 1)
+  {
+    assert(n > 0 && n <= size && !gating.empty());
+    std::int64_t last = producer.claimed + n;
+    while(last - size > producer.slowest)
+    {
+      producer.slowest = slowest_gating();
+      if(last - size > producer.slowest)
+      {
+        std::this_thread::yield();
+      }
+    }
+    producer.claimed = last;
+    return last;
+  }
+
+  // makes every event up to last visible to the consumers
+  void publish(std::int64_t last) noexcept
+  {
+    cursor.set(last);
+    wait.signal();
+  }
+
+  std::int64_t published() const noexcept
+  {
+    return cursor.get();
+  }
+
+  // called by a consumer after moving its sequence, for the stages waiting on it
+  void signal() noexcept
+  {
+    wait.signal();
+  }
+
+  // once the producer is done: consumers return when they have processed all that was published
+  void halt() noexcept
+  {
+    halted.store(true, std::memory_order_seq_cst);
+    wait.signal_all();
+  }
+
+  bool is_halted() const noexcept
+  {
+    return halted.load(std::memory_order_acquire);
+  }
+};
+
+/*
+    Runs a consumer: handler(event, sequence, end_of_batch) for every event, in order, as soon as the
+    barrier makes it available, and then moves the consumer's sequence past the whole batch. Returns
+    when the ring is halted and everything published went through the handler.
+*/
+template <typename Event, typename Wait, typename Handler>
+void consume(MulticastRing<Event, Wait>& ring,
+             typename MulticastRing<Event, Wait>::Barrier const& barrier,
+             Sequence& sequence,
+             Handler&& handler)
+{
+  std::int64_t next = sequence.get() + 1;
+  while(true)
+  {
+    std::int64_t available = barrier.wait_for(next);
+    if(available < next)
+    {
+      if(ring.is_halted())
+      {
+        if(next > ring.published())
+        {
+          return;
+        }
+        std::this_thread::yield(); // an earlier stage is still draining
+      }
+      continue;
+    }
+    for(; next <= available; ++next)
+    {
+      handler(static_cast<Event const&>(ring[next]), next, next == available);
+    }
+    sequence.set(available);
+    ring.signal();
+  }
+}
@@ -0,0 +1,297 @@
+#include "../bench/bench.hpp"
+#include "../bench/histogram.hpp"
+#include "../tuple/tuple.hpp"
+#include "disruptor.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    A journal and an aggregation follow the producer side by side, and a persistence stage follows the
+    journal. Then 1 producer and 4 consumers: the throughput with each wait policy against a locked
+    queue per consumer that every event is copied into, and the latency from publication to each
+    consumer, one event at a time. Busy spinning is only measured with a core for each of the 5
+    threads.
+*/
+
+// timestamp (ns), instrument, price, quantity
+using Trade = Tuple<std::int64_t, std::uint32_t, double, double>;
+
+constexpr std::uint32_t instruments = 16;
+
+inline std::int64_t now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+Trade make_trade(std::int64_t i)
+{
+  return Trade(now_ns(), std::uint32_t(i % instruments), 100 + double(i % 7), double(1 + i % 5));
+}
+
+void stages(std::size_t n)
+{
+  MulticastRing<Trade, YieldingWait> ring(1024);
+  Sequence journaled, aggregated, persisted;
+  ring.add_gating(aggregated);
+  ring.add_gating(persisted);
+
+  std::uint64_t checksum = 0;
+  std::vector<double> notional(instruments);
+  std::size_t batches = 0, persisted_events = 0;
+
+  std::thread journal([&] {
+    consume(ring, ring.barrier(), journaled, [&](Trade const& t, std::int64_t, bool) {
+      std::uint64_t bits;
+      std::memcpy(&bits, &get<2>(t), sizeof(bits));
+      checksum = checksum * 31 + bits + get<1>(t);
+    });
+  });
+  std::thread aggregate([&] {
+    consume(ring, ring.barrier(), aggregated, [&](Trade const& t, std::int64_t, bool) {
+      notional[get<1>(t)] += get<2>(t) * get<3>(t);
+    });
+  });
+  std::thread persist([&] {
+    auto barrier = ring.barrier({&journaled});
+    consume(ring, barrier, persisted, [&](Trade const&, std::int64_t, bool end_of_batch) {
+      ++persisted_events;
+      batches += end_of_batch;
+    });
+  });
+
+  for(std::size_t i = 0; i < n; i += 16)
+  {
+    std::int64_t count = std::int64_t(std::min<std::size_t>(16, n - i));
+    std::int64_t last = ring.claim(count);
+    for(std::int64_t s = last - count + 1; s <= last; ++s)
+    {
+      ring[s] = make_trade(s);
+    }
+    ring.publish(last);
+  }
+  ring.halt();
+  journal.join();
+  aggregate.join();
+  persist.join();
+
+  double total = 0;
+  for(double x : notional)
+  {
+    total += x;
+  }
+  std::cout << n << " trades: journal checksum " << checksum % 100'000 << ", notional " << total
+            << ", persisted " << persisted_events << " after the journal, in " << batches << " batches"
+            << std::endl;
+}
+
+// the approach replaced: a locked queue per consumer, each event copied into every one
+template <typename Event>
+class LockedQueue
+{
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::vector<Event> items;
+  bool closed = false;
+
+  public:
+  void push(Event const& event)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      items.push_back(event);
+    }
+    ready.notify_one();
+  }
+
+  // swaps everything queued into out; false once closed and drained
+  bool pop_all(std::vector<Event>& out)
+  {
+    out.clear();
+    std::unique_lock<std::mutex> lock(mutex);
+    ready.wait(lock, [&] { return !items.empty() || closed; });
+    out.swap(items);
+    return !out.empty();
+  }
+
+  void close()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      closed = true;
+    }
+    ready.notify_all();
+  }
+};
+
+constexpr unsigned consumers = 4;
+
+double queues_ms(std::size_t n, double& check)
+{
+  return time_ms([&] {
+    std::vector<LockedQueue<Trade>> queues(consumers);
+    std::vector<double> sums(consumers);
+    std::vector<std::thread> threads;
+    for(unsigned c = 0; c < consumers; ++c)
+    {
+      threads.emplace_back([&, c] {
+        std::vector<Trade> batch;
+        while(queues[c].pop_all(batch))
+        {
+          for(Trade const& t : batch)
+          {
+            sums[c] += get<3>(t);
+          }
+        }
+      });
+    }
+    for(std::size_t i = 0; i < n; ++i)
+    {
+      Trade t = make_trade(std::int64_t(i));
+      for(auto& q : queues)
+      {
+        q.push(t);
+      }
+    }
+    for(auto& q : queues)
+    {
+      q.close();
+    }
+    for(auto& th : threads)
+    {
+      th.join();
+    }
+    check = sums[0] + sums[consumers - 1];
+  });
+}
+
+template <typename Wait>
+double ring_ms(std::size_t n, double& check)
+{
+  return time_ms([&] {
+    MulticastRing<Trade, Wait> ring(4096);
+    std::vector<Sequence> sequences(consumers);
+    std::vector<double> sums(consumers);
+    std::vector<std::thread> threads;
+    for(unsigned c = 0; c < consumers; ++c)
+    {
+      ring.add_gating(sequences[c]);
+    }
+    for(unsigned c = 0; c < consumers; ++c)
+    {
+      threads.emplace_back([&, c] {
+        consume(ring, ring.barrier(), sequences[c], [&](Trade const& t, std::int64_t, bool) {
+          sums[c] += get<3>(t);
+        });
+      });
+    }
+    for(std::size_t i = 0; i < n; i += 64)
+    {
+      std::int64_t count = std::int64_t(std::min<std::size_t>(64, n - i));
+      std::int64_t last = ring.claim(count);
+      for(std::int64_t s = last - count + 1; s <= last; ++s)
+      {
+        ring[s] = make_trade(s);
+      }
+      ring.publish(last);
+    }
+    ring.halt();
+    for(auto& th : threads)
+    {
+      th.join();
+    }
+    check = sums[0] + sums[consumers - 1];
+  });
+}
+
+// one event at a time, the next published once every consumer has seen the previous one
+template <typename Wait>
+void latency(char const* name, std::size_t n)
+{
+  MulticastRing<Trade, Wait> ring(1024);
+  std::vector<Sequence> sequences(consumers);
+  std::vector<LatencyHistogram> histograms(consumers);
+  std::vector<std::thread> threads;
+  for(unsigned c = 0; c < consumers; ++c)
+  {
+    ring.add_gating(sequences[c]);
+  }
+  for(unsigned c = 0; c < consumers; ++c)
+  {
+    threads.emplace_back([&, c] {
+      consume(ring, ring.barrier(), sequences[c], [&](Trade const& t, std::int64_t, bool) {
+        histograms[c].record(std::uint64_t(now_ns() - get<0>(t)));
+      });
+    });
+  }
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    std::int64_t s = ring.claim();
+    ring[s] = make_trade(s);
+    ring.publish(s);
+    for(Sequence const& consumer : sequences)
+    {
+      while(consumer.get() < s)
+      {
+        std::this_thread::yield();
+      }
+    }
+  }
+  ring.halt();
+  for(auto& th : threads)
+  {
+    th.join();
+  }
+  LatencyHistogram all;
+  for(auto const& h : histograms)
+  {
+    all.merge(h);
+  }
+  std::cout << "  " << name << ": ";
+  all.print(std::cout);
+  std::cout << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t n = size_arg(argc, argv, 1'000'000);
+  bool spin = hardware_threads() > consumers;
+
+  stages(std::max<std::size_t>(n / 10, 1000));
+
+  double check_queues, check_yield, check_block, check_spin = 0;
+  double queues = queues_ms(n, check_queues);
+  double yield = ring_ms<YieldingWait>(n, check_yield);
+  double block = ring_ms<BlockingWait>(n, check_block);
+  double busy = spin ? ring_ms<BusySpinWait>(n, check_spin) : 0;
+  bool same = check_yield == check_queues && check_block == check_queues &&
+              (!spin || check_spin == check_queues);
+  std::cout << "1 producer, " << consumers << " consumers, " << n
+            << " events, millions per second: queue per consumer " << double(n) / queues / 1e3
+            << ", ring yielding " << double(n) / yield / 1e3 << ", blocking "
+            << double(n) / block / 1e3;
+  if(spin)
+  {
+    std::cout << ", busy spinning " << double(n) / busy / 1e3;
+  }
+  std::cout << (same ? "" : " (CONSUMERS DISAGREE)") << std::endl;
+
+  std::size_t samples = std::max<std::size_t>(n / 100, 1000);
+  std::cout << "latency from publication to consumer, " << samples << " events:" << std::endl;
+  latency<YieldingWait>("yielding", samples);
+  latency<BlockingWait>("blocking", samples);
+  if(spin)
+  {
+    latency<BusySpinWait>("busy spinning", samples);
+  }
+  return 0;
+}
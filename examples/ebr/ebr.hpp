@@ -0,0 +1,240 @@
+#pragma once
+#include "../rcu/threadslots.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+/*
+    Epoch-based reclamation, for lock-free structures whose nodes are unlinked by one thread while
+    others may still be reading them. A node unlinked cannot be freed at once; EBR frees it once every
+    thread that could have seen it has moved on, tracked with a global epoch instead of a mark per
+    node (hazard pointers) or a count per node (reference counting).
+    - A thread reads the structure inside a guard, pin(): it copies the global epoch into its record,
+      a cache line of its own, with a fence. Pinning costs that store and fence, whatever the number
+      of nodes read, where hazard pointers cost a store, a fence and a reload per node.
+    - A node unlinked is retired with the epoch current then, into the limbo list of that epoch in
+      the thread's record: three lists, since a node retired at epoch e is only freed once the epoch
+      has reached e + 2, by which time every thread pinned at e or before has unpinned.
+    - The epoch advances once every pinned thread has been seen at the current one. Retirement is
+      batched: every batch retirements, the thread tries to advance the epoch and frees the lists old
+      enough, so the scan of the records and the frees are paid per batch, not per node.
+    - Garbage is bounded: a thread leaving its outermost guard with more than max_garbage nodes in
+      limbo advances and collects until it is back under it, waiting (yielding) for the threads
+      pinned at older epochs. A thread stalled inside a guard stops reclamation for all; the bound
+      turns the memory growth that would follow into back-pressure on the threads retiring.
+    Records are a ThreadSlots (rcu/threadslots.hpp), for at most max_threads threads at once. The limbo
+    lists of a thread that finishes stay in its record, for the next thread to get its slot, and
+    whatever is left is freed with the domain.
+*/
+
+class EpochDomain
+{
+  struct Retired
+  {
+    void* object;
+    void (*free)(void* object);
+  };
+
+  struct alignas(64) Record
+  {
+    std::atomic<std::uint64_t> state{0}; // epoch << 1 | pinned
+    std::atomic<std::size_t> garbage{0}; // written by the owner only, read by anyone
+    unsigned depth = 0;                  // of nested guards
+    std::size_t since_collect = 0;
+    std::uint64_t epochs[3] = {};
+    std::vector<Retired> limbo[3]; // limbo[e % 3] holds the nodes retired at epochs[e % 3]
+  };
+
+  std::atomic<std::uint64_t> epoch{1};
+  ThreadSlots<Record> records;
+  std::size_t max_garbage;
+
+  static constexpr std::size_t batch = 64;
+
+  Record& own_record()
+  {
+    Record* r = records.own();
+    if(r == nullptr)
+    {
+      throw std::length_error("EpochDomain: more threads than max_threads");
+    }
+    return *r;
+  }
+
+  static void free_list(Record& r, unsigned list) noexcept
+  {
+    for(Retired const& retired : r.limbo[list])
+    {
+      retired.free(retired.object);
+    }
+    r.garbage.store(r.garbage.load(std::memory_order_relaxed) - r.limbo[list].size(),
+                    std::memory_order_relaxed);
+    r.limbo[list].clear();
+  }
+
+  // frees the lists of r retired two epochs ago or more
+  void collect(Record& r) noexcept
+  {
+    std::uint64_t e = epoch.load(std::memory_order_acquire);
+    for(unsigned list = 0; list < 3; ++list)
+    {
+      if(!r.limbo[list].empty() && r.epochs[list] + 2 <= e)
+      {
+        free_list(r, list);
+      }
+    }
+  }
+
+  // advances the epoch if every pinned thread has been seen at the current one
+  void try_advance() noexcept
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::uint64_t e = epoch.load(std::memory_order_relaxed);
+    unsigned used = records.used();
+    for(unsigned i = 0; i < used; ++i)
+    {
+      std::uint64_t state = records[i].state.load(std::memory_order_acquire);
+      if((state & 1) != 0 && (state >> 1) != e)
+      {
+        return;
+      }
+    }
+    epoch.compare_exchange_strong(e, e + 1, std::memory_order_acq_rel);
+  }
+
+  // outside any guard: collects until r holds at most limit nodes
+  void reclaim(Record& r, std::size_t limit) noexcept
+  {
+    collect(r);
+    while(r.garbage.load(std::memory_order_relaxed) > limit)
+    {
+      std::this_thread::yield();
+      try_advance();
+      collect(r);
+    }
+  }
+
+  void unpin(Record& r) noexcept
+  {
+    if(--r.depth != 0)
+    {
+      return;
+    }
+    r.state.store(r.state.load(std::memory_order_relaxed) & ~std::uint64_t(1),
+                  std::memory_order_release);
+    if(r.garbage.load(std::memory_order_relaxed) > max_garbage)
+    {
+      reclaim(r, max_garbage);
+    }
+  }
+
+  public:
+  // a pinned section: nodes read from the structure stay allocated until the guard is destroyed
+  class Guard
+  {
+    friend class EpochDomain;
+
+    EpochDomain* domain;
+    Record* record;
+
+    explicit Guard(EpochDomain& d)
+      : domain(&d)
+      , record(&d.own_record())
+    {
+      if(record->depth++ == 0)
+      {
+        std::uint64_t e = domain->epoch.load(std::memory_order_relaxed);
+        record->state.store(e << 1 | 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+      }
+    }
+
+    public:
+    Guard(Guard const&) = delete;
+    Guard& operator=(Guard const&) = delete;
+
+    ~Guard()
+    {
+      domain->unpin(*record);
+    }
+
+    // object, unlinked from the structure, freed by free(object) once no thread can read it
+    void retire(void* object, void (*free)(void*))
+    {
+      Record& r = *record;
+      std::uint64_t e = domain->epoch.load(std::memory_order_acquire);
+      unsigned list = unsigned(e % 3);
+      if(r.epochs[list] != e)
+      {
+        // retired at e - 3 or before, so already safe
+        free_list(r, list);
+        r.epochs[list] = e;
+      }
+      r.limbo[list].push_back(Retired{object, free});
+      r.garbage.store(r.garbage.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      if(++r.since_collect == batch)
+      {
+        r.since_collect = 0;
+        domain->try_advance();
+        domain->collect(r);
+      }
+    }
+
+    template <typename T>
+    void retire(T* object)
+    {
+      retire(object, [](void* p) { delete static_cast<T*>(p); });
+    }
+  };
+
+  explicit EpochDomain(unsigned max_threads = 256, std::size_t max_garbage = 16 * batch)
+    : records(max_threads)
+    , max_garbage(max_garbage)
+  { }
+
+  EpochDomain(EpochDomain const&) = delete;
+  EpochDomain& operator=(EpochDomain const&) = delete;
+
+  // no thread may be pinned
+  ~EpochDomain()
+  {
+    for(unsigned i = 0; i < records.used(); ++i)
+    {
+      for(unsigned list = 0; list < 3; ++list)
+      {
+        free_list(records[i], list);
+      }
+    }
+  }
+
+  // throws std::length_error past max_threads threads
+  Guard pin()
+  {
+    return Guard(*this);
+  }
+
+  // outside any guard: waits until everything the calling thread retired is freed
+  void synchronize()
+  {
+    reclaim(own_record(), 0);
+  }
+
+  std::uint64_t current_epoch() const noexcept
+  {
+    return epoch.load(std::memory_order_relaxed);
+  }
+
+  // the nodes retired and not freed yet, over all threads
+  std::size_t garbage() const noexcept
+  {
+    std::size_t total = 0;
+    for(unsigned i = 0; i < records.used(); ++i)
+    {
+      total += records[i].garbage.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+};
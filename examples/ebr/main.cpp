@@ -0,0 +1,354 @@
+#include "../bench/bench.hpp"
+#include "../parallel/runonthreads.hpp"
+#include "../rcu/threadslots.hpp"
+#include "../tuple/tuple.hpp"
+#include "../variant/variant.hpp"
+#include "ebr.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+    A Treiber stack, the simplest lock-free structure that needs reclamation: pop() reads head->next
+    of a node another thread may pop and free at the same time. Its nodes hold a Variant of a number
+    or a Tuple. First a stress run, threads pushing and popping at random with every value accounted
+    for, then a thread stalled inside a guard while another retires nodes, held back by the bound on
+    garbage. Last, push/pop pairs per second with EBR, with hazard pointers (one per thread, so a
+    store, a fence and a reload per node popped, and a scan of all of them per batch of retired
+    nodes) and with a mutex.
+*/
+
+using Value = Variant<std::uint64_t, Tuple<std::uint64_t, std::uint64_t>>;
+
+std::uint64_t key(Value const& v)
+{
+  return v.visit<std::uint64_t>([](auto const& x) {
+    if constexpr(std::is_same_v<std::remove_cvref_t<decltype(x)>, std::uint64_t>)
+    {
+      return x;
+    }
+    else
+    {
+      return get<0>(x) + get<1>(x);
+    }
+  });
+}
+
+Value make_value(std::uint64_t k)
+{
+  if(k % 2 == 0)
+  {
+    return Value(k);
+  }
+  return Value(Tuple<std::uint64_t, std::uint64_t>(k / 2, k - k / 2));
+}
+
+struct StackNode
+{
+  Value value;
+  StackNode* next;
+};
+
+// the nodes of a Treiber stack, pushed and popped by CAS on head
+class StackBase
+{
+  protected:
+  std::atomic<StackNode*> head{nullptr};
+
+  public:
+  StackBase() = default;
+  StackBase(StackBase const&) = delete;
+  StackBase& operator=(StackBase const&) = delete;
+
+  ~StackBase()
+  {
+    for(StackNode* n = head.load(); n != nullptr;)
+    {
+      StackNode* next = n->next;
+      delete n;
+      n = next;
+    }
+  }
+
+  void push(Value value)
+  {
+    auto* n = new StackNode{std::move(value), head.load(std::memory_order_relaxed)};
+    while(!head.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed))
+    { }
+  }
+};
+
+class EbrStack : public StackBase
+{
+  EpochDomain& domain;
+
+  public:
+  explicit EbrStack(EpochDomain& domain)
+    : domain(domain)
+  { }
+
+  std::optional<Value> pop()
+  {
+    auto guard = domain.pin();
+    StackNode* n = head.load(std::memory_order_acquire);
+    while(n != nullptr &&
+          !head.compare_exchange_weak(n, n->next, std::memory_order_acquire, std::memory_order_acquire))
+    { }
+    if(n == nullptr)
+    {
+      return std::nullopt;
+    }
+    std::optional<Value> value(std::move(n->value));
+    guard.retire(n);
+    return value;
+  }
+};
+
+// the baseline: a hazard pointer per thread, and a list of retired nodes scanned every batch
+class HazardStack : public StackBase
+{
+  struct alignas(64) Record
+  {
+    std::atomic<StackNode*> hazard{nullptr};
+    std::vector<StackNode*> retired;
+  };
+
+  ThreadSlots<Record> records{256};
+
+  Record& own_record()
+  {
+    return *records.own();
+  }
+
+  void scan(Record& r)
+  {
+    std::vector<StackNode*> hazards;
+    for(unsigned i = 0; i < records.used(); ++i)
+    {
+      if(StackNode* h = records[i].hazard.load())
+      {
+        hazards.push_back(h);
+      }
+    }
+    std::sort(hazards.begin(), hazards.end());
+    auto kept = std::partition(r.retired.begin(), r.retired.end(), [&](StackNode* n) {
+      return std::binary_search(hazards.begin(), hazards.end(), n);
+    });
+    for(auto it = kept; it != r.retired.end(); ++it)
+    {
+      delete *it;
+    }
+    r.retired.erase(kept, r.retired.end());
+  }
+
+  public:
+  ~HazardStack()
+  {
+    for(unsigned i = 0; i < records.used(); ++i)
+    {
+      for(StackNode* n : records[i].retired)
+      {
+        delete n;
+      }
+    }
+  }
+
+  std::optional<Value> pop()
+  {
+    Record& r = own_record();
+    StackNode* n;
+    while(true)
+    {
+      n = head.load(std::memory_order_acquire);
+      if(n == nullptr)
+      {
+        break;
+      }
+      r.hazard.store(n);
+      if(head.load() != n)
+      {
+        continue;
+      }
+      if(head.compare_exchange_strong(n, n->next, std::memory_order_acquire))
+      {
+        break;
+      }
+    }
+    r.hazard.store(nullptr, std::memory_order_release);
+    if(n == nullptr)
+    {
+      return std::nullopt;
+    }
+    std::optional<Value> value(std::move(n->value));
+    r.retired.push_back(n);
+    if(r.retired.size() >= 64 + 2 * records.used())
+    {
+      scan(r);
+    }
+    return value;
+  }
+};
+
+class LockedStack
+{
+  std::mutex mutex;
+  std::vector<Value> values;
+
+  public:
+  void push(Value value)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    values.push_back(std::move(value));
+  }
+
+  std::optional<Value> pop()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(values.empty())
+    {
+      return std::nullopt;
+    }
+    std::optional<Value> value(std::move(values.back()));
+    values.pop_back();
+    return value;
+  }
+};
+
+void stress(unsigned threads, std::size_t n)
+{
+  EpochDomain domain;
+  EbrStack stack(domain);
+  std::atomic<std::uint64_t> pushed{0}, popped{0};
+  std::atomic<std::size_t> peak{0};
+  run_on_threads(threads, [&](unsigned t) {
+    std::mt19937 rng(t);
+    std::uint64_t in = 0, out = 0;
+    for(std::size_t i = 0; i < n; ++i)
+    {
+      if(rng() % 2 == 0)
+      {
+        std::uint64_t k = rng() % 1000;
+        stack.push(make_value(k));
+        in += k;
+      }
+      else if(auto v = stack.pop())
+      {
+        out += key(*v);
+      }
+      if(i % 1024 == 0)
+      {
+        std::size_t g = domain.garbage(), p = peak.load();
+        while(g > p && !peak.compare_exchange_weak(p, g))
+        { }
+      }
+    }
+    pushed.fetch_add(in);
+    popped.fetch_add(out);
+  });
+  while(auto v = stack.pop())
+  {
+    popped.fetch_add(key(*v));
+  }
+  std::cout << threads << " threads, " << std::size_t(threads) * n << " random pushes and pops: values "
+            << (pushed.load() == popped.load() ? "all accounted for" : "LOST") << ", epoch "
+            << domain.current_epoch() << ", peak garbage " << peak.load() << " nodes" << std::endl;
+}
+
+// a reader pinned for 50ms: the writer retires until the bound, then waits for the reader
+void stall()
+{
+  EpochDomain domain(256, 1024);
+  EbrStack stack(domain);
+  std::atomic<bool> pinned{false};
+  std::thread reader([&] {
+    auto guard = domain.pin();
+    pinned.store(true);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  });
+  while(!pinned.load())
+  {
+    std::this_thread::yield();
+  }
+  std::size_t peak = 0;
+  Stopwatch sw;
+  double waited_ms = 0;
+  for(std::uint64_t i = 0; i < 20'000; ++i)
+  {
+    stack.push(make_value(i));
+    double before = sw.elapsed_ms();
+    stack.pop();
+    waited_ms = std::max(waited_ms, sw.elapsed_ms() - before);
+    peak = std::max(peak, domain.garbage());
+  }
+  reader.join();
+  domain.synchronize();
+  std::cout << "reader stalled 50ms in a guard: garbage peaked at " << peak << " nodes (bound 1024), "
+            << "longest pop " << waited_ms << "ms, " << domain.garbage() << " left after synchronize()"
+            << std::endl;
+}
+
+// push/pop pairs per second of threads each running n of them
+template <typename Stack>
+double pairs_per_second(unsigned threads, std::size_t n, Stack& stack)
+{
+  for(std::uint64_t k = 0; k < 1000; ++k)
+  {
+    stack.push(make_value(k));
+  }
+  double ms = time_ms([&] {
+    run_on_threads(threads, [&](unsigned) {
+      std::uint64_t sum = 0;
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        stack.push(make_value(i));
+        if(auto v = stack.pop())
+        {
+          sum += key(*v);
+        }
+      }
+      do_not_optimize(sum);
+    });
+  });
+  return double(threads) * double(n) / ms * 1e3;
+}
+
+void benchmark(unsigned threads, std::size_t n)
+{
+  EpochDomain domain;
+  EbrStack ebr(domain);
+  HazardStack hazard;
+  LockedStack locked;
+  double ebr_pairs = pairs_per_second(threads, n, ebr);
+  double hazard_pairs = pairs_per_second(threads, n, hazard);
+  double locked_pairs = pairs_per_second(threads, n, locked);
+  std::cout << threads << " threads, millions of push/pop pairs per second: EBR " << ebr_pairs / 1e6
+            << ", hazard pointers " << hazard_pairs / 1e6 << ", mutex " << locked_pairs / 1e6
+            << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t n = size_arg(argc, argv, 2'000'000);
+  auto threads = unsigned(size_arg(argc, argv, 8, 2));
+
+  stress(std::max(4u, hardware_threads()), std::max<std::size_t>(n / 4, 1000));
+  stall();
+  for(unsigned t : thread_counts())
+  {
+    benchmark(t, n);
+  }
+  if(hardware_threads() < threads)
+  {
+    benchmark(threads, n / threads);
+  }
+  return 0;
+}
@@ -0,0 +1,197 @@
+#pragma once
+#include "../rcu/threadslots.hpp"
+#include "../typelist/typelist.hpp"
+#include "../variant/findindexof.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/*
+    An in-process publish/subscribe bus over a closed list of event types. The usual design, a map
+    from std::type_index to a vector of std::function, pays on every publish for a hash lookup, a
+    lock, often a copy of the handler vector (to call it outside the lock) and an event boxed in a
+    std::any or a shared_ptr, and then an indirect call through std::function per handler.
+    EventBus<TypeList<Events...>>:
+    - finds the subscribers of E in a flat array, at index FindIndexOfT<List, E>, known at compile
+      time;
+    - stores a handler as a Delegate, a pointer to the handler object and a pointer to a function
+      instantiated for its type and the event type: no allocation, no virtual call, and the call to
+      the handler is inlined in that function. The handler object belongs to the subscriber, and must
+      outlive its subscription;
+    - reads the subscribers as a snapshot, an immutable array published through an atomic pointer:
+      publish() is a load and a loop, with no lock and no write to memory shared with other
+      publishers, however many threads publish. subscribe() and unsubscribe() copy the array under
+      a mutex and publish the copy;
+    - constructs the event once, on the stack, and only if someone listens.
+    A snapshot replaced may still be read by a publisher, so it is retired, not freed, with the
+    reader epochs of RcuCell (ReaderEpochs, rcu/threadslots.hpp) but without waiting: a publish is
+    a read section, every replacement advances the epoch, and a snapshot retired at epoch e is freed
+    by a later subscribe() or unsubscribe() once no section begun before e is in progress. So after a
+    change, the snapshots kept are those replaced since the oldest publish still in progress began,
+    not every one since the bus was built; the price is a store and a fence per publish, and 16 KiB
+    of slots per bus. A handler may publish, subscribe or unsubscribe: publishes nest.
+*/
+
+// a handler of events of one type: its object, and a function calling it with the event
+struct Delegate
+{
+  void* object;
+  void (*call)(void* object, void const* event);
+  std::uint64_t id;
+};
+
+using Subscription = std::uint64_t;
+
+template <typename List>
+class EventBus;
+
+template <typename... Events>
+class EventBus<TypeList<Events...>>
+{
+  struct Snapshot
+  {
+    std::unique_ptr<Delegate[]> delegates;
+    std::size_t count = 0;
+  };
+
+  struct Retired
+  {
+    std::unique_ptr<Snapshot const> snapshot;
+    std::uint64_t epoch; // free once no publish announced an epoch before it
+  };
+
+  std::array<std::atomic<Snapshot const*>, sizeof...(Events)> current{};
+  mutable ReaderEpochs readers; // the publishes in progress
+  std::mutex mutex; // serializes the changes, and guards everything below
+  std::array<std::unique_ptr<Snapshot const>, sizeof...(Events)> owned;
+  std::vector<Retired> retired; // in increasing epochs
+  Subscription next_id = 1;
+
+  template <typename E>
+  static constexpr unsigned index = FindIndexOfT<TypeList<Events...>, E>::value;
+
+  // under the mutex: frees the retired snapshots no publish in progress can see
+  void reclaim()
+  {
+    if(retired.empty())
+    {
+      return;
+    }
+    std::uint64_t oldest = readers.oldest();
+    auto end = retired.begin();
+    while(end != retired.end() && end->epoch <= oldest)
+    {
+      ++end;
+    }
+    retired.erase(retired.begin(), end);
+  }
+
+  // under the mutex: the subscribers of type i become those of the old snapshot filtered, plus added
+  void replace(unsigned i, std::uint64_t removed, Delegate const* added)
+  {
+    Snapshot const* old = owned[i].get();
+    auto copy = std::make_unique<Snapshot>();
+    std::size_t old_count = old ? old->count : 0;
+    copy->delegates.reset(new Delegate[old_count + (added ? 1 : 0)]);
+    for(std::size_t k = 0; k < old_count; ++k)
+    {
+      if(old->delegates[k].id != removed)
+      {
+        copy->delegates[copy->count++] = old->delegates[k];
+      }
+    }
+    if(added)
+    {
+      copy->delegates[copy->count++] = *added;
+    }
+    current[i].store(copy.get());
+    if(old)
+    {
+      // a publish announcing this epoch or a later one loads the copy, not old
+      retired.push_back(Retired{std::move(owned[i]), readers.advance()});
+    }
+    owned[i] = std::move(copy);
+    reclaim();
+  }
+
+  public:
+  EventBus() = default;
+  EventBus(EventBus const&) = delete;
+  EventBus& operator=(EventBus const&) = delete;
+
+  // handler(E const&) is called for every E published, until unsubscribe<E>(returned id)
+  template <typename E, typename Handler>
+  Subscription subscribe(Handler& handler)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    Delegate d{&handler,
+               [](void* object, void const* event) {
+                 (*static_cast<Handler*>(object))(*static_cast<E const*>(event));
+               },
+               next_id++};
+    replace(index<E>, 0, &d);
+    return d.id;
+  }
+
+  // a member function of a subscriber, bound at compile time
+  template <typename E, auto Method, typename Object>
+  Subscription subscribe(Object& object)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    Delegate d{&object,
+               [](void* o, void const* event) {
+                 (static_cast<Object*>(o)->*Method)(*static_cast<E const*>(event));
+               },
+               next_id++};
+    replace(index<E>, 0, &d);
+    return d.id;
+  }
+
+  template <typename E>
+  void unsubscribe(Subscription id)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    replace(index<E>, id, nullptr);
+  }
+
+  template <typename E>
+  std::size_t subscribers() const noexcept
+  {
+    auto section = readers.enter();
+    Snapshot const* s = current[index<E>].load();
+    return s ? s->count : 0;
+  }
+
+  // the snapshots replaced and not freed yet
+  std::size_t retired_snapshots()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return retired.size();
+  }
+
+  // constructs an E from args and calls every handler of E with it, in the order of subscription
+  template <typename E, typename... Args>
+  void publish(Args&&... args) const
+  {
+    if(current[index<E>].load(std::memory_order_relaxed) == nullptr)
+    {
+      return;
+    }
+    auto section = readers.enter();
+    Snapshot const* s = current[index<E>].load();
+    if(s->count == 0)
+    {
+      return;
+    }
+    E const event(std::forward<Args>(args)...);
+    for(std::size_t k = 0; k < s->count; ++k)
+    {
+      s->delegates[k].call(s->delegates[k].object, &event);
+    }
+  }
+};
@@ -0,0 +1,199 @@
+#include "../bench/bench.hpp"
+#include "../typelist/typelist.hpp"
+#include "eventbus.hpp"
+#include <any>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+/*
+    A few subscribers, a functor and a member function, to market events; then subscriptions
+    changing on one thread while another publishes. Last, the cost of a publish with 0, 1 and 4
+    subscribers, against the bus it replaces: std::type_index to a vector of std::function, the
+    vector copied under the lock and the event boxed in a std::any.
+*/
+
+struct Quote
+{
+  std::uint32_t instrument;
+  double bid;
+  double ask;
+  std::uint64_t time;
+};
+
+struct Fill
+{
+  std::uint64_t order;
+  double price;
+  double quantity;
+};
+
+struct Halt
+{ };
+
+using Bus = EventBus<TypeList<Quote, Fill, Halt>>;
+
+struct Spread
+{
+  double total = 0;
+  std::size_t quotes = 0;
+
+  void operator()(Quote const& q)
+  {
+    total += q.ask - q.bid;
+    ++quotes;
+  }
+};
+
+struct Position
+{
+  double quantity = 0;
+  bool halted = false;
+
+  void on_fill(Fill const& f)
+  {
+    quantity += f.quantity;
+  }
+
+  void on_halt(Halt const&)
+  {
+    halted = true;
+  }
+};
+
+// the bus replaced
+class TypeIndexBus
+{
+  std::mutex mutex;
+  std::unordered_map<std::type_index, std::vector<std::function<void(std::any const&)>>> handlers;
+
+  public:
+  template <typename E, typename F>
+  void subscribe(F f)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    handlers[typeid(E)].push_back(
+      [f](std::any const& event) mutable { f(std::any_cast<E const&>(event)); });
+  }
+
+  template <typename E>
+  void publish(E const& event)
+  {
+    std::vector<std::function<void(std::any const&)>> snapshot;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = handlers.find(typeid(E));
+      if(it == handlers.end())
+      {
+        return;
+      }
+      snapshot = it->second;
+    }
+    std::any boxed(event);
+    for(auto& h : snapshot)
+    {
+      h(boxed);
+    }
+  }
+};
+
+void demo()
+{
+  Bus bus;
+  Spread spread;
+  Position position;
+  bus.subscribe<Quote>(spread);
+  bus.subscribe<Fill, &Position::on_fill>(position);
+  bus.subscribe<Halt, &Position::on_halt>(position);
+  for(std::uint32_t i = 0; i < 1000; ++i)
+  {
+    bus.publish<Quote>(i % 8, 100.0, 100.0 + 0.01 * (i % 5), std::uint64_t(i));
+    if(i % 10 == 0)
+    {
+      bus.publish<Fill>(std::uint64_t(i), 100.0, 1.0 + i % 3);
+    }
+  }
+  bus.publish<Halt>();
+  std::cout << spread.quotes << " quotes, mean spread " << spread.total / double(spread.quotes)
+            << "; position " << position.quantity << (position.halted ? ", halted" : "") << std::endl;
+
+  // the snapshots let publishers run through subscriptions changing under them
+  std::atomic<bool> started{false}, done{false};
+  std::vector<Spread> spreads(8);
+  std::thread changer([&] {
+    while(!started.load())
+    {
+      std::this_thread::yield();
+    }
+    for(int round = 0; round < 200; ++round)
+    {
+      std::vector<Subscription> ids;
+      for(Spread& s : spreads)
+      {
+        ids.push_back(bus.subscribe<Quote>(s));
+      }
+      for(Subscription id : ids)
+      {
+        bus.unsubscribe<Quote>(id);
+      }
+    }
+    done.store(true);
+  });
+  std::size_t published = 0;
+  started.store(true);
+  while(!done.load() || published < 100'000)
+  {
+    bus.publish<Quote>(1u, 100.0, 100.5, std::uint64_t(published++));
+  }
+  changer.join();
+  std::size_t seen = spread.quotes - 1000;
+  for(Spread const& s : spreads)
+  {
+    seen += s.quotes;
+  }
+  std::cout << published << " quotes published while subscribers came and went, " << seen
+            << " deliveries, " << bus.subscribers<Quote>() << " subscriber left, "
+            << bus.retired_snapshots() << " replaced snapshots not freed yet" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t n = size_arg(argc, argv, 10'000'000);
+  demo();
+
+  for(unsigned subscribers : {0u, 1u, 4u})
+  {
+    Bus bus;
+    TypeIndexBus old_bus;
+    std::vector<Spread> spreads(subscribers), old_spreads(subscribers);
+    for(unsigned i = 0; i < subscribers; ++i)
+    {
+      bus.subscribe<Quote>(spreads[i]);
+      old_bus.subscribe<Quote>([&s = old_spreads[i]](Quote const& q) { s(q); });
+    }
+    double ms = time_ms([&] {
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        bus.publish<Quote>(std::uint32_t(i), 100.0, 100.5, std::uint64_t(i));
+      }
+    });
+    double old_ms = time_ms([&] {
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        old_bus.publish(Quote{std::uint32_t(i), 100.0, 100.5, std::uint64_t(i)});
+      }
+    });
+    do_not_optimize(spreads.data());
+    do_not_optimize(old_spreads.data());
+    std::cout << subscribers << " subscribers, ns per publish: EventBus " << ms * 1e6 / double(n)
+              << ", type_index bus " << old_ms * 1e6 / double(n) << std::endl;
+  }
+  return 0;
+}
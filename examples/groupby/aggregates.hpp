@@ -0,0 +1,170 @@
+#pragma once
+#include "../tuple/tuple.hpp"
+#include "../tuple/tupletypelist.hpp"
+#include <limits>
+#include <type_traits>
+
+/*
+    Aggregate functors for group_by(). Every functor exposes the same small protocol:
+    - State<Row>:  the partial result kept per group (and per thread);
+    - init<Row>(): the state of a group that has not seen any row yet;
+    - update(state, row): folds one row into the state;
+    - merge(state, other): folds the partial state computed by another thread;
+    - result(state): the final value reported for the group.
+    The field an aggregate reads is a compile-time index into the row Tuple, so the element type is
+    known at compile time and nothing is looked up at runtime.
+*/
+
+// the type a sum of T is kept in: integers are widened to 64 bits, keeping their signedness (a
+// long long would turn sums of unsigned fields above 2^63 negative), and float to double, so that
+// summing millions of small values neither overflows nor loses the small ones
+template <typename T>
+using SumType = std::conditional_t<
+  std::is_integral_v<T>,
+  std::conditional_t<std::is_unsigned_v<T>, unsigned long long, long long>,
+  std::conditional_t<std::is_floating_point_v<T>, std::common_type_t<T, double>, T>>;
+
+template <unsigned I>
+struct Sum
+{
+  template <typename Row>
+  using State = SumType<FieldType<Row, I>>;
+
+  template <typename Row>
+  State<Row> init() const
+  {
+    return State<Row>{};
+  }
+  template <typename Row>
+  void update(State<Row>& s, Row const& row) const
+  {
+    s += get<I>(row);
+  }
+  template <typename S>
+  void merge(S& s, S const& other) const
+  {
+    s += other;
+  }
+  template <typename S>
+  S result(S const& s) const
+  {
+    return s;
+  }
+};
+
+struct Count
+{
+  template <typename Row>
+  using State = unsigned long long;
+
+  template <typename Row>
+  State<Row> init() const
+  {
+    return 0;
+  }
+  template <typename Row>
+  void update(State<Row>& s, Row const&) const
+  {
+    ++s;
+  }
+  void merge(unsigned long long& s, unsigned long long other) const
+  {
+    s += other;
+  }
+  unsigned long long result(unsigned long long s) const
+  {
+    return s;
+  }
+};
+
+template <unsigned I>
+struct Min
+{
+  template <typename Row>
+  using State = FieldType<Row, I>;
+
+  template <typename Row>
+  State<Row> init() const
+  {
+    static_assert(std::numeric_limits<State<Row>>::is_specialized, "Min needs an arithmetic field");
+    return std::numeric_limits<State<Row>>::max();
+  }
+  template <typename Row>
+  void update(State<Row>& s, Row const& row) const
+  {
+    s = get<I>(row) < s ? get<I>(row) : s;
+  }
+  template <typename S>
+  void merge(S& s, S const& other) const
+  {
+    s = other < s ? other : s;
+  }
+  template <typename S>
+  S result(S const& s) const
+  {
+    return s;
+  }
+};
+
+template <unsigned I>
+struct Max
+{
+  template <typename Row>
+  using State = FieldType<Row, I>;
+
+  template <typename Row>
+  State<Row> init() const
+  {
+    static_assert(std::numeric_limits<State<Row>>::is_specialized, "Max needs an arithmetic field");
+    return std::numeric_limits<State<Row>>::lowest();
+  }
+  template <typename Row>
+  void update(State<Row>& s, Row const& row) const
+  {
+    s = s < get<I>(row) ? get<I>(row) : s;
+  }
+  template <typename S>
+  void merge(S& s, S const& other) const
+  {
+    s = s < other ? other : s;
+  }
+  template <typename S>
+  S result(S const& s) const
+  {
+    return s;
+  }
+};
+
+struct AvgState
+{
+  double sum = 0;
+  unsigned long long count = 0;
+};
+
+template <unsigned I>
+struct Avg
+{
+  template <typename Row>
+  using State = AvgState;
+
+  template <typename Row>
+  State<Row> init() const
+  {
+    return {};
+  }
+  template <typename Row>
+  void update(State<Row>& s, Row const& row) const
+  {
+    s.sum += get<I>(row);
+    ++s.count;
+  }
+  void merge(AvgState& s, AvgState const& other) const
+  {
+    s.sum += other.sum;
+    s.count += other.count;
+  }
+  double result(AvgState const& s) const
+  {
+    return s.count ? s.sum / s.count : 0.0;
+  }
+};
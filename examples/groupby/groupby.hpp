@@ -0,0 +1,429 @@
+#pragma once
+#include "../parallel/runonthreads.hpp"
+#include "../tuple/algos.hpp"
+#include "../tuple/tupleeq.hpp"
+#include "../tuple/tuplehash.hpp"
+#include "aggregates.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+    Parallel GROUP BY over a vector of Tuple rows:
+
+        auto groups = group_by<0, 1>(rows, make_Tuple(Sum<2>{}, Count{}, Avg<2>{}));
+
+    groups the rows by the key Tuple<field 0, field 1> and computes one state per aggregate. The
+    work is split in two phases:
+    1) every thread scans a contiguous slice of the rows and pre-aggregates it into thread-local
+       tables, one per partition (the partition is taken from the high bits of the key hash), so
+       that no synchronization is needed while scanning;
+    2) every thread then owns one partition and merges the partial states that all the threads
+       produced for it. A key always lands in the same partition, so partitions are disjoint and
+       can be merged independently.
+    When all the key fields are integral and the product of their ranges is small, hashing is pure
+    overhead: the key is turned into a mixed-radix index and the groups live in a direct array.
+*/
+
+struct GroupByOptions
+{
+  unsigned threads = std::thread::hardware_concurrency();
+  // largest key domain (product of the key ranges) handled with a direct array
+  std::size_t direct_limit = std::size_t(1) << 16;
+};
+
+// Helpers applying a Tuple of aggregates to the matching Tuple of states, element by element.
+// basis cases
+template <typename Row>
+void init_states(Tuple<> const&, Tuple<>&)
+{ }
+
+template <typename Row>
+void update_states(Tuple<> const&, Tuple<>&, Row const&)
+{ }
+
+inline void merge_states(Tuple<> const&, Tuple<>&, Tuple<> const&)
+{ }
+
+inline Tuple<> finalize_states(Tuple<> const&, Tuple<> const&)
+{
+  return {};
+}
+
+// recursive cases
+template <typename Row, typename Agg, typename... Aggs, typename State, typename... States>
+void init_states(Tuple<Agg, Aggs...> const& aggs, Tuple<State, States...>& states)
+{
+  states.get_head() = aggs.get_head().template init<Row>();
+  init_states<Row>(aggs.get_tail(), states.get_tail());
+}
+
+template <typename Row, typename Agg, typename... Aggs, typename State, typename... States>
+void update_states(Tuple<Agg, Aggs...> const& aggs, Tuple<State, States...>& states, Row const& row)
+{
+  aggs.get_head().update(states.get_head(), row);
+  update_states(aggs.get_tail(), states.get_tail(), row);
+}
+
+template <typename Agg, typename... Aggs, typename State, typename... States>
+void merge_states(Tuple<Agg, Aggs...> const& aggs,
+                  Tuple<State, States...>& states,
+                  Tuple<State, States...> const& other)
+{
+  aggs.get_head().merge(states.get_head(), other.get_head());
+  merge_states(aggs.get_tail(), states.get_tail(), other.get_tail());
+}
+
+template <typename Agg, typename... Aggs, typename State, typename... States>
+auto finalize_states(Tuple<Agg, Aggs...> const& aggs, Tuple<State, States...> const& states)
+{
+  return push_front(finalize_states(aggs.get_tail(), states.get_tail()),
+                    aggs.get_head().result(states.get_head()));
+}
+
+/*
+    Open-addressing hash table with linear probing, specialized for aggregation: keys are never
+    erased, so a slot is either empty or holds a group forever. The hash of every slot is kept next
+    to the keys, which makes probing cheap and rehashing free of any call to hash_tuple().
+*/
+template <typename Key, typename States>
+class AggTable
+{
+  std::vector<std::uint64_t> tags; // hash | 1, 0 marks an empty slot
+  std::vector<Key> keys;
+  std::vector<States> states;
+  std::size_t mask;
+  std::size_t count = 0;
+
+  void grow()
+  {
+    AggTable bigger(tags.size() * 2);
+    for(std::size_t i = 0; i < tags.size(); ++i)
+    {
+      if(tags[i])
+      {
+        std::size_t slot = bigger.probe(tags[i], keys[i]);
+        bigger.tags[slot] = tags[i];
+        bigger.keys[slot] = std::move(keys[i]);
+        bigger.states[slot] = std::move(states[i]);
+      }
+    }
+    bigger.count = count;
+    *this = std::move(bigger);
+  }
+
+  std::size_t probe(std::uint64_t tag, Key const& key) const
+  {
+    std::size_t slot = (tag >> 1) & mask;
+    while(tags[slot] && !(tags[slot] == tag && keys[slot] == key))
+    {
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  public:
+  // capacity must be a power of two
+  explicit AggTable(std::size_t capacity = 256)
+    : tags(capacity)
+    , keys(capacity)
+    , states(capacity)
+    , mask(capacity - 1)
+  { }
+
+  std::size_t size() const
+  {
+    return count;
+  }
+
+  // returns the states of the group of key, creating them with init(states) if needed
+  template <typename Init>
+  States& find_or_insert(Key const& key, std::uint64_t hash, Init const& init)
+  {
+    std::uint64_t tag = hash | 1;
+    std::size_t slot = probe(tag, key);
+    if(!tags[slot])
+    {
+      if(2 * (count + 1) > tags.size())
+      {
+        grow();
+        slot = probe(tag, key);
+      }
+      tags[slot] = tag;
+      keys[slot] = key;
+      init(states[slot]);
+      ++count;
+    }
+    return states[slot];
+  }
+
+  template <typename F>
+  void for_each(F const& f) const
+  {
+    for(std::size_t i = 0; i < tags.size(); ++i)
+    {
+      if(tags[i])
+      {
+        f(keys[i], tags[i], states[i]);
+      }
+    }
+  }
+};
+
+template <typename Row, typename KeyIndices, typename... Aggs>
+class GroupByEngine;
+
+template <typename Row, unsigned... KeyIndices, typename... Aggs>
+class GroupByEngine<Row, ValueList<unsigned, KeyIndices...>, Aggs...>
+{
+  public:
+  using Key = Tuple<FieldType<Row, KeyIndices>...>;
+  using States = Tuple<typename Aggs::template State<Row>...>;
+  using Results = decltype(finalize_states(std::declval<Tuple<Aggs...> const&>(),
+                                           std::declval<States const&>()));
+  using Group = Tuple<Key, Results>;
+
+  private:
+  static constexpr std::size_t key_count = sizeof...(KeyIndices);
+  static constexpr bool integral_keys = (std::is_integral_v<FieldType<Row, KeyIndices>> && ...);
+
+  std::vector<Row> const& rows;
+  Tuple<Aggs...> const& aggs;
+  unsigned threads;
+  std::size_t direct_limit;
+
+  static Key make_key(Row const& row)
+  {
+    return Key(get<KeyIndices>(row)...);
+  }
+
+  // the rows [begin, end) scanned by thread t in phase 1
+  std::size_t slice_begin(unsigned t) const
+  {
+    return rows.size() * t / threads;
+  }
+
+  // partition of a hash, taken from the high bits (the low bits select the slot in the table)
+  std::size_t partition_of(std::uint64_t hash) const
+  {
+    return ((hash >> 32) * threads) >> 32;
+  }
+
+  std::vector<Group> hash_aggregate() const
+  {
+    auto init = [this](States& s) { init_states<Row>(aggs, s); };
+
+    // phase 1: thread-local pre-aggregation, one table per (thread, partition)
+    std::vector<std::vector<AggTable<Key, States>>> local(threads);
+    run_on_threads(threads, [&](unsigned t) {
+      auto& tables = local[t];
+      tables.resize(threads);
+      for(std::size_t i = slice_begin(t), e = slice_begin(t + 1); i < e; ++i)
+      {
+        Row const& row = rows[i];
+        Key key = make_key(row);
+        std::uint64_t hash = hash_tuple(key);
+        update_states(aggs, tables[partition_of(hash)].find_or_insert(key, hash, init), row);
+      }
+    });
+
+    // phase 2: thread p merges partition p of every thread
+    std::vector<std::vector<Group>> merged(threads);
+    run_on_threads(threads, [&](unsigned p) {
+      // size the table for the worst case (no key shared between threads) so that it never grows
+      std::size_t upper_bound = 0;
+      for(unsigned t = 0; t < threads; ++t)
+      {
+        upper_bound += local[t][p].size();
+      }
+      AggTable<Key, States> table(std::bit_ceil(2 * upper_bound + 2));
+      for(unsigned t = 0; t < threads; ++t)
+      {
+        local[t][p].for_each([&](Key const& key, std::uint64_t tag, States const& states) {
+          merge_states(aggs, table.find_or_insert(key, tag, init), states);
+        });
+        local[t][p] = AggTable<Key, States>(1); // release memory early
+      }
+      merged[p].reserve(table.size());
+      table.for_each([&](Key const& key, std::uint64_t, States const& states) {
+        merged[p].emplace_back(key, finalize_states(aggs, states));
+      });
+    });
+    return concat(merged);
+  }
+
+  // Direct array for small integral key domains. lo/extent describe the range of every key field.
+  std::vector<Group> direct_aggregate(std::array<long long, key_count> const& lo,
+                                      std::array<long long, key_count> const& extent,
+                                      std::size_t domain) const
+  {
+    auto slot_of = [&](Row const& row) {
+      std::size_t slot = 0, k = 0;
+      ((slot = slot * extent[k] + (get<KeyIndices>(row) - lo[k]), ++k), ...);
+      return slot;
+    };
+
+    struct DirectTable
+    {
+      std::vector<States> states;
+      std::vector<Key> keys;
+      std::vector<unsigned char> used;
+    };
+
+    // phase 1: thread-local pre-aggregation into arrays covering the whole domain
+    std::vector<DirectTable> local(threads);
+    run_on_threads(threads, [&](unsigned t) {
+      DirectTable& table = local[t];
+      table.states.resize(domain);
+      table.keys.resize(domain);
+      table.used.resize(domain);
+      for(std::size_t i = slice_begin(t), e = slice_begin(t + 1); i < e; ++i)
+      {
+        Row const& row = rows[i];
+        std::size_t slot = slot_of(row);
+        if(!table.used[slot])
+        {
+          table.used[slot] = 1;
+          table.keys[slot] = make_key(row);
+          init_states<Row>(aggs, table.states[slot]);
+        }
+        update_states(aggs, table.states[slot], row);
+      }
+    });
+
+    // phase 2: the partitions are contiguous slot ranges
+    std::vector<std::vector<Group>> merged(threads);
+    run_on_threads(threads, [&](unsigned p) {
+      for(std::size_t slot = domain * p / threads, e = domain * (p + 1) / threads; slot < e; ++slot)
+      {
+        DirectTable const* first = nullptr;
+        States states;
+        for(DirectTable const& table : local)
+        {
+          if(!table.used[slot])
+          {
+            continue;
+          }
+          if(!first)
+          {
+            first = &table;
+            states = table.states[slot];
+          }
+          else
+          {
+            merge_states(aggs, states, table.states[slot]);
+          }
+        }
+        if(first)
+        {
+          merged[p].emplace_back(first->keys[slot], finalize_states(aggs, states));
+        }
+      }
+    });
+    return concat(merged);
+  }
+
+  // size of the key domain if it is small enough for a direct array, 0 otherwise
+  std::size_t key_domain(std::array<long long, key_count>& lo,
+                         std::array<long long, key_count>& extent) const
+  {
+    std::vector<std::array<long long, key_count>> mins(threads), maxs(threads);
+    run_on_threads(threads, [&](unsigned t) {
+      auto& mn = mins[t];
+      auto& mx = maxs[t];
+      mn.fill(std::numeric_limits<long long>::max());
+      mx.fill(std::numeric_limits<long long>::min());
+      for(std::size_t i = slice_begin(t), e = slice_begin(t + 1); i < e; ++i)
+      {
+        std::size_t k = 0;
+        ((mn[k] = std::min<long long>(mn[k], get<KeyIndices>(rows[i])),
+          mx[k] = std::max<long long>(mx[k], get<KeyIndices>(rows[i])),
+          ++k),
+         ...);
+      }
+    });
+
+    std::size_t domain = 1;
+    for(std::size_t k = 0; k < key_count; ++k)
+    {
+      long long mn = mins[0][k], mx = maxs[0][k];
+      for(unsigned t = 1; t < threads; ++t)
+      {
+        mn = std::min(mn, mins[t][k]);
+        mx = std::max(mx, maxs[t][k]);
+      }
+      // mx - mn may not fit in a long long, but always does in an unsigned one; compare before
+      // multiplying, so that the product cannot overflow either
+      using Unsigned = unsigned long long;
+      Unsigned span = static_cast<Unsigned>(mx) - static_cast<Unsigned>(mn);
+      if(span >= direct_limit || domain * (span + 1) > direct_limit)
+      {
+        return 0;
+      }
+      lo[k] = mn;
+      extent[k] = static_cast<long long>(span + 1);
+      domain *= extent[k];
+    }
+    return domain;
+  }
+
+  static std::vector<Group> concat(std::vector<std::vector<Group>>& parts)
+  {
+    std::vector<Group> all;
+    for(auto& part : parts)
+    {
+      all.insert(
+        all.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+    }
+    return all;
+  }
+
+  public:
+  GroupByEngine(std::vector<Row> const& rows,
+                Tuple<Aggs...> const& aggs,
+                GroupByOptions const& opts)
+    : rows(rows)
+    , aggs(aggs)
+    , threads(std::max(1u, opts.threads))
+    , direct_limit(opts.direct_limit)
+  { }
+
+  // true if the last call of run() used the direct array
+  bool used_direct = false;
+
+  std::vector<Group> run()
+  {
+    if(rows.empty())
+    {
+      return {};
+    }
+    if constexpr(integral_keys)
+    {
+      std::array<long long, key_count> lo, extent;
+      if(std::size_t domain = key_domain(lo, extent))
+      {
+        used_direct = true;
+        return direct_aggregate(lo, extent, domain);
+      }
+    }
+    used_direct = false;
+    return hash_aggregate();
+  }
+};
+
+// group_by<KeyIndices...>(rows, aggregates): one Tuple<Key, Tuple<Results...>> per distinct key,
+// in no particular order
+template <unsigned... KeyIndices, typename Row, typename... Aggs>
+auto group_by(std::vector<Row> const& rows,
+              Tuple<Aggs...> const& aggs,
+              GroupByOptions const& opts = {})
+{
+  return GroupByEngine<Row, ValueList<unsigned, KeyIndices...>, Aggs...>(rows, aggs, opts).run();
+}
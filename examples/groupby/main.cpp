@@ -0,0 +1,85 @@
+#include "../bench/bench.hpp"
+#include "../tuple/tupleio.hpp"
+#include "groupby.hpp"
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using Sale = Tuple<int, int, double>; // (region, product, amount)
+
+std::vector<Sale> make_sales(std::size_t n, int regions, int products)
+{
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<int> region(0, regions - 1), product(0, products - 1);
+  std::uniform_real_distribution<double> amount(1.0, 100.0);
+  std::vector<Sale> rows;
+  rows.reserve(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    rows.emplace_back(region(rng), product(rng), amount(rng));
+  }
+  return rows;
+}
+
+// the single-threaded baseline: one std::unordered_map from the key to (sum, count)
+std::size_t group_by_unordered_map(std::vector<Sale> const& rows)
+{
+  std::unordered_map<Tuple<int, int>, Tuple<double, unsigned long long>, TupleHash> groups;
+  for(Sale const& row : rows)
+  {
+    auto& states = groups[Tuple<int, int>(get<0>(row), get<1>(row))];
+    states.get_head() += get<2>(row);
+    ++states.get_tail().get_head();
+  }
+  return groups.size();
+}
+
+void benchmark(char const* name, std::vector<Sale> const& rows)
+{
+  auto aggs = make_Tuple(Sum<2>{}, Count{}, Avg<2>{});
+  std::size_t groups = 0;
+  double base = time_ms([&] { groups = group_by_unordered_map(rows); });
+  std::cout << name << ": " << rows.size() << " rows, " << groups << " groups\n"
+            << "  std::unordered_map, 1 thread: " << base << " ms\n";
+  for(unsigned threads : thread_counts())
+  {
+    GroupByOptions opts;
+    opts.threads = threads;
+    double ms = time_ms([&] { do_not_optimize(group_by<0, 1>(rows, aggs, opts).size()); });
+    std::cout << "  group_by, " << threads << " thread(s): " << ms << " ms ("
+              << rows.size() / ms / 1e3 << " Mrows/s)\n";
+  }
+}
+
+int main(int argc, char** argv)
+{
+  // GROUP BY (region, product) on a few rows, with string keys
+  std::vector<Tuple<std::string, std::string, double>> sales{
+    {"EU", "apples", 10.0},
+    {"US", "pears", 4.0},
+    {"EU", "apples", 5.0},
+    {"EU", "pears", 7.5},
+    {"US", "pears", 2.0},
+  };
+  auto groups = group_by<0, 1>(sales, make_Tuple(Sum<2>{}, Count{}, Min<2>{}, Max<2>{}, Avg<2>{}));
+  std::sort(groups.begin(), groups.end(), [](auto const& a, auto const& b) {
+    auto const& ka = get<0>(a);
+    auto const& kb = get<0>(b);
+    return get<0>(ka) != get<0>(kb) ? get<0>(ka) < get<0>(kb) : get<1>(ka) < get<1>(kb);
+  });
+  std::cout << "(region, product) -> (sum, count, min, max, avg):" << std::endl;
+  for(auto const& group : groups)
+  {
+    std::cout << "  " << group << std::endl;
+  }
+
+  // scaling benchmark: a low-cardinality key handled by the direct array, and a high-cardinality
+  // key that needs the hash tables
+  std::size_t n = size_arg(argc, argv, 10'000'000);
+  benchmark("low cardinality (direct array)", make_sales(n, 16, 256));
+  benchmark("high cardinality (hash tables)", make_sales(n, 16, 1 << 20));
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include "../bench/bench.hpp"
+#include "../bench/histogram.hpp"
+#include "../parallel/runonthreads.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+/*
+    First the precision promised: percentiles of a heavy-tailed sample, from the histogram and from
+    the sorted sample, never differ by more than 2^-7. Then each thread times an allocation into its
+    own histogram, and all of them are merged into one without a lock; the result goes through
+    serialize() and back. Last, what a record costs, against keeping every value to sort it later.
+*/
+
+// latencies in nanoseconds: mostly around a microsecond, with a long tail
+std::vector<std::uint64_t> sample(std::size_t n, unsigned seed)
+{
+  std::mt19937_64 rng(seed);
+  std::lognormal_distribution<double> latency(7, 1);
+  std::vector<std::uint64_t> values(n);
+  for(auto& v : values)
+  {
+    v = std::uint64_t(latency(rng));
+  }
+  return values;
+}
+
+void precision(std::vector<std::uint64_t> values)
+{
+  LatencyHistogram histogram;
+  for(std::uint64_t v : values)
+  {
+    histogram.record(v);
+  }
+  std::sort(values.begin(), values.end());
+  double worst = 0;
+  for(double percent : {1.0, 10.0, 50.0, 90.0, 99.0, 99.9, 99.99, 100.0})
+  {
+    auto rank = std::uint64_t(std::ceil(percent / 100 * double(values.size())));
+    std::uint64_t exact = values[std::max<std::uint64_t>(rank, 1) - 1];
+    std::uint64_t approximate = histogram.percentile(percent);
+    double error = std::abs(double(approximate) - double(exact))
+                   / double(std::max<std::uint64_t>(exact, 1));
+    worst = std::max(worst, error);
+  }
+  std::cout << "precision: ";
+  histogram.print(std::cout);
+  std::cout << std::endl
+            << "  largest relative error of a percentile " << worst << " (bound " << 1.0 / 128
+            << "), counts take " << histogram.bytes() << " B" << std::endl;
+}
+
+void merged(unsigned threads, std::size_t n)
+{
+  LatencyHistogram all;
+  run_on_threads(threads, [&](unsigned t) {
+    LatencyHistogram mine;
+    std::mt19937 rng(t);
+    record_latencies(mine, n, [&](std::size_t) {
+      auto block = std::make_unique<char[]>(16 + rng() % 4096);
+      do_not_optimize(block.get());
+    });
+    all.merge(mine);
+  });
+  std::cout << threads << " threads, allocation latency: ";
+  all.print(std::cout);
+  std::cout << std::endl;
+
+  std::vector<std::byte> bytes;
+  all.serialize(bytes);
+  LatencyHistogram back = LatencyHistogram::deserialize(bytes);
+  bool same = back.count() == all.count() && back.min() == all.min() && back.max() == all.max();
+  for(double percent : {50.0, 99.0, 99.9, 99.99})
+  {
+    same = same && back.percentile(percent) == all.percentile(percent);
+  }
+  std::cout << "  serialized in " << bytes.size() << " B (counts in memory " << all.bytes()
+            << " B), read back " << (same ? "identical" : "DIFFERENT") << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t n = size_arg(argc, argv, 10'000'000);
+  std::vector<std::uint64_t> values = sample(n, 42);
+
+  precision(values);
+  merged(std::min(4u, hardware_threads()), std::max<std::size_t>(n / 100, 1000));
+
+  LatencyHistogram histogram;
+  double record_ms = time_ms([&] {
+    histogram.reset();
+    for(std::uint64_t v : values)
+    {
+      histogram.record(v);
+    }
+    do_not_optimize(histogram.count());
+  });
+  double keep_ms = time_ms([&] {
+    std::vector<std::uint64_t> kept;
+    for(std::uint64_t v : values)
+    {
+      kept.push_back(v);
+    }
+    do_not_optimize(kept.data());
+  });
+  double sort_ms = time_ms([&] {
+    std::vector<std::uint64_t> kept = values;
+    std::sort(kept.begin(), kept.end());
+    do_not_optimize(kept[kept.size() * 99 / 100]);
+  });
+  double percentiles_ms = time_ms([&] {
+    for(double percent : {50.0, 90.0, 99.0, 99.9, 99.99})
+    {
+      do_not_optimize(histogram.percentile(percent));
+    }
+  });
+  LatencyHistogram total;
+  double merge_ms = time_ms([&] { total.merge(histogram); });
+  std::cout << n << " values, ns each: record " << record_ms * 1e6 / double(n)
+            << ", keeping them in a vector " << keep_ms * 1e6 / double(n) << " (then sorting "
+            << sort_ms * 1e6 / double(n) << ")" << std::endl
+            << "5 percentiles " << percentiles_ms * 1e3 << " us, merging two histograms "
+            << merge_ms * 1e3 << " us" << std::endl;
+  return 0;
+}
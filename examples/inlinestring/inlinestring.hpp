@@ -0,0 +1,180 @@
+#pragma once
+#include "../tuple/tuplehash.hpp"
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/*
+    String of at most N characters stored inside the object: N bytes of characters followed by one
+    length byte, so InlineString<15> takes 16 bytes and never touches the heap.
+    Unlike std::string, which has a user-provided copy constructor even when its characters sit in the
+    small string buffer, it is trivially copyable. A Tuple or Variant of such fields is then
+    IsTriviallyCopyable, and copy_rows() moves whole arrays of rows with one memcpy; BinaryWriter
+    writes the string itself as its raw bytes.
+    The unused characters are kept zeroed, so two equal strings are equal byte for byte: operator==
+    and std::hash work on the whole fixed-size array, with no loop depending on the length.
+    Constructing one from a longer string throws std::length_error; the constructors are explicit
+    because of that, as they are not the harmless conversions that std::string's are.
+*/
+template <std::size_t N>
+class InlineString
+{
+  static_assert(N > 0 && N <= 255, "InlineString: the length must fit in one byte");
+
+  char chars[N] = {};
+  unsigned char len = 0;
+
+  public:
+  using value_type = char;
+  using size_type = std::size_t;
+  using const_iterator = char const*;
+  using iterator = const_iterator;
+
+  constexpr InlineString() = default;
+
+  constexpr explicit InlineString(std::string_view s)
+  {
+    assign(s);
+  }
+
+  constexpr explicit InlineString(char const* s)
+    : InlineString(std::string_view(s))
+  { }
+
+  constexpr void assign(std::string_view s)
+  {
+    if(s.size() > N)
+    {
+      throw std::length_error("InlineString: string longer than the capacity");
+    }
+    std::copy(s.begin(), s.end(), chars);
+    std::fill(chars + s.size(), chars + N, '\0');
+    len = static_cast<unsigned char>(s.size());
+  }
+
+  static constexpr std::size_t capacity()
+  {
+    return N;
+  }
+
+  constexpr std::size_t size() const
+  {
+    return len;
+  }
+
+  constexpr std::size_t length() const
+  {
+    return len;
+  }
+
+  constexpr bool empty() const
+  {
+    return len == 0;
+  }
+
+  // not null-terminated when the string is full
+  constexpr char const* data() const
+  {
+    return chars;
+  }
+
+  constexpr const_iterator begin() const
+  {
+    return chars;
+  }
+
+  constexpr const_iterator end() const
+  {
+    return chars + len;
+  }
+
+  constexpr char operator[](std::size_t i) const
+  {
+    return chars[i];
+  }
+
+  constexpr char front() const
+  {
+    return chars[0];
+  }
+
+  constexpr char back() const
+  {
+    return chars[len - 1];
+  }
+
+  constexpr std::string_view view() const
+  {
+    return {chars, len};
+  }
+
+  constexpr operator std::string_view() const
+  {
+    return view();
+  }
+
+  std::string str() const
+  {
+    return std::string(view());
+  }
+
+  friend bool operator==(InlineString const& lhs, InlineString const& rhs)
+  {
+    return lhs.len == rhs.len && std::memcmp(lhs.chars, rhs.chars, N) == 0;
+  }
+
+  friend std::strong_ordering operator<=>(InlineString const& lhs, InlineString const& rhs)
+  {
+    return lhs.view() <=> rhs.view();
+  }
+
+  friend bool operator==(InlineString const& lhs, std::string_view rhs)
+  {
+    return lhs.view() == rhs;
+  }
+
+  friend std::strong_ordering operator<=>(InlineString const& lhs, std::string_view rhs)
+  {
+    return lhs.view() <=> rhs;
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, InlineString const& s)
+  {
+    return os << s.view();
+  }
+
+  // the bytes of an InlineString from outside: its length must be at most N, or view() and the
+  // others would read past the characters
+  static bool valid_bytes(void const* bytes) noexcept
+  {
+    return static_cast<unsigned char const*>(bytes)[offsetof(InlineString, len)] <= N;
+  }
+};
+
+template <std::size_t N>
+struct RepresentationCheck<InlineString<N>>
+{
+  static bool valid(void const* bytes) noexcept
+  {
+    return InlineString<N>::valid_bytes(bytes);
+  }
+};
+
+static_assert(sizeof(InlineString<15>) == 16);
+static_assert(std::is_trivially_copyable_v<InlineString<15>>);
+
+template <std::size_t N>
+struct std::hash<InlineString<N>>
+{
+  std::size_t operator()(InlineString<N> const& s) const
+  {
+    return hash_bytes(&s, sizeof(s));
+  }
+};
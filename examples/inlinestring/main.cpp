@@ -0,0 +1,143 @@
+#include "../bench/bench.hpp"
+#include "../serialize/binary.hpp"
+#include "../tuple/optimized/tuplestorage4.hpp"
+#include "../tuple/tupleeq.hpp"
+#include "../tuple/tupleio.hpp"
+#include "inlinestring.hpp"
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using Key = InlineString<15>;
+using StringRow = Tuple<int, double, std::string>;
+using InlineRow = Tuple<int, double, Key>;
+using Value = Variant<int, double, Key>;
+
+static_assert(IsTriviallyCopyable<InlineRow>::value);
+static_assert(!IsTriviallyCopyable<StringRow>::value);
+static_assert(IsTriviallyCopyable<Tuple4<int, Key>>::value);
+static_assert(IsTriviallyCopyable<Value>::value);
+static_assert(!IsTriviallyCopyable<Variant<int, std::string>>::value);
+
+// short keys, all of them within the small string buffer of std::string: no allocation either way
+std::string sku(std::size_t i)
+{
+  return "sku-" + std::to_string(i % 100'000);
+}
+
+template <typename Rows>
+std::size_t serialized_size(Rows const& rows)
+{
+  std::vector<std::byte> buffer;
+  BinaryWriter(buffer).write(rows);
+  return buffer.size();
+}
+
+int main(int argc, char** argv)
+{
+  InlineRow row(7, 2.5, Key("sku-42"));
+  std::cout << std::boolalpha << "row is: " << row << ", sizeof = " << sizeof(row) << std::endl;
+  std::cout << "get<2>(row) == \"sku-42\" is: " << (get<2>(row) == "sku-42") << std::endl;
+  try
+  {
+    Key too_long("a string longer than fifteen characters");
+  }
+  catch(std::length_error const& e)
+  {
+    std::cout << "caught: " << e.what() << std::endl;
+  }
+
+  // round trip through the binary format: an index and the bytes of the value per variant, the
+  // length and the characters of a std::string
+  std::vector<Value> values{Value(1), Value(2.5), Value(Key("three"))};
+  std::vector<Variant<int, std::string>> strings{Variant<int, std::string>(std::string("four")),
+                                                 Variant<int, std::string>(5)};
+  std::vector<std::byte> buffer;
+  BinaryWriter writer(buffer);
+  writer.write(values);
+  writer.write(strings);
+  std::vector<Value> values_back;
+  std::vector<Variant<int, std::string>> strings_back;
+  BinaryReader reader(buffer);
+  reader.read(values_back);
+  reader.read(strings_back);
+  std::cout << "round trip: " << values_back[2].get<Key>() << ", " << values_back[1].get<double>()
+            << ", " << strings_back[0].get<std::string>() << ", " << strings_back[1].get<int>()
+            << " (" << buffer.size() << " bytes)" << std::endl;
+
+  std::size_t n = size_arg(argc, argv, 10'000'000);
+  std::vector<StringRow> string_rows;
+  std::vector<InlineRow> inline_rows;
+  string_rows.reserve(n);
+  inline_rows.reserve(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    std::string key = sku(i);
+    string_rows.emplace_back(int(i), 0.5 * i, key);
+    inline_rows.emplace_back(int(i), 0.5 * i, Key(key));
+  }
+  std::cout << n << " rows, sizeof(row): std::string " << sizeof(StringRow) << ", InlineString "
+            << sizeof(InlineRow) << std::endl;
+
+  std::cout << "copy all the rows:" << std::endl;
+  double copy_string_ms = time_ms([&] { do_not_optimize(std::vector(string_rows).size()); });
+  std::cout << "  std::string:               " << copy_string_ms << " ms" << std::endl;
+  double copy_inline_ms = time_ms([&] { do_not_optimize(std::vector(inline_rows).size()); });
+  std::cout << "  InlineString:              " << copy_inline_ms << " ms" << std::endl;
+  std::vector<StringRow> string_dst(n);
+  std::vector<InlineRow> inline_dst(n);
+  double rows_string_ms = time_ms([&] {
+    copy_rows(string_rows.data(), n, string_dst.data());
+    do_not_optimize(string_dst[0]);
+  });
+  std::cout << "  copy_rows(), std::string:  " << rows_string_ms << " ms" << std::endl;
+  double rows_inline_ms = time_ms([&] {
+    copy_rows(inline_rows.data(), n, inline_dst.data());
+    do_not_optimize(inline_dst[0]);
+  });
+  std::cout << "  copy_rows(), InlineString: " << rows_inline_ms << " ms" << std::endl;
+  string_dst = {};
+  inline_dst = {};
+
+  std::cout << "serialize all the rows:" << std::endl;
+  double write_string_ms = time_ms([&] { do_not_optimize(serialized_size(string_rows)); });
+  std::cout << "  std::string:  " << write_string_ms << " ms, " << serialized_size(string_rows)
+            << " bytes" << std::endl;
+  double write_inline_ms = time_ms([&] { do_not_optimize(serialized_size(inline_rows)); });
+  std::cout << "  InlineString: " << write_inline_ms << " ms, " << serialized_size(inline_rows)
+            << " bytes" << std::endl;
+
+  std::cout << "hash all the rows:" << std::endl;
+  std::vector<std::uint64_t> hashes(n);
+  double hash_string_ms =
+    time_ms([&] { hash_tuple_batch(string_rows.data(), n, hashes.data()); });
+  std::cout << "  std::string:  " << hash_string_ms << " ms" << std::endl;
+  double hash_inline_ms =
+    time_ms([&] { hash_tuple_batch(inline_rows.data(), n, hashes.data()); });
+  std::cout << "  InlineString: " << hash_inline_ms << " ms" << std::endl;
+
+  // a column of variants: visit() per element against one memcpy
+  std::vector<Value> column(inline_rows.size());
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    column[i] = i % 3 == 0 ? Value(get<0>(inline_rows[i])) : Value(get<2>(inline_rows[i]));
+  }
+  std::vector<Variant<int, std::string>> string_column(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    string_column[i] = i % 3 == 0 ? Variant<int, std::string>(get<0>(string_rows[i]))
+                                  : Variant<int, std::string>(get<2>(string_rows[i]));
+  }
+  std::cout << "copy a column of variants:" << std::endl;
+  double variant_string_ms =
+    time_ms([&] { do_not_optimize(std::vector(string_column).size()); });
+  std::cout << "  Variant<int, std::string>:          " << variant_string_ms << " ms" << std::endl;
+  std::vector<Value> column_dst(n);
+  double variant_inline_ms = time_ms([&] {
+    copy_rows(column.data(), n, column_dst.data());
+    do_not_optimize(column_dst[0]);
+  });
+  std::cout << "  Variant<int, double, InlineString>: " << variant_inline_ms << " ms" << std::endl;
+  return 0;
+}
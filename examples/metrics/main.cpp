@@ -0,0 +1,159 @@
+#include "../bench/bench.hpp"
+#include "../parallel/runonthreads.hpp"
+#include "../variant/variant.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+/*
+    A few threads handle a stream of order messages, each visit counted per message type through
+    counted(), with a gauge of the orders still open; then 64 threads (the second argument) increment
+    one counter, as a single shared atomic, as one atomic per thread packed in the same cache lines,
+    and through Metrics. On a single core the threads take turns and nothing is shared at the same
+    time: the gap only opens with as many cores as threads.
+*/
+
+struct Order
+{
+  static constexpr char const* name = "order";
+  unsigned quantity;
+};
+
+struct Cancel
+{
+  static constexpr char const* name = "cancel";
+};
+
+struct Trade
+{
+  static constexpr char const* name = "trade";
+  unsigned quantity;
+};
+
+using Message = Variant<Order, Cancel, Trade>;
+using MessageMetrics = Metrics<TypeList<Order, Cancel, Trade>>;
+
+std::vector<Message> messages(std::size_t n, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<Message> stream;
+  stream.reserve(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    unsigned r = rng() % 10;
+    if(r < 6)
+    {
+      stream.push_back(Order{1 + r});
+    }
+    else if(r < 8)
+    {
+      stream.push_back(Cancel{});
+    }
+    else
+    {
+      stream.push_back(Trade{r});
+    }
+  }
+  return stream;
+}
+
+// the handler knows nothing of the dispatch counts, only of the gauge it maintains
+struct Handler
+{
+  MessageMetrics& metrics;
+  std::uint64_t& volume;
+
+  void operator()(Order const&) const
+  {
+    metrics.gauge_add<Order>(1);
+  }
+
+  void operator()(Cancel const&) const
+  {
+    metrics.gauge_add<Order>(-1);
+  }
+
+  void operator()(Trade const& trade) const
+  {
+    metrics.gauge_add<Order>(-1);
+    volume += trade.quantity;
+  }
+};
+
+void handle(unsigned threads, std::size_t n)
+{
+  MessageMetrics metrics;
+  run_on_threads(threads, [&](unsigned t) {
+    std::vector<Message> stream = messages(n, t);
+    std::uint64_t volume = 0;
+    for(Message const& message : stream)
+    {
+      message.visit(counted(metrics, Handler{metrics, volume}));
+    }
+    do_not_optimize(volume);
+  });
+  std::cout << threads << " threads handled " << std::size_t(threads) * n << " messages:";
+  metrics.for_each([](auto type, std::uint64_t count, std::int64_t) {
+    std::cout << " " << decltype(type)::type::name << " " << count;
+  });
+  std::cout << "; open orders " << metrics.gauge<Order>() << std::endl;
+}
+
+// increments per second of threads each calling increment() n times
+template <typename F>
+double throughput(unsigned threads, std::size_t n, F const& increment)
+{
+  double ms = time_ms([&] {
+    run_on_threads(threads, [&](unsigned t) {
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        increment(t);
+      }
+    });
+  });
+  return double(threads) * double(n) / ms * 1e3;
+}
+
+void benchmark(unsigned threads, std::size_t n)
+{
+  std::atomic<std::uint64_t> shared{0};
+  double shared_ops = throughput(threads, n, [&](unsigned) {
+    shared.fetch_add(1, std::memory_order_relaxed);
+  });
+
+  auto packed = std::make_unique<std::atomic<std::uint64_t>[]>(threads);
+  double packed_ops = throughput(threads, n, [&](unsigned t) {
+    packed[t].store(packed[t].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  });
+
+  MessageMetrics metrics;
+  double sharded_ops = throughput(threads, n, [&](unsigned) { metrics.add<Trade>(); });
+
+  std::uint64_t expected = std::uint64_t(threads) * n * 3;
+  std::cout << threads << " threads, millions of increments per second: one atomic "
+            << shared_ops / 1e6 << ", per-thread atomics sharing lines " << packed_ops / 1e6
+            << ", Metrics " << sharded_ops / 1e6
+            << (shared.load() == expected && metrics.count<Trade>() == expected ? "" : " (WRONG COUNT)")
+            << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t n = size_arg(argc, argv, 1'000'000);
+  auto threads = unsigned(size_arg(argc, argv, 64, 2));
+
+  handle(std::min(4u, hardware_threads()), std::max<std::size_t>(n / 10, 1000));
+  benchmark(1, n);
+  if(hardware_threads() > 1 && hardware_threads() < threads)
+  {
+    benchmark(hardware_threads(), n);
+  }
+  benchmark(threads, n);
+  return 0;
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include "../rcu/threadslots.hpp"
+#include "../typelist/typelist.hpp"
+#include "../variant/findindexof.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+/*
+    A counter and a gauge per type of a closed list, say the alternatives of a message Variant, without
+    a shared atomic on the hot path. A counter incremented by every thread is one cache line bouncing
+    between all the cores: each fetch_add waits for the line to come back in exclusive state, and
+    throughput falls as threads are added instead of growing.
+    Metrics<TypeList<Keys...>> keeps one shard per thread, a cache-line aligned block with the counters
+    and the gauges of all the keys, and the index of a key is FindIndexOfT of its type, known at
+    compile time. A thread only writes its own shard, with a plain load and store: no locked
+    instruction, and no line shared with a writer. The values are the sums over the shards, computed
+    on read, so reading costs a pass over all the shards and is meant to be rare (a scrape, a report).
+    Shards are indexed by thread_slot() (rcu/threadslots.hpp), a small per-thread number reused once
+    its thread has finished, so the counts of a finished thread stay and its successor adds to them.
+    Threads beyond the number of shards share one last shard, with atomic additions.
+    A gauge is an up-and-down counter (messages in flight, bytes buffered): add and subtract from any
+    thread, the value is the sum of the deltas.
+*/
+
+template <typename List>
+class Metrics;
+
+template <typename... Keys>
+class Metrics<TypeList<Keys...>>
+{
+  static_assert(sizeof...(Keys) > 0, "Metrics needs at least one key");
+
+  struct alignas(64) Shard
+  {
+    std::atomic<std::uint64_t> counters[sizeof...(Keys)];
+    std::atomic<std::int64_t> gauges[sizeof...(Keys)];
+  };
+
+  unsigned owned; // shards owned by one thread each; shard `owned` is shared by the others
+  std::unique_ptr<Shard[]> shards;
+
+  template <typename T>
+  static constexpr unsigned index = FindIndexOfT<TypeList<Keys...>, T>::value;
+
+  // Values is &Shard::counters or &Shard::gauges
+  template <auto Values, typename V>
+  void add_to(unsigned i, V n) noexcept
+  {
+    unsigned slot = thread_slot();
+    if(slot < owned)
+    {
+      std::atomic<V>& value = (shards[slot].*Values)[i];
+      value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    else
+    {
+      (shards[owned].*Values)[i].fetch_add(n, std::memory_order_relaxed);
+    }
+  }
+
+  template <auto Values, typename V>
+  V sum(unsigned i) const noexcept
+  {
+    V total = 0;
+    for(unsigned s = 0; s <= owned; ++s)
+    {
+      total += (shards[s].*Values)[i].load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  public:
+  using KeyList = TypeList<Keys...>;
+
+  explicit Metrics(unsigned threads = 128)
+    : owned(threads)
+    , shards(new Shard[threads + 1])
+  { }
+
+  Metrics(Metrics const&) = delete;
+  Metrics& operator=(Metrics const&) = delete;
+
+  template <typename T>
+  void add(std::uint64_t n = 1) noexcept
+  {
+    add_to<&Shard::counters>(index<T>, n);
+  }
+
+  template <typename T>
+  void gauge_add(std::int64_t delta) noexcept
+  {
+    add_to<&Shard::gauges>(index<T>, delta);
+  }
+
+  template <typename T>
+  std::uint64_t count() const noexcept
+  {
+    return sum<&Shard::counters, std::uint64_t>(index<T>);
+  }
+
+  template <typename T>
+  std::int64_t gauge() const noexcept
+  {
+    return sum<&Shard::gauges, std::int64_t>(index<T>);
+  }
+
+  // f(std::type_identity<T>(), count, gauge) for every key T, in the order of the list
+  template <typename F>
+  void for_each(F&& f) const
+  {
+    (f(std::type_identity<Keys>(), count<Keys>(), gauge<Keys>()), ...);
+  }
+};
+
+/*
+    The visit hook: v.visit(counted(metrics, visitor)) visits v with visitor, and first counts one
+    dispatch on the type of the alternative visited, which must be a key of metrics (the Variant
+    itself can stay unaware of metrics). The returned visitor refers to both arguments and is meant
+    to be used at once.
+*/
+template <typename Metrics, typename Visitor>
+auto counted(Metrics& metrics, Visitor&& vis)
+{
+  return [&metrics, &vis](auto&& value) -> decltype(auto) {
+    metrics.template add<std::remove_cvref_t<decltype(value)>>();
+    return std::forward<Visitor>(vis)(std::forward<decltype(value)>(value));
+  };
+}
@@ -0,0 +1,222 @@
+#include "../bench/bench.hpp"
+#include "../variant/nanboxvariant.hpp"
+#include "../variant/variant.hpp"
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+struct Object
+{
+  std::string name;
+};
+
+// the values of a small scripting language: NaN-boxed...
+using Value = Variant<double, std::int32_t, bool, Object*>;
+
+template <>
+struct VariantUsesNanBox<TypeList<double, std::int32_t, bool, Object*>> : std::true_type
+{ };
+
+// ...and the same alternatives (with a pointer type that has not opted in) in the generic layout
+using WideValue = Variant<double, std::int32_t, bool, Object const*>;
+
+static_assert(sizeof(Value) == 8);
+static_assert(std::is_trivially_copyable_v<Value>);
+static_assert(sizeof(WideValue) == 16);
+static_assert(!std::is_trivially_copyable_v<WideValue>);
+
+struct Describe
+{
+  std::string operator()(double x) const
+  {
+    return "double " + std::to_string(x);
+  }
+  std::string operator()(std::int32_t x) const
+  {
+    return "int " + std::to_string(x);
+  }
+  std::string operator()(bool x) const
+  {
+    return x ? "true" : "false";
+  }
+  std::string operator()(Object const* o) const
+  {
+    return "object " + o->name;
+  }
+};
+
+// a number as the language sees it: objects are not numbers
+struct ToNumber
+{
+  double operator()(double x) const
+  {
+    return x;
+  }
+  double operator()(std::int32_t x) const
+  {
+    return x;
+  }
+  double operator()(bool x) const
+  {
+    return x;
+  }
+  double operator()(Object const*) const
+  {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+};
+
+// the addition of the language: int + int stays an int unless it overflows, anything else is a double
+template <typename V>
+V add(V const& a, V const& b)
+{
+  if(a.template is<std::int32_t>() && b.template is<std::int32_t>())
+  {
+    std::int64_t sum = std::int64_t(a.template get<std::int32_t>()) + b.template get<std::int32_t>();
+    if(sum == std::int32_t(sum))
+    {
+      return V(std::int32_t(sum));
+    }
+    return V(double(sum));
+  }
+  return V(a.template visit<double>(ToNumber()) + b.template visit<double>(ToNumber()));
+}
+
+template <typename V>
+V multiply(V const& a, V const& b)
+{
+  return V(a.template visit<double>(ToNumber()) * b.template visit<double>(ToNumber()));
+}
+
+template <typename V>
+bool less(V const& a, V const& b)
+{
+  return a.template visit<double>(ToNumber()) < b.template visit<double>(ToNumber());
+}
+
+// mostly numbers, as in numeric script code: 60% doubles, 30% ints, 5% booleans, 5% objects
+template <typename V, typename Pointer>
+std::vector<V> make_values(std::size_t n, Pointer object)
+{
+  std::vector<V> values;
+  values.reserve(n);
+  std::mt19937_64 rng(42);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    unsigned kind = rng() % 100;
+    if(kind < 60)
+    {
+      values.push_back(V(double(rng() % 1000) / 8));
+    }
+    else if(kind < 90)
+    {
+      values.push_back(V(std::int32_t(rng() % 1000)));
+    }
+    else if(kind < 95)
+    {
+      values.push_back(V(kind % 2 == 0));
+    }
+    else
+    {
+      values.push_back(V(object));
+    }
+  }
+  return values;
+}
+
+// sums the numbers in an array of values
+template <typename V>
+double sum_numbers(std::vector<V> const& values)
+{
+  double sum = 0;
+  for(V const& v : values)
+  {
+    if(v.template is<double>())
+    {
+      sum += v.template get<double>();
+    }
+    else if(v.template is<std::int32_t>())
+    {
+      sum += v.template get<std::int32_t>();
+    }
+  }
+  return sum;
+}
+
+// an interpreter's inner loop: out[i] = a[i] * b[i] + a[i], and a running maximum
+template <typename V>
+V arithmetic(std::vector<V> const& a, std::vector<V> const& b, std::vector<V>& out)
+{
+  V best(0.0);
+  for(std::size_t i = 0; i < a.size(); ++i)
+  {
+    V r = add(multiply(a[i], b[i]), a[i]);
+    if(less(best, r))
+    {
+      best = r;
+    }
+    out[i] = r;
+  }
+  return best;
+}
+
+// integer accumulation, the loop counter case: acc = acc + a[i] where both are mostly ints
+template <typename V>
+V accumulate(std::vector<V> const& a)
+{
+  V acc(std::int32_t(0));
+  for(V const& v : a)
+  {
+    acc = add(acc, v);
+  }
+  return acc;
+}
+
+template <typename V, typename Pointer>
+void bench(char const* name, std::size_t n, Pointer object)
+{
+  std::vector<V> a = make_values<V>(n, object);
+  std::vector<V> b = make_values<V>(n, object);
+  std::vector<V> out(n);
+  double sum_ms = time_ms([&] { do_not_optimize(sum_numbers(a)); });
+  double arithmetic_ms = time_ms([&] {
+    V best = arithmetic(a, b, out);
+    do_not_optimize(best);
+  });
+  double accumulate_ms = time_ms([&] {
+    V acc = accumulate(a);
+    do_not_optimize(acc);
+  });
+  std::cout << "  " << name << " (" << sizeof(V) << " bytes, " << n * sizeof(V) / (1 << 20)
+            << " MiB per array): sum " << sum_ms * 1e6 / double(n) << " ns, a*b+a "
+            << arithmetic_ms * 1e6 / double(n) << " ns, accumulate "
+            << accumulate_ms * 1e6 / double(n) << " ns per value" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  Object script{"script"};
+  for(Value v : {Value(2.5), Value(std::int32_t(-7)), Value(true), Value(&script),
+                 Value(std::nan("")), Value(-std::numeric_limits<double>::infinity())})
+  {
+    std::cout << std::hex << "0x" << v.raw_bits() << std::dec << ": " << v.visit(Describe())
+              << std::endl;
+  }
+  Value sum = add(Value(std::int32_t(2'000'000'000)), Value(std::int32_t(2'000'000'000)));
+  std::cout << "int overflow becomes a double: " << sum.visit(Describe()) << std::endl;
+  Value empty;
+  empty.destroy();
+  std::cout << std::boolalpha << "a destroyed value is empty: " << empty.empty()
+            << ", try_visit has a value: " << empty.try_visit(Describe()).has_value() << std::endl;
+
+  std::size_t n = size_arg(argc, argv, 4'000'000);
+  std::cout << n << " values:" << std::endl;
+  bench<Value>("NaN-boxed", n, &script);
+  bench<WideValue>("generic  ", n, static_cast<Object const*>(&script));
+  return 0;
+}
@@ -0,0 +1,137 @@
+#include "../bench/bench.hpp"
+#include "../tuple/optimized/tuplestorage3.hpp"
+#include "../tuple/optimized/tuplestorage4.hpp"
+#include "../tuple/tuple.hpp"
+#include "../variant/variant.hpp"
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// a string whose move constructor is not declared noexcept, as in much pre-C++11 code
+class LegacyString
+{
+  std::string s;
+
+  public:
+  LegacyString() = default;
+  LegacyString(std::string s)
+    : s(std::move(s))
+  { }
+  LegacyString(LegacyString const&) = default;
+  LegacyString(LegacyString&& other)
+    : s(std::move(other.s))
+  { }
+  LegacyString& operator=(LegacyString const&) = default;
+  LegacyString& operator=(LegacyString&&) = default;
+};
+
+// counts how the elements of a vector are relocated when it grows
+struct Tracked
+{
+  static inline std::size_t copies = 0;
+  static inline std::size_t moves = 0;
+  Tracked() = default;
+  Tracked(Tracked const&)
+  {
+    ++copies;
+  }
+  Tracked(Tracked&&) noexcept
+  {
+    ++moves;
+  }
+  Tracked& operator=(Tracked const&) = default;
+  Tracked& operator=(Tracked&&) noexcept = default;
+};
+
+using S = std::string;
+
+// Variant: noexcept follows the alternatives
+static_assert(std::is_nothrow_move_constructible_v<Variant<S, int>>);
+static_assert(std::is_nothrow_move_assignable_v<Variant<S, int>>);
+static_assert(std::is_nothrow_swappable_v<Variant<S, int>>);
+static_assert(std::is_nothrow_default_constructible_v<Variant<S, int>>);
+static_assert(!std::is_nothrow_copy_constructible_v<Variant<S, int>>);
+static_assert(std::is_nothrow_copy_constructible_v<Variant<int, double>>);
+static_assert(std::is_nothrow_copy_assignable_v<Variant<int, double>>);
+static_assert(!std::is_nothrow_move_constructible_v<Variant<LegacyString, int>>);
+static_assert(!std::is_nothrow_move_assignable_v<Variant<int, LegacyString>>);
+// with an allocator, a move keeps it, but a move assignment may have to copy into another resource
+static_assert(std::is_nothrow_move_constructible_v<Variant<std::pmr::string, int>>);
+static_assert(!std::is_nothrow_move_assignable_v<Variant<std::pmr::string, int>>);
+
+// Tuple, Tuple3 and Tuple4: the same, element by element
+static_assert(std::is_nothrow_move_constructible_v<Tuple<S, int, Variant<S, int>>>);
+static_assert(std::is_nothrow_move_assignable_v<Tuple<S, int, Variant<S, int>>>);
+static_assert(std::is_nothrow_default_constructible_v<Tuple<S, int>>);
+static_assert(!std::is_nothrow_move_constructible_v<Tuple<int, LegacyString>>);
+static_assert(std::is_nothrow_constructible_v<Tuple<S, int>, S&&, int>);
+static_assert(!std::is_nothrow_constructible_v<Tuple<S, int>, S const&, int>);
+static_assert(std::is_nothrow_move_constructible_v<Tuple3<S, int>>);
+static_assert(std::is_nothrow_default_constructible_v<Tuple3<S, int>>);
+static_assert(!std::is_nothrow_move_constructible_v<Tuple3<LegacyString, int>>);
+static_assert(std::is_nothrow_move_constructible_v<Tuple4<S, int>>);
+static_assert(std::is_nothrow_default_constructible_v<Tuple4<S, int>>);
+static_assert(!std::is_nothrow_move_constructible_v<Tuple4<int, LegacyString>>);
+
+// the copies and moves made by the reallocations alone: a run with reserve() gives the baseline
+template <typename T>
+void count_relocations(char const* name, std::size_t n)
+{
+  auto fill = [&](bool reserve) {
+    Tracked::copies = Tracked::moves = 0;
+    std::vector<T> v;
+    if(reserve)
+    {
+      v.reserve(n);
+    }
+    for(std::size_t i = 0; i < n; ++i)
+    {
+      v.push_back(T(Tracked()));
+    }
+    return std::pair(Tracked::copies, Tracked::moves);
+  };
+  auto [base_copies, base_moves] = fill(true);
+  auto [copies, moves] = fill(false);
+  std::cout << "  " << name << ": " << copies - base_copies << " copies, " << moves - base_moves
+            << " moves" << std::endl;
+}
+
+// push_back without reserve: the vector reallocates about log2(n) times
+template <typename T, typename Make>
+double growth(std::size_t n, Make make)
+{
+  return time_ms([&] {
+    std::vector<T> v;
+    for(std::size_t i = 0; i < n; ++i)
+    {
+      v.push_back(make(i));
+    }
+    do_not_optimize(v.size());
+  });
+}
+
+int main(int argc, char** argv)
+{
+  std::cout << "relocations of 1000 elements pushed into a growing vector:" << std::endl;
+  count_relocations<Variant<Tracked, int>>("Variant<Tracked, int>", 1000);
+  count_relocations<Variant<Tracked, LegacyString>>("Variant<Tracked, LegacyString>", 1000);
+  count_relocations<Tuple<Tracked>>("Tuple<Tracked>", 1000);
+
+  std::size_t n = size_arg(argc, argv, 2'000'000);
+  // long enough not to fit in the small string buffer, so a copy allocates
+  std::string const text(48, 'x');
+  std::cout << "push_back of " << n << " elements holding a " << text.size()
+            << "-character string:" << std::endl;
+  double fast_ms = growth<Variant<S, int>>(n, [&](std::size_t) { return Variant<S, int>(text); });
+  std::cout << "  Variant<std::string, int>:  " << fast_ms << " ms (moves on growth)" << std::endl;
+  double slow_ms = growth<Variant<LegacyString, int>>(
+    n, [&](std::size_t) { return Variant<LegacyString, int>(LegacyString(text)); });
+  std::cout << "  Variant<LegacyString, int>: " << slow_ms << " ms (copies on growth)" << std::endl;
+  double tuple_ms =
+    growth<Tuple<S, int>>(n, [&](std::size_t i) { return Tuple<S, int>(text, int(i)); });
+  std::cout << "  Tuple<std::string, int>:    " << tuple_ms << " ms (moves on growth)" << std::endl;
+  return 0;
+}
@@ -0,0 +1,202 @@
+#include "../bench/bench.hpp"
+#include "../variant/variant.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#if __has_include(<elf.h>)
+#include <elf.h>
+#endif
+
+/*
+    Built twice from this same file: book_examples_noexceptions with -fno-exceptions, and
+    book_examples_withexceptions without. Everything here goes through the exception-free API of
+    Variant (get_if(), try_visit(), emplace()) or through is<T>() before get<T>(), so both builds run the
+    same code; comparing their output compares the code size and the latency of the two builds.
+*/
+
+struct Quote
+{
+  double bid;
+  double ask;
+};
+
+using Value = Variant<long, double, Quote>;
+
+struct ValueOf
+{
+  double operator()(long x) const
+  {
+    return double(x);
+  }
+  double operator()(double x) const
+  {
+    return x;
+  }
+  double operator()(Quote const& q) const
+  {
+    return (q.bid + q.ask) / 2;
+  }
+};
+
+// the sizes of the sections of this executable that the two builds are expected to differ in
+void print_code_size()
+{
+#if __has_include(<elf.h>)
+  std::ifstream in("/proc/self/exe", std::ios::binary);
+  std::vector<char> image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if(image.size() < sizeof(Elf64_Ehdr))
+  {
+    return;
+  }
+  Elf64_Ehdr header;
+  std::memcpy(&header, image.data(), sizeof(header));
+  std::vector<Elf64_Shdr> sections(header.e_shnum);
+  std::memcpy(sections.data(), image.data() + header.e_shoff, header.e_shnum * sizeof(Elf64_Shdr));
+  char const* names = image.data() + sections[header.e_shstrndx].sh_offset;
+  std::cout << "sections:";
+  for(Elf64_Shdr const& s : sections)
+  {
+    std::string name = names + s.sh_name;
+    if(name == ".text" || name == ".eh_frame" || name == ".gcc_except_table")
+    {
+      std::cout << " " << name << " " << s.sh_size << " B";
+    }
+  }
+  std::cout << std::endl;
+#endif
+}
+
+[[gnu::noinline]] double sum_get(std::vector<Value> const& column)
+{
+  double sum = 0;
+  for(Value const& v : column)
+  {
+    if(v.is<long>())
+    {
+      sum += double(v.get<long>());
+    }
+    else if(v.is<double>())
+    {
+      sum += v.get<double>();
+    }
+    else
+    {
+      sum += ValueOf()(v.get<Quote>());
+    }
+  }
+  return sum;
+}
+
+[[gnu::noinline]] double sum_get_if(std::vector<Value> const& column)
+{
+  double sum = 0;
+  for(Value const& v : column)
+  {
+    if(long const* x = v.get_if<long>())
+    {
+      sum += double(*x);
+    }
+    else if(double const* d = v.get_if<double>())
+    {
+      sum += *d;
+    }
+    else if(Quote const* q = v.get_if<Quote>())
+    {
+      sum += ValueOf()(*q);
+    }
+  }
+  return sum;
+}
+
+[[gnu::noinline]] double sum_visit(std::vector<Value> const& column)
+{
+  double sum = 0;
+  for(Value const& v : column)
+  {
+    sum += v.visit<double>(ValueOf());
+  }
+  return sum;
+}
+
+[[gnu::noinline]] double sum_try_visit(std::vector<Value> const& column)
+{
+  double sum = 0;
+  for(Value const& v : column)
+  {
+    sum += v.try_visit<double>(ValueOf()).value_or(0.0);
+  }
+  return sum;
+}
+
+[[gnu::noinline]] void fill_assign(std::vector<Value>& column)
+{
+  for(std::size_t i = 0; i < column.size(); ++i)
+  {
+    column[i] = Quote{double(i), double(i) + 1};
+  }
+}
+
+[[gnu::noinline]] void fill_emplace(std::vector<Value>& column)
+{
+  for(std::size_t i = 0; i < column.size(); ++i)
+  {
+    column[i].emplace<Quote>(Quote{double(i), double(i) + 1});
+  }
+}
+
+int main(int argc, char** argv)
+{
+#if defined(__cpp_exceptions)
+  std::cout << "built with exceptions" << std::endl;
+#else
+  std::cout << "built with -fno-exceptions" << std::endl;
+#endif
+  Value v(2.5);
+  std::cout << std::boolalpha << "v.get_if<long>() is null: " << (v.get_if<long>() == nullptr)
+            << ", *v.get_if<double>(): " << *v.get_if<double>() << std::endl;
+  v.emplace<Quote>(Quote{1.0, 2.0});
+  std::cout << "after emplace<Quote>: v.try_visit(ValueOf()) = " << *v.try_visit(ValueOf())
+            << std::endl;
+  v.destroy();
+  std::cout << "empty v: try_visit() has a value: " << v.try_visit(ValueOf()).has_value()
+            << std::endl;
+  Value w(7L);
+  if(long* x = w.get_if<long>())
+  {
+    *x *= 6;
+  }
+  std::cout << "w after multiplying in place through get_if(): " << *w.get_if<long>() << std::endl;
+  print_code_size();
+
+  std::size_t n = size_arg(argc, argv, 10'000'000);
+  std::vector<Value> column(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    switch(i % 3)
+    {
+      case 0:
+        column[i].emplace<long>(long(i));
+        break;
+      case 1:
+        column[i].emplace<double>(double(i) / 2);
+        break;
+      default:
+        column[i].emplace<Quote>(Quote{double(i), double(i) + 2});
+    }
+  }
+  auto per_element = [&](auto f) { return time_ms(f) * 1e6 / double(n); };
+  std::cout << "ns per element over " << n << " values:" << std::endl;
+  std::cout << "  is/get:    " << per_element([&] { do_not_optimize(sum_get(column)); }) << std::endl;
+  std::cout << "  get_if:    " << per_element([&] { do_not_optimize(sum_get_if(column)); })
+            << std::endl;
+  std::cout << "  visit:     " << per_element([&] { do_not_optimize(sum_visit(column)); })
+            << std::endl;
+  std::cout << "  try_visit: " << per_element([&] { do_not_optimize(sum_try_visit(column)); })
+            << std::endl;
+  std::cout << "  operator=: " << per_element([&] { fill_assign(column); }) << std::endl;
+  std::cout << "  emplace:   " << per_element([&] { fill_emplace(column); }) << std::endl;
+  return 0;
+}
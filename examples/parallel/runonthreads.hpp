@@ -0,0 +1,19 @@
+#pragma once
+#include <thread>
+#include <vector>
+
+// runs f(0), ..., f(n - 1) concurrently, f(0) on the calling thread
+template <typename F>
+void run_on_threads(unsigned n, F const& f)
+{
+  std::vector<std::thread> pool;
+  for(unsigned t = 1; t < n; ++t)
+  {
+    pool.emplace_back(f, t);
+  }
+  f(0);
+  for(auto& th : pool)
+  {
+    th.join();
+  }
+}
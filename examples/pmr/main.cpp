@@ -0,0 +1,196 @@
+#include "../bench/bench.hpp"
+#include "../parallel/runonthreads.hpp"
+#include "../tuple/optimized/tuplestorage4.hpp"
+#include "../tuple/tuple.hpp"
+#include "../tuple/tupleio.hpp"
+#include "../variant/variant.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// count every heap allocation made by the program, to show which layouts reach malloc at all
+// (GCC flags free() on memory from operator new even when operator new itself calls malloc)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+static std::atomic<std::size_t> allocations{0};
+
+void* operator new(std::size_t size)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if(void* p = std::malloc(size ? size : 1))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  ::operator delete(p);
+}
+
+// the form std::pmr::new_delete_resource() calls
+void* operator new(std::size_t size, std::align_val_t align)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  std::size_t a = static_cast<std::size_t>(align);
+  if(void* p = std::aligned_alloc(a, (size + a - 1) / a * a))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+  std::free(p);
+}
+
+struct StdTypes
+{
+  using String = std::string;
+  template <typename T>
+  using Vector = std::vector<T>;
+};
+
+struct PmrTypes
+{
+  using String = std::pmr::string;
+  template <typename T>
+  using Vector = std::pmr::vector<T>;
+};
+
+// (name, quantity, samples)
+template <typename Types>
+using Row = Tuple<typename Types::String, int, typename Types::template Vector<int>>;
+template <typename Types>
+using Message = Variant<long, typename Types::String, Row<Types>>;
+
+static_assert(std::uses_allocator_v<Row<PmrTypes>, std::pmr::polymorphic_allocator<>>);
+static_assert(std::uses_allocator_v<Message<PmrTypes>, std::pmr::polymorphic_allocator<>>);
+static_assert(!std::uses_allocator_v<Message<StdTypes>, std::pmr::polymorphic_allocator<>>);
+static_assert(sizeof(Variant<int, double>) == 16); // no room taken when there is no allocator
+
+// names too long for the small string buffer, so that every string allocates
+std::string_view name(std::size_t i)
+{
+  static std::vector<std::string> names = [] {
+    std::vector<std::string> v;
+    for(int i = 0; i < 64; ++i)
+    {
+      v.push_back("customer-with-a-rather-long-name-" + std::to_string(i));
+    }
+    return v;
+  }();
+  return names[i % names.size()];
+}
+
+// what one request does: build its rows, wrap them and some strings into messages, summarize them.
+// The allocator, if any, is passed to the containers and reaches every element from there.
+template <typename Types, typename... Alloc>
+std::size_t handle_request(std::size_t id, Alloc const&... alloc)
+{
+  constexpr std::size_t rows_per_request = 64;
+  typename Types::template Vector<Row<Types>> rows(alloc...);
+  typename Types::template Vector<Message<Types>> messages(alloc...);
+  for(std::size_t i = 0; i < rows_per_request; ++i)
+  {
+    rows.emplace_back(name(id + i), int(i), std::size_t(8));
+  }
+  for(std::size_t i = 0; i < rows_per_request; ++i)
+  {
+    messages.emplace_back(long(id + i));
+    messages.emplace_back(typename Types::String(name(id * i), alloc...));
+    messages.emplace_back(rows[i]);
+  }
+  std::size_t sum = 0;
+  for(auto const& m : messages)
+  {
+    sum += m.template visit<std::size_t>([](auto const& value) {
+      if constexpr(std::is_same_v<std::decay_t<decltype(value)>, long>)
+      {
+        return value;
+      }
+      else if constexpr(std::is_same_v<std::decay_t<decltype(value)>, Row<Types>>)
+      {
+        return get<0>(value).size() + get<2>(value).size();
+      }
+      else
+      {
+        return value.size();
+      }
+    });
+  }
+  return sum;
+}
+
+int main(int argc, char** argv)
+{
+  std::pmr::monotonic_buffer_resource arena;
+  std::pmr::polymorphic_allocator<> alloc(&arena);
+  Tuple<std::pmr::string, int> t(std::allocator_arg, alloc, name(0), 1);
+  std::pmr::vector<Tuple<std::pmr::string, int>> v(alloc);
+  v.emplace_back(name(1), 2);
+  v.push_back(t);
+  Tuple4<std::pmr::string, int> t4(std::allocator_arg, alloc, name(2), 3);
+  std::cout << std::boolalpha << "t is: " << t << std::endl;
+  std::cout << "strings of t, v and t4 in the arena: "
+            << (get<0>(t).get_allocator().resource() == &arena &&
+                get<0>(v[0]).get_allocator().resource() == &arena &&
+                get<0>(v[1]).get_allocator().resource() == &arena &&
+                t4.get_head().get_allocator().resource() == &arena)
+            << std::endl;
+  Message<PmrTypes> m(std::allocator_arg, alloc, 42L);
+  m = std::pmr::string(name(3)); // assigned from the default resource, rebuilt in the arena
+  std::cout << "variant assignment keeps the arena: "
+            << (m.get<std::pmr::string>().get_allocator().resource() == &arena) << std::endl;
+
+  std::size_t n = size_arg(argc, argv, 100'000);
+  std::cout << n << " requests of 64 rows and 192 messages each:" << std::endl;
+  for(unsigned threads : thread_counts())
+  {
+    auto run = [&](char const* label, auto const& handle) {
+      std::size_t allocs = allocations.load();
+      double ms = time_ms(
+        [&] {
+          run_on_threads(threads, [&](unsigned t) {
+            std::size_t sum = 0;
+            for(std::size_t r = t; r < n; r += threads)
+            {
+              sum += handle(r);
+            }
+            do_not_optimize(sum);
+          });
+        },
+        1);
+      std::cout << "  " << threads << " threads, " << label << ms << " ms, "
+                << double(allocations.load() - allocs) / n << " mallocs/request" << std::endl;
+    };
+    run("std:: (global heap):   ", [](std::size_t r) { return handle_request<StdTypes>(r); });
+    run("pmr:: (global heap):   ", [](std::size_t r) {
+      std::pmr::polymorphic_allocator<> heap(std::pmr::new_delete_resource());
+      return handle_request<PmrTypes>(r, heap);
+    });
+    run("pmr:: (request arena): ", [](std::size_t r) {
+      // one buffer per thread, reused by every request; the arena is released at the end of each
+      thread_local std::vector<std::byte> buffer(256 * 1024);
+      std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+      return handle_request<PmrTypes>(r, std::pmr::polymorphic_allocator<>(&arena));
+    });
+  }
+  return 0;
+}
@@ -0,0 +1,171 @@
+#include "../bench/bench.hpp"
+#include "../parallel/runonthreads.hpp"
+#include "../tuple/tuple.hpp"
+#include "rcu.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+
+/*
+    A configuration Tuple (a timeout, a retry count derived from it, a sampling rate and an
+    endpoint) reloaded by one thread while others read it: a reader must never see a mix of two
+    versions. Then the reads per second of 1, 2, 4... threads (and of 64, the second argument) while
+    the configuration is replaced every millisecond, through an RcuCell, a std::shared_mutex and a
+    std::atomic<std::shared_ptr>. On a single core the readers take turns, and the costs compared are
+    those of one uncontended reader: the lines bouncing between readers only show with more cores.
+*/
+
+using Config = Tuple<std::uint32_t, std::uint32_t, double, std::string>;
+
+Config make_config(std::uint32_t version)
+{
+  return Config(100 + version, (100 + version) / 10, 1.0 / (1 + version % 100),
+                "https://collector.internal/v" + std::to_string(version));
+}
+
+// the fields of a snapshot agree, and its version
+std::uint32_t version_of(Config const& c)
+{
+  std::uint32_t version = get<0>(c) - 100;
+  bool consistent = get<1>(c) == get<0>(c) / 10 && get<2>(c) == 1.0 / (1 + version % 100) &&
+                    get<3>(c) == "https://collector.internal/v" + std::to_string(version);
+  return consistent ? version : ~0u;
+}
+
+void demo()
+{
+  RcuCell<Config> config(make_config(0));
+  std::atomic<bool> done{false};
+  std::atomic<unsigned> started{0};
+  std::atomic<std::size_t> torn{0}, reads{0}, versions{0};
+  std::thread reloader([&] {
+    while(started.load() < 4)
+    {
+      std::this_thread::yield();
+    }
+    for(std::uint32_t v = 1; v <= 1000; ++v)
+    {
+      config.update([v](Config const& old) { return make_config(version_of(old) + 1 == v ? v : 0); });
+      std::this_thread::yield();
+    }
+    done.store(true);
+  });
+  run_on_threads(4, [&](unsigned) {
+    std::size_t n = 0, seen = 0;
+    std::uint32_t last = 0;
+    started.fetch_add(1);
+    while(!done.load(std::memory_order_relaxed) || n < 1000)
+    {
+      auto snapshot = config.read();
+      std::uint32_t version = version_of(*snapshot);
+      {
+        // a nested section may see a newer snapshot, and the outer one stays valid
+        auto nested = config.read();
+        if(version == ~0u || version < last || version_of(*nested) < version ||
+           version_of(*snapshot) != version)
+        {
+          torn.fetch_add(1);
+        }
+      }
+      seen += version != last ? 1 : 0;
+      last = version;
+      ++n;
+      std::this_thread::yield();
+    }
+    reads.fetch_add(n);
+    versions.fetch_add(seen);
+  });
+  reloader.join();
+  std::cout << "1000 reloads under 4 readers: " << reads.load() << " reads, " << versions.load()
+            << " versions seen, last " << version_of(*config.read()) << ", " << torn.load()
+            << " inconsistent" << std::endl;
+}
+
+// reads per second of threads each calling read() n times, while a writer calls write() every ms
+template <typename Read, typename Write>
+double reads_per_second(unsigned threads, std::size_t n, Read const& read, Write const& write)
+{
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    for(std::uint32_t v = 1; !done.load(); ++v)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      write(v);
+    }
+  });
+  double ms = time_ms([&] {
+    run_on_threads(threads, [&](unsigned) {
+      std::size_t sum = 0;
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        sum += read();
+      }
+      do_not_optimize(sum);
+    });
+  });
+  done.store(true);
+  writer.join();
+  return double(threads) * double(n) / ms * 1e3;
+}
+
+void benchmark(unsigned threads, std::size_t n)
+{
+  RcuCell<Config> rcu(make_config(0));
+  double rcu_reads = reads_per_second(
+    threads, n,
+    [&] {
+      auto c = rcu.read();
+      return get<0>(*c) + get<1>(*c) + get<3>(*c).size();
+    },
+    [&](std::uint32_t v) { rcu.store(make_config(v)); });
+
+  std::shared_mutex mutex;
+  Config locked = make_config(0);
+  double locked_reads = reads_per_second(
+    threads, n,
+    [&] {
+      std::shared_lock<std::shared_mutex> lock(mutex);
+      return get<0>(locked) + get<1>(locked) + get<3>(locked).size();
+    },
+    [&](std::uint32_t v) {
+      Config next = make_config(v);
+      std::unique_lock<std::shared_mutex> lock(mutex);
+      locked = std::move(next);
+    });
+
+  std::atomic<std::shared_ptr<Config const>> shared(std::make_shared<Config const>(make_config(0)));
+  double shared_reads = reads_per_second(
+    threads, n,
+    [&] {
+      std::shared_ptr<Config const> c = shared.load();
+      return get<0>(*c) + get<1>(*c) + get<3>(*c).size();
+    },
+    [&](std::uint32_t v) { shared.store(std::make_shared<Config const>(make_config(v))); });
+
+  std::cout << threads << " readers, millions of reads per second: RcuCell " << rcu_reads / 1e6
+            << ", shared_mutex " << locked_reads / 1e6 << ", atomic<shared_ptr> " << shared_reads / 1e6
+            << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t n = size_arg(argc, argv, 2'000'000);
+  auto threads = unsigned(size_arg(argc, argv, 64, 2));
+
+  demo();
+  for(unsigned t : thread_counts())
+  {
+    benchmark(t, n);
+  }
+  if(hardware_threads() < threads)
+  {
+    benchmark(threads, n / threads);
+  }
+  return 0;
+}
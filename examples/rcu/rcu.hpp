@@ -0,0 +1,118 @@
+#pragma once
+#include "threadslots.hpp"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+/*
+    Read-copy-update for a value read by many threads and replaced now and then, a configuration
+    Tuple reloaded while every request reads it. Under a std::shared_mutex each read takes and gives
+    back the lock, two atomic writes to the one cache line shared by all the readers; a
+    std::atomic<std::shared_ptr> has its readers increment and decrement a shared count (and, in
+    libstdc++, take a lock bit in the pointer), the same line again.
+    RcuCell<T> never lets a reader write to shared memory:
+    - the current value is an immutable snapshot, published through an atomic pointer;
+    - a reader announces a read section by storing the current epoch in its own slot, a cache line
+      per thread (ReaderEpochs, threadslots.hpp), then loads the pointer: wait-free, no loop, no
+      locked instruction but the store of the slot. The slot goes back to 0 when the section ends;
+    - a writer builds the new value off to the side, from a copy of the old one, swaps the pointer,
+      advances the epoch and waits for a grace period: until every slot is either 0 or holds the new
+      epoch, so that no reader can still see the old snapshot. Then it frees it.
+    Writers are serialized by a mutex and wait for the readers, which never wait for anything: the
+    trade is right for a value read a million times for each update. A read section must not update
+    the cell it reads (the writer would wait for itself). Read sections nest.
+    Threads beyond the slots count themselves in one shared counter instead, still wait-free but
+    contended, and a grace period waits for a moment when that counter is 0.
+*/
+
+template <typename T>
+class RcuCell
+{
+  std::atomic<T const*> current;
+  ReaderEpochs readers;
+  std::mutex writers;
+
+  // under the writers' mutex, after the pointer was swapped: waits until no reader can see the old one
+  void synchronize()
+  {
+    readers.wait_for(readers.advance());
+  }
+
+  void replace(T const* next)
+  {
+    T const* old = current.exchange(next);
+    synchronize();
+    delete old;
+  }
+
+  public:
+  // a read section: the snapshot it points to lives at least until the guard is destroyed
+  class ReadGuard
+  {
+    friend class RcuCell;
+
+    ReaderEpochs::Section section;
+    T const* value;
+
+    explicit ReadGuard(RcuCell& c) noexcept
+      : section(c.readers)
+      , value(c.current.load())
+    { }
+
+    public:
+    ReadGuard(ReadGuard const&) = delete;
+    ReadGuard& operator=(ReadGuard const&) = delete;
+
+    T const& operator*() const noexcept
+    {
+      return *value;
+    }
+
+    T const* operator->() const noexcept
+    {
+      return value;
+    }
+  };
+
+  template <typename... Args>
+  explicit RcuCell(std::in_place_t, Args&&... args)
+    : current(new T(std::forward<Args>(args)...))
+  { }
+
+  explicit RcuCell(T value)
+    : RcuCell(std::in_place, std::move(value))
+  { }
+
+  RcuCell(RcuCell const&) = delete;
+  RcuCell& operator=(RcuCell const&) = delete;
+
+  // no reader may be left
+  ~RcuCell()
+  {
+    delete current.load();
+  }
+
+  ReadGuard read() noexcept
+  {
+    return ReadGuard(*this);
+  }
+
+  // publishes value; returns once the old snapshot is freed
+  void store(T value)
+  {
+    auto next = std::make_unique<T const>(std::move(value));
+    std::lock_guard<std::mutex> lock(writers);
+    replace(next.release());
+  }
+
+  // publishes f(old value), f called on the snapshot current under the writers' mutex
+  template <typename F>
+  void update(F&& f)
+  {
+    std::lock_guard<std::mutex> lock(writers);
+    auto next = std::make_unique<T const>(f(*current.load(std::memory_order_relaxed)));
+    replace(next.release());
+  }
+};
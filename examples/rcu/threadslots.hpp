@@ -0,0 +1,204 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    Per-thread records for the structures whose readers must not share a cache line: the metrics
+    shards, the reader slots of RcuCell and EventBus, the records of EpochDomain.
+    - thread_slot() is a small number for the calling thread, unique among the live threads and
+      reused once its thread has finished, so that arrays indexed by it stay small.
+    - ThreadSlots<Record> is an array of capacity records indexed by it. own() returns the record of
+      the calling thread and keeps track of one past the highest record claimed, so that a scan of
+      all the records stops at used(), not at the capacity. Threads beyond the capacity get nullptr.
+    - ReaderEpochs is the grace-period half of read-copy-update, over a ThreadSlots of epochs. A read
+      section stores the current epoch in its thread's record (nested sections leave it alone) and
+      clears it at the end: a store and a fence, and no write to a line shared with other readers.
+      A writer that has unlinked something advances the epoch; once oldest() has reached the epoch
+      returned, no section begun before the unlinking is still in progress. Threads beyond the
+      capacity count themselves in one shared counter instead, and hold oldest() at 0 meanwhile.
+*/
+
+// a small number for the calling thread, unique among the live threads
+inline unsigned thread_slot()
+{
+  struct Slots
+  {
+    std::mutex mutex;
+    std::vector<unsigned> released;
+    unsigned next = 0;
+  };
+  static Slots& slots = *new Slots; // never destroyed: threads may finish during static destruction
+
+  struct Slot
+  {
+    unsigned index;
+
+    Slot()
+    {
+      std::lock_guard<std::mutex> lock(slots.mutex);
+      if(slots.released.empty())
+      {
+        index = slots.next++;
+      }
+      else
+      {
+        index = slots.released.back();
+        slots.released.pop_back();
+      }
+    }
+
+    ~Slot()
+    {
+      std::lock_guard<std::mutex> lock(slots.mutex);
+      slots.released.push_back(index);
+    }
+  };
+  thread_local Slot slot;
+  return slot.index;
+}
+
+template <typename Record>
+class ThreadSlots
+{
+  std::unique_ptr<Record[]> records;
+  unsigned capacity;
+  std::atomic<unsigned> used_count{0}; // one past the highest record claimed
+
+  public:
+  explicit ThreadSlots(unsigned capacity)
+    : records(new Record[capacity])
+    , capacity(capacity)
+  { }
+
+  ThreadSlots(ThreadSlots const&) = delete;
+  ThreadSlots& operator=(ThreadSlots const&) = delete;
+
+  // the record of the calling thread, or nullptr beyond the capacity
+  Record* own() noexcept
+  {
+    unsigned index = thread_slot();
+    if(index >= capacity)
+    {
+      return nullptr;
+    }
+    unsigned used = used_count.load();
+    while(used <= index && !used_count.compare_exchange_weak(used, index + 1))
+    { }
+    return &records[index];
+  }
+
+  unsigned used() const noexcept
+  {
+    return used_count.load();
+  }
+
+  Record& operator[](unsigned i) noexcept
+  {
+    return records[i];
+  }
+
+  Record const& operator[](unsigned i) const noexcept
+  {
+    return records[i];
+  }
+};
+
+class ReaderEpochs
+{
+  struct alignas(64) Slot
+  {
+    std::atomic<std::uint64_t> epoch{0}; // of the read section in progress, or 0
+  };
+
+  ThreadSlots<Slot> slots;
+  std::atomic<std::uint64_t> epoch{1};
+  alignas(64) std::atomic<std::uint64_t> overflow_readers{0};
+
+  public:
+  // a read section: whatever it loads is not reclaimed until the section is destroyed
+  class Section
+  {
+    ReaderEpochs* readers;
+    Slot* slot;     // nullptr when counted in overflow_readers
+    bool outermost; // the section that ends the thread's reading
+
+    public:
+    explicit Section(ReaderEpochs& r) noexcept
+      : readers(&r)
+      , slot(r.slots.own())
+      , outermost(slot == nullptr || slot->epoch.load(std::memory_order_relaxed) == 0)
+    {
+      if(slot == nullptr)
+      {
+        readers->overflow_readers.fetch_add(1);
+      }
+      else if(outermost)
+      {
+        slot->epoch.store(readers->epoch.load());
+      }
+    }
+
+    Section(Section const&) = delete;
+    Section& operator=(Section const&) = delete;
+
+    ~Section()
+    {
+      if(slot == nullptr)
+      {
+        readers->overflow_readers.fetch_sub(1, std::memory_order_release);
+      }
+      else if(outermost)
+      {
+        slot->epoch.store(0, std::memory_order_release);
+      }
+    }
+  };
+
+  explicit ReaderEpochs(unsigned capacity = 256)
+    : slots(capacity)
+  { }
+
+  Section enter() noexcept
+  {
+    return Section(*this);
+  }
+
+  // after the writer unlinked something: the epoch that oldest() must reach before it is reclaimed
+  std::uint64_t advance() noexcept
+  {
+    return epoch.fetch_add(1) + 1;
+  }
+
+  // the epoch of the oldest section in progress, ~0 if none, 0 while a thread is counted in overflow
+  std::uint64_t oldest() const noexcept
+  {
+    if(overflow_readers.load() != 0)
+    {
+      return 0;
+    }
+    std::uint64_t result = ~std::uint64_t(0);
+    unsigned used = slots.used();
+    for(unsigned i = 0; i < used; ++i)
+    {
+      std::uint64_t e = slots[i].epoch.load();
+      if(e != 0 && e < result)
+      {
+        result = e;
+      }
+    }
+    return result;
+  }
+
+  // outside any read section: waits until oldest() reaches e
+  void wait_for(std::uint64_t e) const noexcept
+  {
+    while(oldest() < e)
+    {
+      std::this_thread::yield();
+    }
+  }
+};
@@ -0,0 +1,156 @@
+#include "../bench/bench.hpp"
+#include "../tuple/optimized/tuplestorage4.hpp"
+#include "../tuple/tuple.hpp"
+#include "../variant/variant.hpp"
+#include "relocatingvector.hpp"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using Name = std::unique_ptr<std::string>;
+using Record = Tuple<Name, int>;
+using Cell = Variant<Name, std::vector<int>, long>;
+using StringRecord = Tuple<std::string, int>;
+
+// none of them can be copied bitwise, but all of them can be moved bitwise
+static_assert(!IsTriviallyCopyable<Record>::value && IsTriviallyRelocatable<Record>::value);
+static_assert(!IsTriviallyCopyable<Cell>::value && IsTriviallyRelocatable<Cell>::value);
+static_assert(IsTriviallyRelocatable<Tuple4<Name, std::shared_ptr<int>, double>>::value);
+static_assert(IsTriviallyRelocatable<Tuple<Cell, std::vector<Record>>>::value);
+// std::string is only trivially relocatable where its small strings do not point into the object
+#if defined(_LIBCPP_VERSION)
+static_assert(IsTriviallyRelocatable<StringRecord>::value);
+#else
+static_assert(!IsTriviallyRelocatable<StringRecord>::value);
+#endif
+
+struct Timings
+{
+  double growth_ms = 0;
+  double insert_ms = 0;
+  double erase_ms = 0;
+};
+
+// push_back of n elements without reserve, then k inserts and k erases in the middle of m elements;
+// the elements are made before each timed section, so that only moving them around is measured
+template <typename Vec, typename Make>
+Timings measure(std::size_t n, std::size_t m, std::size_t k, Make make)
+{
+  using T = typename Vec::value_type;
+  auto make_all = [&](std::size_t count) {
+    std::vector<T> items;
+    items.reserve(count);
+    for(std::size_t i = 0; i < count; ++i)
+    {
+      items.push_back(make(i));
+    }
+    return items;
+  };
+  Timings best;
+  for(unsigned rep = 0; rep < 3; ++rep)
+  {
+    std::vector<T> items = make_all(n);
+    Stopwatch sw;
+    Vec grown;
+    for(T& x : items)
+    {
+      grown.push_back(std::move(x));
+    }
+    double growth_ms = sw.elapsed_ms();
+    do_not_optimize(grown.data());
+
+    items = make_all(m + k);
+    Vec v;
+    v.reserve(m + k);
+    for(std::size_t i = 0; i < m; ++i)
+    {
+      v.push_back(std::move(items[i]));
+    }
+    sw.reset();
+    for(std::size_t i = 0; i < k; ++i)
+    {
+      v.insert(v.begin() + v.size() / 2, std::move(items[m + i]));
+    }
+    double insert_ms = sw.elapsed_ms();
+    sw.reset();
+    for(std::size_t i = 0; i < k; ++i)
+    {
+      v.erase(v.begin() + v.size() / 2);
+    }
+    double erase_ms = sw.elapsed_ms();
+    do_not_optimize(v.data());
+
+    if(rep == 0 || growth_ms < best.growth_ms)
+    {
+      best.growth_ms = growth_ms;
+    }
+    if(rep == 0 || insert_ms < best.insert_ms)
+    {
+      best.insert_ms = insert_ms;
+    }
+    if(rep == 0 || erase_ms < best.erase_ms)
+    {
+      best.erase_ms = erase_ms;
+    }
+  }
+  return best;
+}
+
+template <typename T, typename Make>
+void compare(char const* name, std::size_t n, std::size_t m, std::size_t k, Make make)
+{
+  Timings standard = measure<std::vector<T>>(n, m, k, make);
+  Timings relocating = measure<RelocatingVector<T>>(n, m, k, make);
+  std::cout << name << (IsTriviallyRelocatable<T>::value ? " (trivially relocatable):" : ":")
+            << std::endl;
+  std::cout << "  growth: std::vector " << standard.growth_ms << " ms, RelocatingVector "
+            << relocating.growth_ms << " ms" << std::endl;
+  std::cout << "  insert: std::vector " << standard.insert_ms << " ms, RelocatingVector "
+            << relocating.insert_ms << " ms" << std::endl;
+  std::cout << "  erase:  std::vector " << standard.erase_ms << " ms, RelocatingVector "
+            << relocating.erase_ms << " ms" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  RelocatingVector<Record> records;
+  for(int i = 0; i < 5; ++i)
+  {
+    records.emplace_back(std::make_unique<std::string>("record " + std::to_string(i)), i);
+  }
+  records.insert(records.begin() + 2, Record(std::make_unique<std::string>("inserted"), 99));
+  records.erase(records.begin());
+  std::cout << "records:";
+  for(Record const& r : records)
+  {
+    std::cout << " (" << *get<0>(r) << ", " << get<1>(r) << ")";
+  }
+  std::cout << std::endl;
+
+  std::size_t n = size_arg(argc, argv, 1'000'000);
+  std::size_t m = std::max<std::size_t>(n / 20, 1);
+  std::size_t k = std::max<std::size_t>(m / 50, 1);
+  std::cout << "push_back of " << n << " elements, then " << k << " inserts and " << k
+            << " erases in the middle of " << m << " elements" << std::endl;
+  // long enough not to fit in the small string buffer
+  std::string const text(48, 'x');
+  compare<Record>("Tuple<std::unique_ptr<std::string>, int>", n, m, k,
+                  [&](std::size_t i) { return Record(std::make_unique<std::string>(text), int(i)); });
+  compare<Cell>("Variant<std::unique_ptr<std::string>, std::vector<int>, long>", n, m, k,
+                [&](std::size_t i) {
+                  switch(i % 3)
+                  {
+                    case 0:
+                      return Cell(std::make_unique<std::string>(text));
+                    case 1:
+                      return Cell(std::vector<int>(4, int(i)));
+                    default:
+                      return Cell(long(i));
+                  }
+                });
+  compare<StringRecord>("Tuple<std::string, int>", n, m, k,
+                        [&](std::size_t i) { return StringRecord(text, int(i)); });
+  return 0;
+}
@@ -0,0 +1,271 @@
+#pragma once
+#include "../traits/triviallyrelocatable.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+    A vector that moves its elements around with relocate(): when it grows, and when insert() and
+    erase() open or close a gap, every element that changes address is relocated, which for a
+    trivially relocatable T is one memmove of the whole block instead of a move construction and a
+    destruction per element (std::vector must do the latter for anything that is not trivially
+    copyable, even a Tuple of std::unique_ptrs or a Variant holding a std::vector).
+    Shifting elements with relocate() also means that insert() and erase() never move-assign: the
+    elements in the gap are destroyed or constructed, the others just change address.
+    Since relocate() cannot be undone halfway, T must be trivially relocatable or nothrow move
+    constructible. A new element is always built before anything moves, so the arguments of
+    emplace() and emplace_back() may refer to elements of the vector itself, and nothing can throw
+    once the gap is open.
+*/
+template <typename T>
+class RelocatingVector
+{
+  static_assert(IsTriviallyRelocatable<T>::value || std::is_nothrow_move_constructible_v<T>,
+                "RelocatingVector needs a trivially relocatable or nothrow movable type");
+
+  T* first = nullptr;
+  std::size_t count = 0;
+  std::size_t cap = 0;
+
+  static T* allocate(std::size_t n)
+  {
+    return std::allocator<T>().allocate(n);
+  }
+
+  static void deallocate(T* p, std::size_t n) noexcept
+  {
+    if(p)
+    {
+      std::allocator<T>().deallocate(p, n);
+    }
+  }
+
+  std::size_t grown() const noexcept
+  {
+    return std::max<std::size_t>(1, 2 * cap);
+  }
+
+  // moves the elements to a buffer of capacity n, leaving a hole at index gap if gap < count
+  void reallocate(std::size_t n, T* buffer, std::size_t gap) noexcept
+  {
+    std::size_t before = std::min(gap, count);
+    relocate(first, before, buffer);
+    relocate(first + before, count - before, buffer + before + (gap < count));
+    deallocate(first, cap);
+    first = buffer;
+    cap = n;
+  }
+
+  public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = T const*;
+
+  RelocatingVector() = default;
+
+  RelocatingVector(RelocatingVector const& other)
+    : first(other.count ? allocate(other.count) : nullptr)
+    , cap(other.count)
+  {
+    try
+    {
+      std::uninitialized_copy(other.begin(), other.end(), first);
+    }
+    catch(...)
+    {
+      deallocate(first, cap);
+      throw;
+    }
+    count = other.count;
+  }
+
+  RelocatingVector(RelocatingVector&& other) noexcept
+    : first(std::exchange(other.first, nullptr))
+    , count(std::exchange(other.count, 0))
+    , cap(std::exchange(other.cap, 0))
+  { }
+
+  RelocatingVector& operator=(RelocatingVector other) noexcept
+  {
+    swap(other);
+    return *this;
+  }
+
+  ~RelocatingVector()
+  {
+    clear();
+    deallocate(first, cap);
+  }
+
+  void swap(RelocatingVector& other) noexcept
+  {
+    std::swap(first, other.first);
+    std::swap(count, other.count);
+    std::swap(cap, other.cap);
+  }
+
+  std::size_t size() const noexcept
+  {
+    return count;
+  }
+
+  std::size_t capacity() const noexcept
+  {
+    return cap;
+  }
+
+  bool empty() const noexcept
+  {
+    return count == 0;
+  }
+
+  T* data() noexcept
+  {
+    return first;
+  }
+
+  T const* data() const noexcept
+  {
+    return first;
+  }
+
+  T* begin() noexcept
+  {
+    return first;
+  }
+
+  T* end() noexcept
+  {
+    return first + count;
+  }
+
+  T const* begin() const noexcept
+  {
+    return first;
+  }
+
+  T const* end() const noexcept
+  {
+    return first + count;
+  }
+
+  T& operator[](std::size_t i) noexcept
+  {
+    return first[i];
+  }
+
+  T const& operator[](std::size_t i) const noexcept
+  {
+    return first[i];
+  }
+
+  T& front() noexcept
+  {
+    return first[0];
+  }
+
+  T& back() noexcept
+  {
+    return first[count - 1];
+  }
+
+  void reserve(std::size_t n)
+  {
+    if(n > cap)
+    {
+      reallocate(n, allocate(n), count);
+    }
+  }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args)
+  {
+    return *emplace(end(), std::forward<Args>(args)...);
+  }
+
+  void push_back(T const& value)
+  {
+    emplace_back(value);
+  }
+
+  void push_back(T&& value)
+  {
+    emplace_back(std::move(value));
+  }
+
+  template <typename... Args>
+  T* emplace(T const* pos, Args&&... args)
+  {
+    std::size_t i = std::size_t(pos - first);
+    if(count == cap)
+    {
+      // the new element goes straight into the new buffer, then the others move around it
+      std::size_t n = grown();
+      T* buffer = allocate(n);
+      try
+      {
+        ::new(static_cast<void*>(buffer + i)) T(std::forward<Args>(args)...);
+      }
+      catch(...)
+      {
+        deallocate(buffer, n);
+        throw;
+      }
+      reallocate(n, buffer, i);
+    }
+    else if(i == count)
+    {
+      ::new(static_cast<void*>(first + i)) T(std::forward<Args>(args)...);
+    }
+    else
+    {
+      // built aside, then relocated into the gap
+      alignas(T) unsigned char aside[sizeof(T)];
+      T* value = ::new(static_cast<void*>(aside)) T(std::forward<Args>(args)...);
+      relocate(first + i, count - i, first + i + 1);
+      relocate(value, 1, first + i);
+    }
+    ++count;
+    return first + i;
+  }
+
+  T* insert(T const* pos, T const& value)
+  {
+    return emplace(pos, value);
+  }
+
+  T* insert(T const* pos, T&& value)
+  {
+    return emplace(pos, std::move(value));
+  }
+
+  T* erase(T const* pos) noexcept
+  {
+    return erase(pos, pos + 1);
+  }
+
+  // destroys [from, to) and relocates the tail down over them
+  T* erase(T const* from, T const* to) noexcept
+  {
+    std::size_t i = std::size_t(from - first);
+    std::size_t n = std::size_t(to - from);
+    std::destroy(first + i, first + i + n);
+    relocate(first + i + n, count - i - n, first + i);
+    count -= n;
+    return first + i;
+  }
+
+  void pop_back() noexcept
+  {
+    std::destroy_at(first + --count);
+  }
+
+  void clear() noexcept
+  {
+    std::destroy(first, first + count);
+    count = 0;
+  }
+};
@@ -0,0 +1,235 @@
+#include "../bench/bench.hpp"
+#include "../variant/variant.hpp"
+#include "result.hpp"
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+enum class Errc : int
+{
+  ok = 0,
+  empty_input,
+  invalid_digit,
+  overflow
+};
+
+template <>
+struct ResultNiche<Errc>
+{
+  static constexpr Errc value = Errc::ok;
+};
+
+char const* message(Errc e)
+{
+  switch(e)
+  {
+    case Errc::ok:
+      return "ok";
+    case Errc::empty_input:
+      return "empty input";
+    case Errc::invalid_digit:
+      return "invalid digit";
+    case Errc::overflow:
+      return "overflow";
+  }
+  return "?";
+}
+
+// small and trivially copyable: returned in a pair of registers
+static_assert(sizeof(Result<long, Errc>) == 16);
+static_assert(std::is_trivially_copyable_v<Result<long, Errc>>);
+static_assert(std::is_trivially_copyable_v<Result<double, Errc>>);
+// a status is just the error code
+static_assert(sizeof(Result<Unit, Errc>) == sizeof(Errc));
+static_assert(std::is_trivially_copyable_v<Result<Unit, Errc>>);
+// otherwise it follows T and E
+static_assert(!std::is_trivially_copyable_v<Result<std::string, Errc>>);
+static_assert(std::is_nothrow_move_constructible_v<Result<std::string, Errc>>);
+static_assert(IsTriviallyRelocatable<Result<std::unique_ptr<int>, Errc>>::value);
+// a Variant holding the same has a user-provided destructor, so it is returned through memory
+static_assert(!std::is_trivially_copyable_v<Variant<long, Errc>>);
+
+Result<int, Errc> parse_digit(char c)
+{
+  if(c < '0' || c > '9')
+  {
+    return fail(Errc::invalid_digit);
+  }
+  return c - '0';
+}
+
+Result<long, Errc> parse_number(std::string_view text)
+{
+  if(text.empty())
+  {
+    return fail(Errc::empty_input);
+  }
+  Result<long, Errc> number = 0L;
+  for(char c : text)
+  {
+    number = number.and_then([c](long n) {
+      return parse_digit(c).and_then([n](int d) -> Result<long, Errc> {
+        if(n > (INT64_MAX - d) / 10)
+        {
+          return fail(Errc::overflow);
+        }
+        return n * 10 + d;
+      });
+    });
+  }
+  return number;
+}
+
+Result<Unit, Errc> check_port(long port)
+{
+  if(port <= 0 || port > 65535)
+  {
+    return fail(Errc::overflow);
+  }
+  return Unit();
+}
+
+/*
+    The same call chain written three ways: each level calls the next one and adds to its result, and
+    the innermost one fails on request, so that the error travels back up through every level.
+*/
+constexpr int depth = 8;
+
+struct ChainError : std::exception
+{
+  Errc code;
+  explicit ChainError(Errc code)
+    : code(code)
+  { }
+};
+
+[[gnu::noinline]] long chain_throw(long x, bool fails, int level)
+{
+  if(level == 0)
+  {
+    if(fails)
+    {
+      throw ChainError(Errc::overflow);
+    }
+    return x;
+  }
+  return chain_throw(x + 1, fails, level - 1) + level;
+}
+
+[[gnu::noinline]] std::variant<long, Errc> chain_std_variant(long x, bool fails, int level)
+{
+  if(level == 0)
+  {
+    if(fails)
+    {
+      return Errc::overflow;
+    }
+    return x;
+  }
+  std::variant<long, Errc> r = chain_std_variant(x + 1, fails, level - 1);
+  if(long* v = std::get_if<long>(&r))
+  {
+    return *v + level;
+  }
+  return r;
+}
+
+[[gnu::noinline]] Variant<long, Errc> chain_variant(long x, bool fails, int level)
+{
+  if(level == 0)
+  {
+    if(fails)
+    {
+      return Errc::overflow;
+    }
+    return x;
+  }
+  Variant<long, Errc> r = chain_variant(x + 1, fails, level - 1);
+  if(long* v = r.get_if<long>())
+  {
+    return *v + level;
+  }
+  return r;
+}
+
+[[gnu::noinline]] Result<long, Errc> chain_result(long x, bool fails, int level)
+{
+  if(level == 0)
+  {
+    if(fails)
+    {
+      return fail(Errc::overflow);
+    }
+    return x;
+  }
+  return chain_result(x + 1, fails, level - 1).transform([level](long v) { return v + level; });
+}
+
+// runs n chains, `percent` of them failing, and returns the time in ns per chain
+template <typename Call>
+double per_chain(std::size_t n, unsigned percent, Call call)
+{
+  return time_ms([&] {
+           long sum = 0;
+           for(std::size_t i = 0; i < n; ++i)
+           {
+             sum += call(long(i), i % 100 < percent);
+           }
+           do_not_optimize(sum);
+         }) *
+         1e6 / double(n);
+}
+
+int main(int argc, char** argv)
+{
+  for(std::string_view text : {"8080", "80a0", "", "99999999999999999999"})
+  {
+    Result<long, Errc> port = parse_number(text);
+    Result<Unit, Errc> status = port.and_then(check_port);
+    std::cout << "\"" << text << "\": "
+              << port.transform([](long p) { return std::to_string(p); })
+                   .transform_error([](Errc e) { return std::string(message(e)); })
+                   .or_else([](std::string const& e) -> Result<std::string, std::string> {
+                     return "error (" + e + ")";
+                   })
+                   .value()
+              << ", usable as a port: " << (status ? "yes" : message(status.error())) << std::endl;
+  }
+
+  std::size_t n = size_arg(argc, argv, 1'000'000);
+  std::cout << "ns per call chain of depth " << depth << ", " << n << " chains:" << std::endl;
+  for(unsigned percent : {0u, 1u, 10u, 50u})
+  {
+    double throw_ns = per_chain(n, percent, [](long x, bool fails) {
+      try
+      {
+        return chain_throw(x, fails, depth);
+      }
+      catch(ChainError const& e)
+      {
+        return long(e.code);
+      }
+    });
+    double std_variant_ns = per_chain(n, percent, [](long x, bool fails) {
+      std::variant<long, Errc> r = chain_std_variant(x, fails, depth);
+      return r.index() == 0 ? std::get<0>(r) : long(std::get<1>(r));
+    });
+    double variant_ns = per_chain(n, percent, [](long x, bool fails) {
+      Variant<long, Errc> r = chain_variant(x, fails, depth);
+      return r.is<long>() ? r.get<long>() : long(r.get<Errc>());
+    });
+    double result_ns = per_chain(n, percent, [](long x, bool fails) {
+      Result<long, Errc> r = chain_result(x, fails, depth);
+      return r ? *r : long(r.error());
+    });
+    std::cout << "  " << percent << "% errors: exceptions " << throw_ns << ", std::variant "
+              << std_variant_ns << ", Variant " << variant_ns << ", Result " << result_ns
+              << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,492 @@
+#pragma once
+#include "../traits/triviallyrelocatable.hpp"
+#include "../variant/variantstorage.hpp"
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+/*
+    Result<T, E> holds either a value of type T or an error of type E, like C++23's std::expected, and
+    is meant for returning errors along hot call chains without exceptions.
+    It is laid out as a Variant<T, E>: a VariantStorage<T, E> holds the buffer and the discriminator,
+    numbered as VariantChoice numbers the alternatives (1 for T, 2 for E). Unlike a Variant, a Result is
+    never empty, so two states are all its discriminator ever takes, and unlike a Variant its copy,
+    move and destruction are trivial whenever those of T and E are (each special member comes in a
+    defaulted version constrained on that, see below). So a Result<long, Errc> is a trivially
+    copyable 16 bytes and comes back from a function in a pair of registers, where a Variant, with its
+    user-provided destructor, comes back through memory.
+    The value is built implicitly from a T, the error from a Failure<E>, as made by fail(e), so that T
+    and E may even be the same type.
+    and_then() and transform() chain computations on the value and pass an error through untouched;
+    transform_error() and or_else() do the same on the error. value() and error() do not check: using
+    the wrong one is a precondition violation, caught by an assert, as for operator* of std::expected.
+*/
+
+// the value of a Result that only reports success or failure
+struct Unit
+{
+  bool operator==(Unit const&) const = default;
+};
+
+/*
+    ResultNiche<E> can give up one value of an error type to stand for "no error": a Result<Unit, E>,
+    which otherwise needs an E and a discriminator, then is just an E (a status code in one register),
+    and tells whether it holds a value by comparing the E with that niche. Error enums reserving 0 for
+    success are the typical case:
+        template <> struct ResultNiche<Errc> { static constexpr Errc value = Errc::ok; };
+*/
+template <typename E>
+struct ResultNiche
+{ };
+
+template <typename T, typename E>
+constexpr bool result_uses_niche =
+  std::is_empty_v<T> && std::is_trivially_copyable_v<T> && std::is_trivially_default_constructible_v<T> &&
+  std::is_trivially_copyable_v<E> && requires { ResultNiche<E>::value; };
+
+template <typename E>
+struct Failure
+{
+  E error;
+};
+
+template <typename E>
+Failure<std::decay_t<E>> fail(E&& error)
+{
+  return {std::forward<E>(error)};
+}
+
+template <typename T, typename E, bool Niche = result_uses_niche<T, E>>
+class ResultStorage;
+
+// a VariantStorage<T, E>, whose discriminator tells which of the two the buffer holds
+template <typename T, typename E>
+class ResultStorage<T, E, false> : private VariantStorage<T, E>
+{
+  static constexpr unsigned char value_state = 1;
+  static constexpr unsigned char error_state = 2;
+
+  public:
+  bool holds_value() const noexcept
+  {
+    return this->get_discriminator() == value_state;
+  }
+
+  T* value_ptr() noexcept
+  {
+    return this->template get_buff_as<T>();
+  }
+
+  T const* value_ptr() const noexcept
+  {
+    return this->template get_buff_as<T>();
+  }
+
+  E* error_ptr() noexcept
+  {
+    return this->template get_buff_as<E>();
+  }
+
+  E const* error_ptr() const noexcept
+  {
+    return this->template get_buff_as<E>();
+  }
+
+  template <typename... Args>
+  void construct_value(Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args&&...>)
+  {
+    this->template construct<T>(std::forward<Args>(args)...);
+    this->set_discriminator(value_state);
+  }
+
+  template <typename... Args>
+  void construct_error(Args&&... args) noexcept(std::is_nothrow_constructible_v<E, Args&&...>)
+  {
+    this->template construct<E>(std::forward<Args>(args)...);
+    this->set_discriminator(error_state);
+  }
+
+  void destroy() noexcept
+  {
+    if(holds_value())
+    {
+      std::destroy_at(value_ptr());
+    }
+    else
+    {
+      std::destroy_at(error_ptr());
+    }
+  }
+};
+
+// an E alone, equal to the niche while there is no error
+template <typename T, typename E>
+class ResultStorage<T, E, true>
+{
+  [[no_unique_address]] T value;
+  E error = ResultNiche<E>::value;
+
+  public:
+  bool holds_value() const noexcept
+  {
+    return error == ResultNiche<E>::value;
+  }
+
+  T* value_ptr() noexcept
+  {
+    return &value;
+  }
+
+  T const* value_ptr() const noexcept
+  {
+    return &value;
+  }
+
+  E* error_ptr() noexcept
+  {
+    return &error;
+  }
+
+  E const* error_ptr() const noexcept
+  {
+    return &error;
+  }
+
+  template <typename... Args>
+  void construct_value(Args&&...) noexcept
+  {
+    error = ResultNiche<E>::value;
+  }
+
+  template <typename... Args>
+  void construct_error(Args&&... args) noexcept(std::is_nothrow_constructible_v<E, Args&&...>)
+  {
+    error = E(std::forward<Args>(args)...);
+    assert(!holds_value());
+  }
+
+  void destroy() noexcept
+  { }
+};
+
+template <typename T, typename E>
+class Result : private ResultStorage<T, E>
+{
+  static_assert(!std::is_reference_v<T> && !std::is_reference_v<E>, "Result holds values");
+
+  static constexpr bool trivial_copy = std::is_trivially_copy_constructible_v<T> &&
+                                      std::is_trivially_copy_constructible_v<E>;
+  static constexpr bool trivial_move = std::is_trivially_move_constructible_v<T> &&
+                                      std::is_trivially_move_constructible_v<E>;
+  static constexpr bool trivial_assign =
+    std::is_trivially_copyable_v<T> && std::is_trivially_copyable_v<E>;
+  static constexpr bool trivial_destroy =
+    std::is_trivially_destructible_v<T> && std::is_trivially_destructible_v<E>;
+  static constexpr bool nothrow_move =
+    std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_constructible_v<E>;
+
+  template <typename Source>
+  void construct_from(Source&& other)
+  {
+    if(other.has_value())
+    {
+      this->construct_value(std::forward<Source>(other).value());
+    }
+    else
+    {
+      this->construct_error(std::forward<Source>(other).error());
+    }
+  }
+
+  public:
+  using value_type = T;
+  using error_type = E;
+
+  Result() noexcept(std::is_nothrow_default_constructible_v<T>)
+    requires std::is_default_constructible_v<T>
+  {
+    this->construct_value();
+  }
+
+  Result(T const& value) noexcept(std::is_nothrow_copy_constructible_v<T>)
+  {
+    this->construct_value(value);
+  }
+
+  Result(T&& value) noexcept(std::is_nothrow_move_constructible_v<T>)
+  {
+    this->construct_value(std::move(value));
+  }
+
+  template <typename G>
+    requires std::is_constructible_v<E, G&&>
+  Result(Failure<G> failure) noexcept(std::is_nothrow_constructible_v<E, G&&>)
+  {
+    this->construct_error(std::move(failure.error));
+  }
+
+  /*
+    Each special member comes twice: defaulted, hence trivial, when T and E allow it, and written out
+    otherwise. The constrained version wins whenever its constraint holds (C++20), and then the
+    Result is trivially copyable or destructible.
+    The written-out assignments build the new contents aside and then move them in, so a Result is
+    never left without a value nor an error; this needs T and E to be nothrow move constructible, as
+    std::expected does.
+  */
+  Result(Result const&)
+    requires trivial_copy
+  = default;
+
+  Result(Result const& other) noexcept(std::is_nothrow_copy_constructible_v<T> &&
+                                       std::is_nothrow_copy_constructible_v<E>)
+  {
+    construct_from(other);
+  }
+
+  Result(Result&&)
+    requires trivial_move
+  = default;
+
+  Result(Result&& other) noexcept(nothrow_move)
+  {
+    construct_from(std::move(other));
+  }
+
+  Result& operator=(Result const&)
+    requires trivial_assign
+  = default;
+
+  Result& operator=(Result const& other)
+  {
+    static_assert(nothrow_move, "assigning a Result needs nothrow move constructible T and E");
+    if(this != &other)
+    {
+      Result copy(other);
+      this->destroy();
+      construct_from(std::move(copy));
+    }
+    return *this;
+  }
+
+  Result& operator=(Result&&)
+    requires trivial_assign
+  = default;
+
+  Result& operator=(Result&& other) noexcept(nothrow_move)
+  {
+    static_assert(nothrow_move, "assigning a Result needs nothrow move constructible T and E");
+    if(this != &other)
+    {
+      this->destroy();
+      construct_from(std::move(other));
+    }
+    return *this;
+  }
+
+  ~Result()
+    requires trivial_destroy
+  = default;
+
+  ~Result()
+  {
+    this->destroy();
+  }
+
+  bool has_value() const noexcept
+  {
+    return this->holds_value();
+  }
+
+  explicit operator bool() const noexcept
+  {
+    return has_value();
+  }
+
+  T& value() & noexcept
+  {
+    assert(has_value());
+    return *this->value_ptr();
+  }
+
+  T const& value() const& noexcept
+  {
+    assert(has_value());
+    return *this->value_ptr();
+  }
+
+  T&& value() && noexcept
+  {
+    assert(has_value());
+    return std::move(*this->value_ptr());
+  }
+
+  E& error() & noexcept
+  {
+    assert(!has_value());
+    return *this->error_ptr();
+  }
+
+  E const& error() const& noexcept
+  {
+    assert(!has_value());
+    return *this->error_ptr();
+  }
+
+  E&& error() && noexcept
+  {
+    assert(!has_value());
+    return std::move(*this->error_ptr());
+  }
+
+  T& operator*() & noexcept
+  {
+    return value();
+  }
+
+  T const& operator*() const& noexcept
+  {
+    return value();
+  }
+
+  T&& operator*() && noexcept
+  {
+    return std::move(*this).value();
+  }
+
+  T* operator->() noexcept
+  {
+    return &value();
+  }
+
+  T const* operator->() const noexcept
+  {
+    return &value();
+  }
+
+  template <typename U>
+  T value_or(U&& fallback) const&
+  {
+    return has_value() ? value() : T(std::forward<U>(fallback));
+  }
+
+  template <typename U>
+  T value_or(U&& fallback) &&
+  {
+    return has_value() ? std::move(*this).value() : T(std::forward<U>(fallback));
+  }
+
+  // f(value) returns a Result<U, E>: the result of the chain, or the error passed through
+  template <typename F>
+  auto and_then(F&& f) const&
+  {
+    return and_then_impl(*this, std::forward<F>(f));
+  }
+
+  template <typename F>
+  auto and_then(F&& f) &&
+  {
+    return and_then_impl(std::move(*this), std::forward<F>(f));
+  }
+
+  // f(value) returns a U: a Result<U, E> (Result<Unit, E> for void), or the error passed through
+  template <typename F>
+  auto transform(F&& f) const&
+  {
+    return transform_impl(*this, std::forward<F>(f));
+  }
+
+  template <typename F>
+  auto transform(F&& f) &&
+  {
+    return transform_impl(std::move(*this), std::forward<F>(f));
+  }
+
+  // f(error) returns a Result<T, G>: the recovered result, or the value passed through
+  template <typename F>
+  auto or_else(F&& f) const&
+  {
+    return or_else_impl(*this, std::forward<F>(f));
+  }
+
+  template <typename F>
+  auto or_else(F&& f) &&
+  {
+    return or_else_impl(std::move(*this), std::forward<F>(f));
+  }
+
+  // f(error) returns a G: a Result<T, G>, or the value passed through
+  template <typename F>
+  auto transform_error(F&& f) const&
+  {
+    return transform_error_impl(*this, std::forward<F>(f));
+  }
+
+  template <typename F>
+  auto transform_error(F&& f) &&
+  {
+    return transform_error_impl(std::move(*this), std::forward<F>(f));
+  }
+
+  private:
+  template <typename Self, typename F>
+  static auto and_then_impl(Self&& self, F&& f)
+  {
+    using Next = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::forward<Self>(self).value())>>;
+    static_assert(std::is_same_v<typename Next::error_type, E>, "and_then() must keep the error type");
+    if(self.has_value())
+    {
+      return Next(std::invoke(std::forward<F>(f), std::forward<Self>(self).value()));
+    }
+    return Next(Failure<E>{std::forward<Self>(self).error()});
+  }
+
+  template <typename Self, typename F>
+  static auto transform_impl(Self&& self, F&& f)
+  {
+    using U = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::forward<Self>(self).value())>>;
+    using Next = Result<std::conditional_t<std::is_void_v<U>, Unit, U>, E>;
+    if(!self.has_value())
+    {
+      return Next(Failure<E>{std::forward<Self>(self).error()});
+    }
+    if constexpr(std::is_void_v<U>)
+    {
+      std::invoke(std::forward<F>(f), std::forward<Self>(self).value());
+      return Next(Unit());
+    }
+    else
+    {
+      return Next(std::invoke(std::forward<F>(f), std::forward<Self>(self).value()));
+    }
+  }
+
+  template <typename Self, typename F>
+  static auto or_else_impl(Self&& self, F&& f)
+  {
+    using Next = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::forward<Self>(self).error())>>;
+    static_assert(std::is_same_v<typename Next::value_type, T>, "or_else() must keep the value type");
+    if(self.has_value())
+    {
+      return Next(std::forward<Self>(self).value());
+    }
+    return Next(std::invoke(std::forward<F>(f), std::forward<Self>(self).error()));
+  }
+
+  template <typename Self, typename F>
+  static auto transform_error_impl(Self&& self, F&& f)
+  {
+    using G = std::remove_cvref_t<std::invoke_result_t<F, decltype(std::forward<Self>(self).error())>>;
+    using Next = Result<T, G>;
+    if(self.has_value())
+    {
+      return Next(std::forward<Self>(self).value());
+    }
+    return Next(Failure<G>{std::invoke(std::forward<F>(f), std::forward<Self>(self).error())});
+  }
+};
+
+template <typename T, typename E>
+struct IsTriviallyRelocatable<Result<T, E>> : std::bool_constant<all_trivially_relocatable<T, E>>
+{ };
@@ -0,0 +1,270 @@
+#include "../bench/bench.hpp"
+#include "../typelist/typelist.hpp"
+#include "scheduler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    Two tasks: Compute, some arithmetic, and Spawn, which submits Computes from inside a worker.
+    Dispatch: a few Spawns fan out into n tiny Computes (argv[1]), so the cost measured is that of
+    submitting, queuing and running a task. Deadlines: a producer overloads the workers with bulk
+    tasks due in 20ms, and with every batch submits one urgent task due in 500us; the share of each
+    started late. Both against a pool of threads on one std::deque of std::function<void()> under a
+    mutex, first in, first out.
+*/
+
+std::uint64_t spin(std::uint64_t x, std::uint32_t rounds)
+{
+  for(std::uint32_t i = 0; i < rounds; ++i)
+  {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+  }
+  return x;
+}
+
+struct Compute
+{
+  std::uint64_t seed;
+  std::uint32_t rounds;
+};
+
+struct Spawn
+{
+  std::uint32_t children;
+  std::uint32_t rounds;
+  std::uint64_t budget; // ns from submission to the deadline of each child
+};
+
+struct Work;
+using Scheduler = TaskScheduler<TypeList<Compute, Spawn>, Work>;
+
+struct Work
+{
+  Scheduler* scheduler = nullptr;
+
+  void operator()(Compute& c) const
+  {
+    do_not_optimize(spin(c.seed, c.rounds));
+  }
+
+  void operator()(Spawn& s) const
+  {
+    for(std::uint32_t i = 0; i < s.children; ++i)
+    {
+      scheduler->submit(TaskPriority::normal, scheduler_now() + s.budget, Compute{i + 1, s.rounds});
+    }
+  }
+};
+
+// the queue replaced
+class FunctionPool
+{
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<std::function<void()>> tasks;
+  bool stopping = false;
+  std::atomic<std::uint64_t> done{0};
+  std::vector<std::thread> threads;
+
+  void work()
+  {
+    while(true)
+    {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if(tasks.empty())
+        {
+          return;
+        }
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+      done.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  public:
+  explicit FunctionPool(unsigned workers)
+  {
+    for(unsigned i = 0; i < workers; ++i)
+    {
+      threads.emplace_back([this] { work(); });
+    }
+  }
+
+  ~FunctionPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    ready.notify_all();
+    for(auto& t : threads)
+    {
+      t.join();
+    }
+  }
+
+  void submit(std::function<void()> task)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.push_back(std::move(task));
+    }
+    ready.notify_one();
+  }
+
+  std::uint64_t completed() const noexcept
+  {
+    return done.load(std::memory_order_relaxed);
+  }
+};
+
+template <typename Done>
+void wait_for(std::uint64_t total, Done const& completed)
+{
+  while(completed() < total)
+  {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+}
+
+// ns per task of spawners submitting n tasks in all from the workers
+void dispatch(unsigned workers, std::size_t n)
+{
+  unsigned spawners = workers * 4;
+  auto children = std::uint32_t(std::max<std::size_t>(n / spawners, 1));
+  std::uint64_t total = std::uint64_t(spawners) * children;
+  std::uint64_t budget = 1'000'000'000;
+
+  Work work;
+  double ms;
+  {
+    Scheduler scheduler(workers, work);
+    work.scheduler = &scheduler;
+    Stopwatch sw;
+    for(unsigned i = 0; i < spawners; ++i)
+    {
+      scheduler.submit(TaskPriority::normal, scheduler_now() + budget, Spawn{children, 0, budget});
+    }
+    wait_for(total + spawners, [&] { return scheduler.completed(TaskPriority::normal); });
+    ms = sw.elapsed_ms();
+  }
+
+  double pool_ms;
+  {
+    FunctionPool pool(workers);
+    Stopwatch sw;
+    for(unsigned i = 0; i < spawners; ++i)
+    {
+      pool.submit([&pool, children, budget] {
+        for(std::uint32_t k = 0; k < children; ++k)
+        {
+          // the deadline and the seed make the capture too large for std::function's buffer
+          std::uint64_t deadline = scheduler_now() + budget, seed = k + 1;
+          pool.submit([deadline, seed, rounds = 0u] {
+            do_not_optimize(deadline);
+            do_not_optimize(spin(seed, rounds));
+          });
+        }
+      });
+    }
+    wait_for(total + spawners, [&] { return pool.completed(); });
+    pool_ms = sw.elapsed_ms();
+  }
+  std::cout << workers << " workers, " << total << " tasks spawned from workers, ns per task: "
+            << "TaskScheduler " << ms * 1e6 / double(total) << ", std::function queue "
+            << pool_ms * 1e6 / double(total) << std::endl;
+}
+
+struct Load
+{
+  unsigned rounds = 400;
+  unsigned bulk_per_round = 300;
+  std::uint32_t work = 1000; // spin rounds per task, about a microsecond
+  std::uint64_t bulk_budget = 20'000'000;
+  std::uint64_t urgent_budget = 500'000;
+};
+
+void deadlines(unsigned workers, Load const& load)
+{
+  std::uint64_t bulk_total = std::uint64_t(load.rounds) * load.bulk_per_round;
+  double urgent_missed, bulk_missed;
+  {
+    Work work;
+    Scheduler scheduler(workers, work);
+    work.scheduler = &scheduler;
+    for(unsigned r = 0; r < load.rounds; ++r)
+    {
+      std::uint64_t now = scheduler_now();
+      for(unsigned i = 0; i < load.bulk_per_round; ++i)
+      {
+        scheduler.submit(TaskPriority::low, now + load.bulk_budget, Compute{i + 1, load.work});
+      }
+      scheduler.submit(TaskPriority::high, now + load.urgent_budget, Compute{r + 1, load.work});
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    wait_for(bulk_total + load.rounds, [&] {
+      return scheduler.completed(TaskPriority::low) + scheduler.completed(TaskPriority::high);
+    });
+    urgent_missed = double(scheduler.missed(TaskPriority::high)) / load.rounds;
+    bulk_missed = double(scheduler.missed(TaskPriority::low)) / double(bulk_total);
+  }
+
+  double pool_urgent_missed, pool_bulk_missed;
+  {
+    std::atomic<std::uint64_t> urgent{0}, bulk{0};
+    FunctionPool pool(workers);
+    for(unsigned r = 0; r < load.rounds; ++r)
+    {
+      std::uint64_t now = scheduler_now();
+      for(unsigned i = 0; i < load.bulk_per_round; ++i)
+      {
+        pool.submit([&bulk, deadline = now + load.bulk_budget, seed = i + 1, rounds = load.work] {
+          bulk.fetch_add(scheduler_now() > deadline ? 1 : 0, std::memory_order_relaxed);
+          do_not_optimize(spin(seed, rounds));
+        });
+      }
+      pool.submit([&urgent, deadline = now + load.urgent_budget, seed = r + 1, rounds = load.work] {
+        urgent.fetch_add(scheduler_now() > deadline ? 1 : 0, std::memory_order_relaxed);
+        do_not_optimize(spin(seed, rounds));
+      });
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    wait_for(bulk_total + load.rounds, [&] { return pool.completed(); });
+    pool_urgent_missed = double(urgent.load()) / load.rounds;
+    pool_bulk_missed = double(bulk.load()) / double(bulk_total);
+  }
+  std::cout << workers << " workers overloaded, deadlines missed: TaskScheduler urgent "
+            << urgent_missed * 100 << "%, bulk " << bulk_missed * 100 << "%; std::function queue "
+            << "urgent " << pool_urgent_missed * 100 << "%, bulk " << pool_bulk_missed * 100 << "%"
+            << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t n = size_arg(argc, argv, 2'000'000);
+  unsigned workers = std::max(2u, hardware_threads());
+
+  deadlines(workers, Load{});
+  for(int rep = 0; rep < 3; ++rep)
+  {
+    dispatch(workers, n);
+  }
+  return 0;
+}
@@ -0,0 +1,382 @@
+#pragma once
+#include "../typelist/typelist.hpp"
+#include "../variant/variant.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+    A task scheduler for a closed set of task types, earliest deadline first. A queue of
+    std::function<void()> allocates every task whose captures do not fit in its small buffer, calls
+    it through a pointer, and runs tasks in the order they came, however urgent.
+    TaskScheduler<TypeList<Tasks...>, Handler> stores a task as a Variant<Tasks...>, inline in the
+    vectors of its queues, and runs it with task.visit(handler): no allocation once the vectors have
+    grown, and a switch in place of the indirect call.
+    - Priorities: a task is high, normal or low priority; a worker takes the high tasks first.
+    - Deadlines: within a priority, tasks are kept in buckets of 2^bucket_bits nanoseconds of
+      deadline: those of the next 16ms one per bucket, those of the next 4s one per 16ms, and the
+      rest in a heap. Inserting is O(1) up to 4s ahead, and a worker takes the earliest bucket
+      first: earliest deadline first, to the width of a bucket. A task past its deadline goes into
+      the earliest bucket. A task that starts after its deadline is counted as a miss, per priority.
+    - Worker queues: each worker has its own set of queues, under its own mutex. A task submitted
+      from a worker goes to that worker's queues, one from outside to the next worker in turn. A
+      worker takes a batch of up to dequeue_batch tasks under one lock, and runs them without it; a
+      worker with nothing left steals a half batch from the others, and sleeps on a futex once there
+      is nothing anywhere, with the protocol of ActorRuntime (actors/runtime.hpp).
+    The handler is shared by the workers, called from all of them at once.
+*/
+
+enum class TaskPriority : unsigned
+{
+  high,
+  normal,
+  low
+};
+
+// nanoseconds of the steady clock, the unit of deadlines
+inline std::uint64_t scheduler_now() noexcept
+{
+  return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now().time_since_epoch())
+                         .count());
+}
+
+template <typename List, typename Handler>
+class TaskScheduler;
+
+template <typename... Tasks, typename Handler>
+class TaskScheduler<TypeList<Tasks...>, Handler>
+{
+  public:
+  using Task = Variant<Tasks...>;
+
+  static constexpr unsigned priority_levels = 3;
+  static constexpr std::size_t dequeue_batch = 32;
+  static constexpr unsigned bucket_bits = 16; // buckets of 65.5us
+  static constexpr unsigned ring_size = 256;
+
+  private:
+  struct Entry
+  {
+    std::uint64_t deadline;
+    Task task;
+  };
+
+  /*
+    The tasks of one priority of one worker, in buckets of deadline. A span is ring_size buckets;
+    near holds the buckets of the current span, far the spans after it, a bucket per span, and the
+    heap later the tasks further off. When the current span is done, the far bucket of the next one
+    is spread over near: each task is moved at most once from far to near, as in TimerWheel.
+  */
+  class DeadlineBuckets
+  {
+    std::array<std::vector<Entry>, ring_size> near;
+    std::array<std::vector<Entry>, ring_size> far;
+    std::vector<Entry> later; // a min-heap of deadlines
+    std::uint64_t base = 0;   // the earliest bucket that may hold tasks, in the current span
+    std::size_t near_count = 0;
+    std::size_t far_count = 0;
+
+    static bool after(Entry const& a, Entry const& b) noexcept
+    {
+      return a.deadline > b.deadline;
+    }
+
+    std::uint64_t span() const noexcept
+    {
+      return base / ring_size;
+    }
+
+    void place(Entry&& entry)
+    {
+      std::uint64_t bucket = entry.deadline >> bucket_bits;
+      if(bucket < base)
+      {
+        bucket = base;
+      }
+      std::uint64_t s = bucket / ring_size;
+      if(s == span())
+      {
+        near[bucket % ring_size].push_back(std::move(entry));
+        ++near_count;
+      }
+      else if(s < span() + ring_size)
+      {
+        far[s % ring_size].push_back(std::move(entry));
+        ++far_count;
+      }
+      else
+      {
+        later.push_back(std::move(entry));
+        std::push_heap(later.begin(), later.end(), after);
+      }
+    }
+
+    void next_span()
+    {
+      base = (span() + 1) * ring_size;
+      std::vector<Entry>& current = far[span() % ring_size];
+      far_count -= current.size();
+      for(Entry& entry : current)
+      {
+        place(std::move(entry));
+      }
+      current.clear();
+      while(!later.empty() && (later.front().deadline >> bucket_bits) / ring_size < span() + ring_size)
+      {
+        std::pop_heap(later.begin(), later.end(), after);
+        Entry entry = std::move(later.back());
+        later.pop_back();
+        place(std::move(entry));
+      }
+    }
+
+    public:
+    std::size_t size() const noexcept
+    {
+      return near_count + far_count + later.size();
+    }
+
+    void push(std::uint64_t deadline, Task&& task)
+    {
+      if(size() == 0)
+      {
+        base = deadline >> bucket_bits;
+      }
+      place(Entry{deadline, std::move(task)});
+    }
+
+    // moves at most max tasks of the earliest bucket to out; returns how many
+    std::size_t pop_batch(std::vector<Entry>& out, std::size_t max)
+    {
+      if(size() == 0)
+      {
+        return 0;
+      }
+      while(near_count == 0)
+      {
+        if(far_count == 0)
+        {
+          // nothing before the heap: on to the span before its earliest task
+          base = ((later.front().deadline >> bucket_bits) / ring_size - 1) * ring_size;
+        }
+        next_span();
+      }
+      while(near[base % ring_size].empty())
+      {
+        ++base;
+      }
+      std::vector<Entry>& bucket = near[base % ring_size];
+      std::size_t n = bucket.size() < max ? bucket.size() : max;
+      for(std::size_t k = bucket.size() - n; k < bucket.size(); ++k)
+      {
+        out.push_back(std::move(bucket[k]));
+      }
+      bucket.erase(bucket.end() - std::ptrdiff_t(n), bucket.end());
+      near_count -= n;
+      return n;
+    }
+  };
+
+  struct alignas(64) Worker
+  {
+    std::mutex mutex;
+    std::array<DeadlineBuckets, priority_levels> queues;
+  };
+
+  // written by their worker only
+  struct alignas(64) Stats
+  {
+    std::array<std::atomic<std::uint64_t>, priority_levels> completed{};
+    std::array<std::atomic<std::uint64_t>, priority_levels> missed{};
+  };
+
+  Handler& handler;
+  std::unique_ptr<Worker[]> workers;
+  std::unique_ptr<Stats[]> stats;
+  unsigned worker_count;
+  std::vector<std::thread> threads;
+  std::atomic<bool> stopping{false};
+  std::atomic<unsigned> next_worker{0};
+  std::atomic<std::uint32_t> epoch{0};
+  std::atomic<unsigned> sleepers{0};
+
+  static constexpr unsigned none = ~0u;
+  static unsigned& current_worker() noexcept
+  {
+    thread_local unsigned index = none;
+    return index;
+  }
+
+  static TaskScheduler*& current_scheduler() noexcept
+  {
+    thread_local TaskScheduler* scheduler = nullptr;
+    return scheduler;
+  }
+
+  // a batch of the highest priority of w into batch; the priority, or priority_levels if none
+  unsigned take(Worker& w, std::vector<Entry>& batch, std::size_t max)
+  {
+    std::lock_guard<std::mutex> lock(w.mutex);
+    for(unsigned p = 0; p < priority_levels; ++p)
+    {
+      if(w.queues[p].pop_batch(batch, max) != 0)
+      {
+        return p;
+      }
+    }
+    return priority_levels;
+  }
+
+  unsigned find_work(unsigned self, std::vector<Entry>& batch)
+  {
+    unsigned p = take(workers[self], batch, dequeue_batch);
+    for(unsigned i = 1; p == priority_levels && i < worker_count; ++i)
+    {
+      p = take(workers[(self + i) % worker_count], batch, dequeue_batch / 2);
+    }
+    return p;
+  }
+
+  /*
+    A task is late if it starts after its deadline. The clock is read once per batch, and again
+    only for a task whose deadline is within a bucket of the last reading.
+  */
+  void run(unsigned self, unsigned priority, std::vector<Entry>& batch)
+  {
+    std::uint64_t now = scheduler_now();
+    std::uint64_t late = 0;
+    for(Entry& entry : batch)
+    {
+      if(entry.deadline < now + (std::uint64_t(1) << bucket_bits))
+      {
+        now = scheduler_now();
+        late += entry.deadline < now ? 1 : 0;
+      }
+      entry.task.template visit<void>(handler);
+    }
+    Stats& s = stats[self];
+    s.completed[priority].store(s.completed[priority].load(std::memory_order_relaxed) + batch.size(),
+                                std::memory_order_relaxed);
+    s.missed[priority].store(s.missed[priority].load(std::memory_order_relaxed) + late,
+                             std::memory_order_relaxed);
+    batch.clear();
+  }
+
+  void work(unsigned self)
+  {
+    current_worker() = self;
+    current_scheduler() = this;
+    std::vector<Entry> batch;
+    batch.reserve(dequeue_batch);
+    while(!stopping.load(std::memory_order_acquire))
+    {
+      unsigned p = find_work(self, batch);
+      if(p != priority_levels)
+      {
+        run(self, p, batch);
+        continue;
+      }
+      sleepers.fetch_add(1, std::memory_order_relaxed);
+      std::uint32_t e = epoch.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      p = find_work(self, batch);
+      if(p == priority_levels && !stopping.load(std::memory_order_acquire))
+      {
+        epoch.wait(e, std::memory_order_acquire);
+      }
+      sleepers.fetch_sub(1, std::memory_order_relaxed);
+      if(p != priority_levels)
+      {
+        run(self, p, batch);
+      }
+    }
+  }
+
+  void wake_all() noexcept
+  {
+    epoch.fetch_add(1, std::memory_order_release);
+    epoch.notify_all();
+  }
+
+  public:
+  TaskScheduler(unsigned worker_count, Handler& handler)
+    : handler(handler)
+    , workers(new Worker[worker_count])
+    , stats(new Stats[worker_count])
+    , worker_count(worker_count)
+  {
+    for(unsigned i = 0; i < worker_count; ++i)
+    {
+      threads.emplace_back([this, i] { work(i); });
+    }
+  }
+
+  TaskScheduler(TaskScheduler const&) = delete;
+  TaskScheduler& operator=(TaskScheduler const&) = delete;
+
+  // stops the workers; the tasks not started are dropped
+  ~TaskScheduler()
+  {
+    stopping.store(true, std::memory_order_seq_cst);
+    wake_all();
+    for(auto& t : threads)
+    {
+      t.join();
+    }
+  }
+
+  /*
+    Queues task, to start before deadline (scheduler_now() nanoseconds), on the calling worker or
+    on the next one from outside. As in ActorRuntime, a worker queuing on itself only wakes the
+    others when it has more than a batch queued.
+  */
+  template <typename T>
+  void submit(TaskPriority priority, std::uint64_t deadline, T&& task)
+  {
+    bool inside = current_scheduler() == this;
+    unsigned w = inside ? current_worker()
+                        : next_worker.fetch_add(1, std::memory_order_relaxed) % worker_count;
+    bool surplus = !inside;
+    {
+      std::lock_guard<std::mutex> lock(workers[w].mutex);
+      auto& queues = workers[w].queues;
+      queues[unsigned(priority)].push(deadline, Task(std::forward<T>(task)));
+      surplus = surplus || queues[0].size() + queues[1].size() + queues[2].size() > dequeue_batch;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(surplus && sleepers.load(std::memory_order_relaxed) != 0)
+    {
+      wake_all();
+    }
+  }
+
+  // the tasks of a priority run so far, and those that started late
+  std::uint64_t completed(TaskPriority priority) const noexcept
+  {
+    std::uint64_t total = 0;
+    for(unsigned i = 0; i < worker_count; ++i)
+    {
+      total += stats[i].completed[unsigned(priority)].load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  std::uint64_t missed(TaskPriority priority) const noexcept
+  {
+    std::uint64_t total = 0;
+    for(unsigned i = 0; i < worker_count; ++i)
+    {
+      total += stats[i].missed[unsigned(priority)].load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+};
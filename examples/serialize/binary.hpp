@@ -0,0 +1,282 @@
+#pragma once
+#include "../traits/triviallycopyable.hpp"
+#include "../tuple/tuple.hpp"
+#include "../variant/variant.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+    Binary serialization of rows into a byte buffer. A value whose every byte belongs to its value
+    (written_as_bytes: trivially copyable with unique object representations, such as integers and
+    InlineStrings, or a floating-point number) is written as its object representation, and a
+    vector of them as one block of bytes: a single memcpy. Everything else is taken apart: a
+    std::string is written as its length and its characters, a Tuple element by element, a Variant as
+    the index of its alternative (0 when empty) followed by the value. Tuples and Variants have
+    padding even when trivially copyable (between the fields, after the empty Tuple<> that ends
+    every Tuple, in the unused tail of a Variant's buffer), and copying their bytes would write
+    uninitialized memory, different for equal rows.
+    BinaryReader throws std::runtime_error on input it cannot trust: truncated, a variant index out
+    of range, or bytes that are no valid value (RepresentationCheck: a bool other than 0 or 1, an
+    InlineString longer than its capacity).
+    The format is the in-memory layout of the fields, so it is meant for data read back by the same
+    build on the same platform (spilling to disk, shipping between processes), not as an exchange
+    format.
+*/
+template <typename T>
+constexpr bool written_as_bytes =
+  IsTriviallyCopyable<T>::value &&
+  (std::has_unique_object_representations_v<T> || std::is_floating_point_v<T>);
+
+// the fewest bytes a T takes in the format, to check a count of elements against the input left
+// before allocating them: all of its bytes, or else the 8-byte length of a std::string or a vector
+template <typename T>
+struct MinSerializedSize : std::integral_constant<std::size_t, written_as_bytes<T> ? sizeof(T) : 8>
+{ };
+
+template <typename... Types>
+struct MinSerializedSize<Tuple<Types...>>
+  : std::integral_constant<std::size_t, (MinSerializedSize<Types>::value + ... + 0)>
+{ };
+
+// the index of the alternative
+template <typename... Types>
+struct MinSerializedSize<Variant<Types...>> : std::integral_constant<std::size_t, 1>
+{ };
+
+class BinaryWriter
+{
+  std::vector<std::byte>& out;
+
+  void write_fields(Tuple<> const&)
+  { }
+
+  template <typename Head, typename... Tail>
+  void write_fields(Tuple<Head, Tail...> const& t)
+  {
+    write(t.get_head());
+    write_fields(t.get_tail());
+  }
+
+  template <typename... Types>
+  void write_fields(Variant<Types...> const& v)
+  {
+    if(v.empty())
+    {
+      write(std::uint8_t(0));
+      return;
+    }
+    v.visit([&](auto const& value) {
+      using T = std::decay_t<decltype(value)>;
+      write(std::uint8_t(FindIndexOfT<TypeList<Types...>, T>::value + 1));
+      write(value);
+    });
+  }
+
+  public:
+  explicit BinaryWriter(std::vector<std::byte>& out)
+    : out(out)
+  { }
+
+  void write_bytes(void const* data, std::size_t n)
+  {
+    if(n == 0)
+    {
+      return; // data may be null (an empty vector or string), which memcpy does not allow
+    }
+    std::size_t at = out.size();
+    out.resize(at + n);
+    std::memcpy(out.data() + at, data, n);
+  }
+
+  template <typename T>
+  void write(T const& value)
+  {
+    if constexpr(written_as_bytes<T>)
+    {
+      write_bytes(&value, sizeof(T));
+    }
+    else if constexpr(std::is_same_v<T, std::string>)
+    {
+      write(std::uint64_t(value.size()));
+      write_bytes(value.data(), value.size());
+    }
+    else
+    {
+      write_fields(value);
+    }
+  }
+
+  template <typename T>
+  void write(std::vector<T> const& values)
+  {
+    write(std::uint64_t(values.size()));
+    if constexpr(written_as_bytes<T>)
+    {
+      write_bytes(values.data(), values.size() * sizeof(T));
+    }
+    else
+    {
+      for(T const& value : values)
+      {
+        write(value);
+      }
+    }
+  }
+};
+
+class BinaryReader
+{
+  std::byte const* pos;
+  std::byte const* end;
+
+  static constexpr std::uint64_t max_empty_elements = std::uint64_t(1) << 20;
+
+  void read_fields(Tuple<>&)
+  { }
+
+  template <typename Head, typename... Tail>
+  void read_fields(Tuple<Head, Tail...>& t)
+  {
+    read(t.get_head());
+    read_fields(t.get_tail());
+  }
+
+  template <typename T, typename... Types>
+  bool read_alternative(Variant<Types...>& v)
+  {
+    T value{};
+    read(value);
+    v = std::move(value);
+    return true;
+  }
+
+  template <typename... Types>
+  void read_fields(Variant<Types...>& v)
+  {
+    std::uint8_t index;
+    read(index);
+    if(index == 0)
+    {
+      v.destroy();
+      return;
+    }
+    // alternative i is read when index == i + 1
+    std::uint8_t i = 0;
+    if(!((++i == index && read_alternative<Types>(v)) || ...))
+    {
+      throw std::runtime_error("BinaryReader: invalid variant index");
+    }
+  }
+
+  // count elements of `size` bytes, checked against what is left
+  void check(std::uint64_t count, std::size_t size) const
+  {
+    if(count > std::size_t(end - pos) / size)
+    {
+      throw std::runtime_error("BinaryReader: truncated input");
+    }
+  }
+
+  public:
+  BinaryReader(std::byte const* data, std::size_t n)
+    : pos(data)
+    , end(data + n)
+  { }
+
+  explicit BinaryReader(std::vector<std::byte> const& in)
+    : BinaryReader(in.data(), in.size())
+  { }
+
+  void read_bytes(void* data, std::size_t n)
+  {
+    check(n, 1);
+    if(n == 0)
+    {
+      return;
+    }
+    std::memcpy(data, pos, n);
+    pos += n;
+  }
+
+  // count values written as bytes, each checked by RepresentationCheck<T> before it is copied
+  template <typename T>
+  void read_values(T* values, std::size_t count)
+  {
+    check(count, sizeof(T));
+    for(std::size_t i = 0; i < count; ++i)
+    {
+      if(!RepresentationCheck<T>::valid(pos + i * sizeof(T)))
+      {
+        throw std::runtime_error("BinaryReader: invalid value");
+      }
+    }
+    read_bytes(static_cast<void*>(values), count * sizeof(T));
+  }
+
+  template <typename T>
+  void read(T& value)
+  {
+    if constexpr(written_as_bytes<T>)
+    {
+      read_values(&value, 1);
+    }
+    else if constexpr(std::is_same_v<T, std::string>)
+    {
+      std::uint64_t size;
+      read(size);
+      check(size, 1);
+      value.assign(reinterpret_cast<char const*>(pos), size);
+      pos += size;
+    }
+    else
+    {
+      read_fields(value);
+    }
+  }
+
+  template <typename T>
+  void read(std::vector<T>& values)
+  {
+    std::uint64_t size;
+    read(size);
+    if constexpr(written_as_bytes<T>)
+    {
+      check(size, sizeof(T));
+      values.resize(size);
+      read_values(values.data(), size);
+    }
+    else
+    {
+      constexpr std::size_t min_size = MinSerializedSize<T>::value;
+      if constexpr(min_size == 0)
+      {
+        // elements of no bytes at all (Tuple<>): nothing in the input bounds their number
+        if(size > max_empty_elements)
+        {
+          throw std::runtime_error("BinaryReader: too many empty elements");
+        }
+      }
+      else
+      {
+        check(size, min_size);
+      }
+      values.clear();
+      values.resize(size);
+      for(T& value : values)
+      {
+        read(value);
+      }
+    }
+  }
+
+  // bytes not read yet
+  std::size_t remaining() const
+  {
+    return end - pos;
+  }
+};
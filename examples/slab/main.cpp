@@ -0,0 +1,165 @@
+#include "../bench/bench.hpp"
+#include "../parallel/runonthreads.hpp"
+#include "slaballocators.hpp"
+#include <algorithm>
+#include <barrier>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+struct Order
+{
+  long id;
+  double price;
+  int quantity;
+};
+
+struct Quote
+{
+  long id;
+  double bid[16];
+  double ask[16];
+};
+
+struct Snapshot
+{
+  long id;
+  char data[4000];
+};
+
+using Payloads = TypeList<Order, Quote, Snapshot>;
+using Slabs = SlabAllocators<Payloads>;
+using SlabMessage = Slabs::BoxedVariant;
+using HeapMessage = Variant<std::unique_ptr<Order>, std::unique_ptr<Quote>, std::unique_ptr<Snapshot>>;
+
+static_assert(sizeof(Slabs::Box<2>) == sizeof(void*));
+
+struct HeapPolicy
+{
+  using Message = HeapMessage;
+  template <typename T>
+  static Message make(long id)
+  {
+    return Message(std::unique_ptr<T>(new T{id}));
+  }
+};
+
+struct SlabPolicy
+{
+  using Message = SlabMessage;
+  template <typename T>
+  static Message make(long id)
+  {
+    return Message(Slabs::make<T>(id));
+  }
+};
+
+// mostly small orders, some quotes, a few large snapshots
+template <typename Policy>
+typename Policy::Message make_message(std::uint64_t r, long id)
+{
+  unsigned kind = r % 100;
+  if(kind < 70)
+  {
+    return Policy::template make<Order>(id);
+  }
+  if(kind < 95)
+  {
+    return Policy::template make<Quote>(id);
+  }
+  return Policy::template make<Snapshot>(id);
+}
+
+// each thread keeps a window of in-flight messages: every step replaces the oldest with a new one
+template <typename Policy>
+double churn(unsigned threads, std::size_t steps_per_thread)
+{
+  constexpr std::size_t window = 4096;
+  return time_ms([&] {
+    run_on_threads(threads, [&](unsigned t) {
+      std::unique_ptr<typename Policy::Message[]> ring(new typename Policy::Message[window]);
+      std::mt19937_64 rng(t);
+      for(std::size_t i = 0; i < steps_per_thread; ++i)
+      {
+        ring[i % window] = make_message<Policy>(rng(), long(i));
+      }
+    });
+  });
+}
+
+// every thread allocates a batch of messages, and the next thread frees them
+template <typename Policy>
+double handoff(unsigned threads, std::size_t per_thread, unsigned rounds)
+{
+  using Message = typename Policy::Message;
+  std::vector<std::unique_ptr<Message[]>> batches(threads);
+  for(auto& b : batches)
+  {
+    b.reset(new Message[per_thread]);
+  }
+  std::barrier sync(threads);
+  return time_ms([&] {
+    run_on_threads(threads, [&](unsigned t) {
+      std::mt19937_64 rng(t);
+      for(unsigned round = 0; round < rounds; ++round)
+      {
+        for(std::size_t i = 0; i < per_thread; ++i)
+        {
+          batches[t][i] = make_message<Policy>(rng(), long(i));
+        }
+        sync.arrive_and_wait();
+        Message* other = batches[(t + 1) % threads].get();
+        for(std::size_t i = 0; i < per_thread; ++i)
+        {
+          other[i] = Message(); // frees the payload allocated by the other thread
+        }
+        sync.arrive_and_wait();
+      }
+    });
+  });
+}
+
+// released during static destruction, after the thread caches of the main thread are gone
+SlabMessage released_at_exit;
+
+int main(int argc, char** argv)
+{
+  released_at_exit = SlabMessage(Slabs::make<Snapshot>(1L));
+  SlabMessage m(Slabs::make<Quote>(7L));
+  std::cout << std::boolalpha << "m holds a Quote: " << m.is<Slabs::Box<1>>()
+            << ", id = " << m.get<Slabs::Box<1>>()->id << std::endl;
+  std::cout << "block sizes: " << Slabs::pool<0>().get_block_size() << ", "
+            << Slabs::pool<1>().get_block_size() << ", " << Slabs::pool<2>().get_block_size()
+            << " bytes, batches of " << Slabs::pool<0>().batch_size() << ", "
+            << Slabs::pool<1>().batch_size() << ", " << Slabs::pool<2>().batch_size() << std::endl;
+
+  std::size_t steps = size_arg(argc, argv, 10'000'000);
+  std::cout << "churn, " << steps << " messages per thread (70% 24 B, 25% 264 B, 5% 4 KB):"
+            << std::endl;
+  for(unsigned threads : thread_counts())
+  {
+    double heap_ms = churn<HeapPolicy>(threads, steps);
+    double slab_ms = churn<SlabPolicy>(threads, steps);
+    std::cout << "  " << threads << " threads: malloc " << threads * steps / heap_ms / 1e3
+              << " Mmsg/s, slab " << threads * steps / slab_ms / 1e3 << " Mmsg/s" << std::endl;
+  }
+
+  // remote frees need at least two threads, even on a single core
+  unsigned threads = std::max(2u, hardware_threads());
+  std::size_t per_thread = 100'000;
+  unsigned rounds = unsigned(std::max<std::size_t>(1, steps / per_thread / 4));
+  double heap_ms = handoff<HeapPolicy>(threads, per_thread, rounds);
+  double slab_ms = handoff<SlabPolicy>(threads, per_thread, rounds);
+  double total = double(threads) * per_thread * rounds;
+  std::cout << "handoff, " << threads << " threads freeing each other's messages: malloc "
+            << total / heap_ms / 1e3 << " Mmsg/s, slab " << total / slab_ms / 1e3 << " Mmsg/s"
+            << std::endl;
+  std::cout << "slab memory: "
+            << (Slabs::pool<0>().memory_bytes() + Slabs::pool<1>().memory_bytes() +
+                Slabs::pool<2>().memory_bytes()) /
+                 (1 << 20)
+            << " MiB" << std::endl;
+  return 0;
+}
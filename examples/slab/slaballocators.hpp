@@ -0,0 +1,163 @@
+#pragma once
+#include "../tuple/makeindexlist.hpp"
+#include "../typelist/nthelement.hpp"
+#include "../variant/findindexof.hpp"
+#include "../variant/variant.hpp"
+#include "slabpool.hpp"
+#include <memory>
+#include <new>
+#include <utility>
+
+/*
+    One slab allocator per alternative of a variant whose large alternatives are boxed.
+    SlabAllocators<TypeList<A, B, C>> owns a SlabPool per payload type, sized for that type and
+    addressed by its index in the list, and every thread gets its own SlabCache in front of each pool.
+    make<I>() (or make<T>()) returns a Box<I>: a std::unique_ptr whose deleter is stateless, so the box
+    is still a single pointer, and knows at compile time which pool the block goes back to. BoxedVariant
+    is the Variant of the boxes of all the payloads, ready to replace
+    Variant<std::unique_ptr<A>, std::unique_ptr<B>, std::unique_ptr<C>>.
+    The pools are created on first use and never destroyed, so that boxes released during static
+    destruction still have somewhere to go. The caches are thread_local, and those of the main thread
+    are destroyed before the static objects: a thread keeps a trivially destructible pointer to each
+    of its caches, cleared when the cache is destroyed, and once it is gone make() and the deleter go
+    straight to the pool, a block at a time under its mutex.
+*/
+template <typename List>
+class SlabAllocators;
+
+template <typename... Payloads>
+class SlabAllocators<TypeList<Payloads...>>
+{
+  using List = TypeList<Payloads...>;
+
+  public:
+  template <unsigned I>
+  using Payload = NthElement<List, I>;
+
+  template <unsigned I>
+  static SlabPool& pool()
+  {
+    static SlabPool& p = *new SlabPool(sizeof(Payload<I>), alignof(Payload<I>));
+    return p;
+  }
+
+  private:
+  // a thread's cache of pool<I>(); trivially destructible, so readable until the thread is gone
+  template <unsigned I>
+  struct CacheState
+  {
+    SlabCache* cache = nullptr;
+    bool destroyed = false;
+  };
+
+  template <unsigned I>
+  static CacheState<I>& cache_state() noexcept
+  {
+    thread_local CacheState<I> state;
+    return state;
+  }
+
+  template <unsigned I>
+  struct OwnedCache
+  {
+    SlabCache cache{pool<I>()};
+
+    OwnedCache()
+    {
+      cache_state<I>().cache = &cache;
+    }
+
+    ~OwnedCache()
+    {
+      cache_state<I>() = CacheState<I>{nullptr, true};
+    }
+  };
+
+  template <unsigned I>
+  static void* allocate()
+  {
+    if(SlabCache* c = cache<I>())
+    {
+      return c->allocate();
+    }
+    SlabPool::Batch b = pool<I>().take_batch();
+    if(b.count > 1)
+    {
+      pool<I>().give_batch({b.head->next, b.count - 1});
+    }
+    return b.head;
+  }
+
+  template <unsigned I>
+  static void deallocate(void* p)
+  {
+    if(SlabCache* c = cache<I>())
+    {
+      c->deallocate(p);
+      return;
+    }
+    auto* block = static_cast<SlabPool::FreeBlock*>(p);
+    block->next = nullptr;
+    pool<I>().give_batch({block, 1});
+  }
+
+  public:
+  // the calling thread's cache in front of pool<I>(), or nullptr once it has been destroyed
+  template <unsigned I>
+  static SlabCache* cache()
+  {
+    CacheState<I>& state = cache_state<I>();
+    if(state.cache == nullptr && !state.destroyed)
+    {
+      thread_local OwnedCache<I> owned;
+    }
+    return state.cache;
+  }
+
+  template <unsigned I>
+  struct Deleter
+  {
+    void operator()(Payload<I>* p) const
+    {
+      std::destroy_at(p);
+      deallocate<I>(p);
+    }
+  };
+
+  template <unsigned I>
+  using Box = std::unique_ptr<Payload<I>, Deleter<I>>;
+
+  template <unsigned I, typename... Args>
+  static Box<I> make(Args&&... args)
+  {
+    void* block = allocate<I>();
+    try
+    {
+      return Box<I>(new(block) Payload<I>(std::forward<Args>(args)...));
+    }
+    catch(...)
+    {
+      deallocate<I>(block);
+      throw;
+    }
+  }
+
+  template <typename T, typename... Args>
+  static auto make(Args&&... args)
+  {
+    return make<FindIndexOfT<List, T>::value>(std::forward<Args>(args)...);
+  }
+
+  private:
+  template <typename Indices>
+  struct BoxedVariantT;
+
+  template <unsigned... I>
+  struct BoxedVariantT<ValueList<unsigned, I...>>
+  {
+    using Type = Variant<Box<I>...>;
+  };
+
+  public:
+  using BoxedVariant = typename BoxedVariantT<MakeIndexList<sizeof...(Payloads)>>::Type;
+};
@@ -0,0 +1,184 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+/*
+    Fixed-size block allocator in two levels, in the style of the thread caches of tcmalloc and
+    jemalloc but for a single size class.
+    SlabPool is shared by all the threads. It hands out and takes back whole batches of free blocks,
+    each an intrusive singly linked list, under a mutex: one lock per batch, not per block. When it has
+    no batch left it carves one out of a slab, a large chunk obtained from operator new and never given
+    back (blocks from any slab can end up in any batch).
+    SlabCache is the per-thread front end. It keeps an active list, which allocate() pops and
+    deallocate() pushes, plus at most one spare full batch, so that allocate() and deallocate() are a
+    few pointer moves and never lock, except when the active list runs dry (a batch is taken from the
+    spare, or from the pool) or fills up (the spare goes back to the pool and the active list becomes
+    the spare). Keeping a spare avoids ping-ponging one batch with the pool when a thread alternates
+    allocations and frees around a batch boundary.
+    Blocks freed by a thread other than the one that allocated them simply join the freeing thread's
+    cache, and reach the other threads through the pool a batch at a time.
+*/
+class SlabPool
+{
+  public:
+  struct FreeBlock
+  {
+    FreeBlock* next;
+  };
+
+  struct Batch
+  {
+    FreeBlock* head;
+    std::size_t count;
+  };
+
+  private:
+  std::size_t block_size;
+  std::size_t block_align;
+  std::size_t batch;
+  std::size_t slab_size;
+
+  std::mutex mutex; // guards everything below
+  std::vector<Batch> batches;
+  std::byte* slab_pos = nullptr;
+  std::size_t slab_left = 0;
+  std::size_t slabs = 0;
+
+  public:
+  SlabPool(std::size_t size, std::size_t align)
+    : block_align(std::max(align, alignof(FreeBlock)))
+  {
+    block_size = (std::max(size, sizeof(FreeBlock)) + block_align - 1) / block_align * block_align;
+    // about 32 KiB per batch, but never fewer than 4 nor more than 64 blocks
+    batch = std::clamp<std::size_t>(32 * 1024 / block_size, 4, 64);
+    slab_size = std::max<std::size_t>(256 * 1024, block_size * batch);
+  }
+
+  SlabPool(SlabPool const&) = delete;
+  SlabPool& operator=(SlabPool const&) = delete;
+
+  std::size_t batch_size() const
+  {
+    return batch;
+  }
+
+  std::size_t get_block_size() const
+  {
+    return block_size;
+  }
+
+  // a batch of free blocks, possibly fewer than batch_size() of them
+  Batch take_batch()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(!batches.empty())
+    {
+      Batch b = batches.back();
+      batches.pop_back();
+      return b;
+    }
+    if(slab_left < block_size * batch)
+    {
+      slab_pos = static_cast<std::byte*>(::operator new(slab_size, std::align_val_t(block_align)));
+      slab_left = slab_size;
+      ++slabs;
+    }
+    FreeBlock* head = nullptr;
+    for(std::size_t i = 0; i < batch; ++i)
+    {
+      auto* block = reinterpret_cast<FreeBlock*>(slab_pos + (batch - 1 - i) * block_size);
+      block->next = head;
+      head = block;
+    }
+    slab_pos += block_size * batch;
+    slab_left -= block_size * batch;
+    return {head, batch};
+  }
+
+  void give_batch(Batch b)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    batches.push_back(b);
+  }
+
+  // bytes obtained from operator new so far
+  std::size_t memory_bytes()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return slabs * slab_size;
+  }
+};
+
+class SlabCache
+{
+  using FreeBlock = SlabPool::FreeBlock;
+
+  SlabPool& pool;
+  FreeBlock* active = nullptr;
+  std::size_t active_count = 0;
+  FreeBlock* spare = nullptr; // a full batch, or nullptr
+
+  public:
+  explicit SlabCache(SlabPool& pool)
+    : pool(pool)
+  { }
+
+  SlabCache(SlabCache const&) = delete;
+  SlabCache& operator=(SlabCache const&) = delete;
+
+  // the thread is exiting: everything goes back to the pool
+  ~SlabCache()
+  {
+    if(active)
+    {
+      pool.give_batch({active, active_count});
+    }
+    if(spare)
+    {
+      pool.give_batch({spare, pool.batch_size()});
+    }
+  }
+
+  void* allocate()
+  {
+    if(!active)
+    {
+      if(spare)
+      {
+        active = spare;
+        active_count = pool.batch_size();
+        spare = nullptr;
+      }
+      else
+      {
+        SlabPool::Batch b = pool.take_batch();
+        active = b.head;
+        active_count = b.count;
+      }
+    }
+    FreeBlock* block = active;
+    active = block->next;
+    --active_count;
+    return block;
+  }
+
+  void deallocate(void* p)
+  {
+    auto* block = static_cast<FreeBlock*>(p);
+    block->next = active;
+    active = block;
+    if(++active_count == pool.batch_size())
+    {
+      if(spare)
+      {
+        pool.give_batch({spare, pool.batch_size()});
+      }
+      spare = active;
+      active = nullptr;
+      active_count = 0;
+    }
+  }
+};
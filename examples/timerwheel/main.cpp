@@ -0,0 +1,236 @@
+#include "../bench/bench.hpp"
+#include "../variant/variant.hpp"
+#include "timerwheel.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <vector>
+
+/*
+    A server's timers: a timeout per connection, cancelled when the response arrives, retries of
+    requests and heartbeats that schedule themselves again when they fire. Then 10M timers active at
+    once (argv[1]), their deadlines spread over 2^20 ticks: the time to schedule them all, to cancel
+    half of them and to run the rest to expiry, against the usual std::priority_queue of deadlines and
+    std::function, where a cancelled timer is only marked, and skipped when it comes to the top.
+*/
+
+struct Timeout
+{
+  std::uint32_t connection;
+};
+
+struct Retry
+{
+  std::uint32_t request;
+  std::uint16_t attempt;
+};
+
+struct Heartbeat
+{
+  std::uint32_t peer;
+};
+
+using Timer = Variant<Timeout, Retry, Heartbeat>;
+
+struct Server
+{
+  TimerWheel<Timer>& wheel;
+  std::size_t timeouts = 0;
+  std::size_t retries = 0;
+  std::size_t heartbeats = 0;
+
+  void operator()(Timeout&)
+  {
+    ++timeouts;
+  }
+
+  void operator()(Retry& retry)
+  {
+    ++retries;
+    if(retry.attempt < 3)
+    {
+      wheel.schedule(wheel.now() + (std::uint64_t(20) << retry.attempt),
+                     Retry{retry.request, std::uint16_t(retry.attempt + 1)});
+    }
+  }
+
+  void operator()(Heartbeat& heartbeat)
+  {
+    ++heartbeats;
+    wheel.schedule(wheel.now() + 50, heartbeat);
+  }
+};
+
+void demo()
+{
+  TimerWheel<Timer> wheel;
+  Server server{wheel};
+  std::mt19937 rng(3);
+  std::vector<TimerId> timeouts;
+  for(std::uint32_t c = 0; c < 1000; ++c)
+  {
+    timeouts.push_back(wheel.schedule(500, Timeout{c}));
+  }
+  for(std::uint32_t r = 0; r < 100; ++r)
+  {
+    wheel.schedule(20, Retry{r, 0});
+  }
+  for(std::uint32_t p = 0; p < 10; ++p)
+  {
+    wheel.schedule(50 + p, Heartbeat{p});
+  }
+  // 90% of the responses arrive in time, the others never
+  std::size_t cancelled = 0;
+  for(std::uint64_t tick = 0; tick < 1000; tick += 10)
+  {
+    for(int k = 0; k < 9; ++k)
+    {
+      cancelled += wheel.cancel(timeouts[rng() % timeouts.size()]) ? 1 : 0;
+    }
+    wheel.advance(tick + 10, server);
+  }
+  std::cout << "at tick " << wheel.now() << ": " << cancelled << " timeouts cancelled, "
+            << server.timeouts << " fired; " << server.retries << " retries, " << server.heartbeats
+            << " heartbeats; " << wheel.size() << " timers pending" << std::endl;
+}
+
+// the timer queue replaced
+struct QueuedTimer
+{
+  std::uint64_t deadline;
+  std::uint32_t id;
+  std::function<void()> callback;
+
+  bool operator>(QueuedTimer const& other) const noexcept
+  {
+    return deadline > other.deadline;
+  }
+};
+
+struct Sum
+{
+  std::uint64_t total = 0;
+
+  void operator()(Timeout& t)
+  {
+    total += t.connection;
+  }
+
+  void operator()(Retry& r)
+  {
+    total += r.request + r.attempt;
+  }
+
+  void operator()(Heartbeat& h)
+  {
+    total += h.peer;
+  }
+};
+
+int main(int argc, char** argv)
+{
+  std::size_t n = size_arg(argc, argv, 10'000'000);
+  demo();
+
+  constexpr std::uint64_t horizon = std::uint64_t(1) << 20;
+  std::mt19937_64 rng(7);
+  std::vector<std::uint32_t> deadlines(n), order(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    deadlines[i] = std::uint32_t(1 + rng() % (horizon - 1));
+    order[i] = std::uint32_t(i);
+  }
+  std::shuffle(order.begin(), order.end(), rng);
+  std::size_t cancels = n / 2;
+
+  double insert_ms, cancel_ms, expire_ms;
+  std::size_t fired;
+  {
+    TimerWheel<Timer> wheel;
+    std::vector<TimerId> ids(n);
+    Sum sum;
+    Stopwatch sw;
+    for(std::size_t i = 0; i < n; ++i)
+    {
+      auto d = deadlines[i];
+      if(i % 3 == 0)
+      {
+        ids[i] = wheel.schedule(d, Timeout{d});
+      }
+      else if(i % 3 == 1)
+      {
+        ids[i] = wheel.schedule(d, Retry{d, 1});
+      }
+      else
+      {
+        ids[i] = wheel.schedule(d, Heartbeat{d});
+      }
+    }
+    insert_ms = sw.elapsed_ms();
+    sw.reset();
+    for(std::size_t k = 0; k < cancels; ++k)
+    {
+      wheel.cancel(ids[order[k]]);
+    }
+    cancel_ms = sw.elapsed_ms();
+    sw.reset();
+    fired = wheel.advance(horizon, sum);
+    expire_ms = sw.elapsed_ms();
+    do_not_optimize(sum.total);
+  }
+
+  double queue_insert_ms, queue_cancel_ms, queue_expire_ms;
+  std::size_t queue_fired = 0;
+  {
+    std::vector<QueuedTimer> storage;
+    storage.reserve(n);
+    std::priority_queue<QueuedTimer, std::vector<QueuedTimer>, std::greater<>> queue(
+      std::greater<>(), std::move(storage));
+    std::vector<bool> cancelled(n);
+    std::uint64_t total = 0;
+    Stopwatch sw;
+    for(std::size_t i = 0; i < n; ++i)
+    {
+      // three words captured, more than std::function holds without allocating
+      std::uint64_t d = deadlines[i], kind = i % 3;
+      queue.push(QueuedTimer{d, std::uint32_t(i), [&total, d, kind] { total += d + kind; }});
+    }
+    queue_insert_ms = sw.elapsed_ms();
+    sw.reset();
+    for(std::size_t k = 0; k < cancels; ++k)
+    {
+      cancelled[order[k]] = true;
+    }
+    queue_cancel_ms = sw.elapsed_ms();
+    sw.reset();
+    while(!queue.empty())
+    {
+      QueuedTimer const& top = queue.top();
+      if(!cancelled[top.id])
+      {
+        top.callback();
+        ++queue_fired;
+      }
+      queue.pop();
+    }
+    queue_expire_ms = sw.elapsed_ms();
+    do_not_optimize(total);
+  }
+
+  if(fired != n - cancels || queue_fired != n - cancels)
+  {
+    std::cout << "WRONG NUMBER OF TIMERS FIRED " << fired << " " << queue_fired << std::endl;
+  }
+  std::cout << n << " timers, ns per insert: wheel " << insert_ms * 1e6 / double(n) << ", queue "
+            << queue_insert_ms * 1e6 / double(n) << std::endl;
+  std::cout << cancels << " cancelled, ns per cancel: wheel " << cancel_ms * 1e6 / double(cancels)
+            << ", queue (marked only) " << queue_cancel_ms * 1e6 / double(cancels) << std::endl;
+  std::cout << fired << " fired, ns per timer: wheel " << expire_ms * 1e6 / double(fired)
+            << ", queue (cancelled ones popped too) " << queue_expire_ms * 1e6 / double(fired)
+            << std::endl;
+  return 0;
+}
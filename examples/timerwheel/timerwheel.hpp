@@ -0,0 +1,265 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/*
+    A hierarchical hashed timer wheel, as in the Linux kernel or Kafka, for millions of timeouts.
+    Time is counted in ticks. Level 0 has a slot per tick for the next 256 ticks, level 1 a slot per 256
+    ticks for the next 65536, and so on up to level 3, 2^32 ticks in all. A timer goes into the slot of
+    the lowest level that covers its deadline; when level 0 wraps around, the slot of level 1 now
+    current is emptied and its timers are inserted again, into level 0 this time (and likewise level 2
+    into level 1 when level 1 wraps...). A timer is moved at most once per level, so insertion,
+    cancellation and expiry are all O(1), where a binary heap is O(log n).
+    - Timers live in nodes of a pool owned by the wheel, allocated a chunk of 65536 at a time and
+      recycled through a free list: no allocation per timer. The payload, a Variant of the kinds of
+      timers (a request timeout, a retry, a heartbeat...), is stored inline in the node, instead of a
+      std::function and whatever it captured.
+    - A slot is a doubly linked list of node indices, so cancel() unlinks a node in O(1). A TimerId
+      carries the generation of its node, so cancelling a timer that has already fired, or whose node
+      has been reused since, does nothing.
+    - advance(to, visitor) moves time forward and dispatches every timer due, tick by tick, each slot
+      as a batch, through payload.visit(visitor). The visitor may schedule and cancel timers: a timer
+      that fires is unlinked (its id no longer valid) before it is visited.
+    Deadlines more than 2^32 ticks ahead are kept in level 3 and placed again each time their slot
+    comes around.
+*/
+
+struct TimerId
+{
+  std::uint32_t index;
+  std::uint32_t generation;
+};
+
+template <typename Payload>
+class TimerWheel
+{
+  static constexpr unsigned levels = 4;
+  static constexpr unsigned slot_bits = 8;
+  static constexpr std::uint32_t slots_per_level = 1u << slot_bits;
+  static constexpr std::uint32_t chunk_bits = 16;
+  static constexpr std::uint32_t nil = ~0u;
+
+  struct Node
+  {
+    std::uint64_t deadline;
+    std::uint32_t next;
+    std::uint32_t prev;
+    std::uint32_t slot; // level * slots_per_level + index, or nil when free
+    std::uint32_t generation;
+    alignas(Payload) unsigned char payload[sizeof(Payload)];
+
+    Payload& get() noexcept
+    {
+      return *std::launder(reinterpret_cast<Payload*>(payload));
+    }
+  };
+
+  std::vector<std::unique_ptr<Node[]>> chunks;
+  std::uint32_t free_head = nil;
+  std::uint32_t allocated = 0; // nodes ever taken from the chunks
+  std::uint32_t heads[levels * slots_per_level];
+  std::uint64_t current;
+  std::size_t active = 0;
+
+  Node& node(std::uint32_t i) noexcept
+  {
+    return chunks[i >> chunk_bits][i & ((1u << chunk_bits) - 1)];
+  }
+
+  std::uint32_t allocate_node()
+  {
+    if(free_head != nil)
+    {
+      std::uint32_t i = free_head;
+      free_head = node(i).next;
+      return i;
+    }
+    if((allocated >> chunk_bits) == chunks.size())
+    {
+      auto chunk = std::unique_ptr<Node[]>(new Node[std::size_t(1) << chunk_bits]);
+      for(std::size_t k = 0; k < (std::size_t(1) << chunk_bits); ++k)
+      {
+        chunk[k].generation = 0;
+      }
+      chunks.push_back(std::move(chunk));
+    }
+    return allocated++;
+  }
+
+  void free_node(std::uint32_t i) noexcept
+  {
+    Node& n = node(i);
+    n.get().~Payload();
+    n.slot = nil;
+    n.next = free_head;
+    free_head = i;
+  }
+
+  std::uint32_t slot_of(std::uint64_t deadline) const noexcept
+  {
+    std::uint64_t delta = deadline - current;
+    unsigned level = 0;
+    while(level + 1 < levels && delta >= (std::uint64_t(1) << (slot_bits * (level + 1))))
+    {
+      ++level;
+    }
+    auto index = std::uint32_t((deadline >> (slot_bits * level)) & (slots_per_level - 1));
+    return level * slots_per_level + index;
+  }
+
+  void link(std::uint32_t i) noexcept
+  {
+    Node& n = node(i);
+    n.slot = slot_of(n.deadline);
+    n.prev = nil;
+    n.next = heads[n.slot];
+    if(n.next != nil)
+    {
+      node(n.next).prev = i;
+    }
+    heads[n.slot] = i;
+  }
+
+  void unlink(std::uint32_t i) noexcept
+  {
+    Node& n = node(i);
+    if(n.prev != nil)
+    {
+      node(n.prev).next = n.next;
+    }
+    else
+    {
+      heads[n.slot] = n.next;
+    }
+    if(n.next != nil)
+    {
+      node(n.next).prev = n.prev;
+    }
+  }
+
+  // the timers of a slot of a higher level, placed again relative to the current tick
+  void cascade(std::uint32_t slot) noexcept
+  {
+    std::uint32_t i = heads[slot];
+    heads[slot] = nil;
+    while(i != nil)
+    {
+      std::uint32_t next = node(i).next;
+      link(i);
+      i = next;
+    }
+  }
+
+  public:
+  explicit TimerWheel(std::uint64_t now = 0)
+    : current(now)
+  {
+    for(auto& head : heads)
+    {
+      head = nil;
+    }
+  }
+
+  TimerWheel(TimerWheel const&) = delete;
+  TimerWheel& operator=(TimerWheel const&) = delete;
+
+  ~TimerWheel()
+  {
+    for(std::uint32_t slot = 0; slot < levels * slots_per_level; ++slot)
+    {
+      for(std::uint32_t i = heads[slot]; i != nil; i = node(i).next)
+      {
+        node(i).get().~Payload();
+      }
+    }
+  }
+
+  std::uint64_t now() const noexcept
+  {
+    return current;
+  }
+
+  // the timers scheduled and neither fired nor cancelled
+  std::size_t size() const noexcept
+  {
+    return active;
+  }
+
+  // a timer firing at deadline, or at the next tick if deadline has passed
+  template <typename T>
+  TimerId schedule(std::uint64_t deadline, T&& payload)
+  {
+    std::uint32_t i = allocate_node();
+    Node& n = node(i);
+    ::new(static_cast<void*>(n.payload)) Payload(std::forward<T>(payload));
+    n.deadline = deadline > current ? deadline : current + 1;
+    link(i);
+    ++active;
+    return TimerId{i, n.generation};
+  }
+
+  // whether the timer was still pending
+  bool cancel(TimerId id) noexcept
+  {
+    if(id.index >= allocated)
+    {
+      return false;
+    }
+    Node& n = node(id.index);
+    if(n.generation != id.generation || n.slot == nil)
+    {
+      return false;
+    }
+    unlink(id.index);
+    ++n.generation;
+    free_node(id.index);
+    --active;
+    return true;
+  }
+
+  // moves time to `to`, calling payload.visit(vis) for every timer due; returns how many fired
+  template <typename Visitor>
+  std::size_t advance(std::uint64_t to, Visitor&& vis)
+  {
+    std::size_t fired = 0;
+    while(current < to)
+    {
+      ++current;
+      // level l > 0 moves to its next slot when the lower levels wrap around; the highest first
+      unsigned moved = 0;
+      std::uint64_t t = current;
+      while(moved + 1 < levels && (t & (slots_per_level - 1)) == 0)
+      {
+        t >>= slot_bits;
+        ++moved;
+      }
+      for(unsigned level = moved; level > 0; --level)
+      {
+        auto index = std::uint32_t((current >> (slot_bits * level)) & (slots_per_level - 1));
+        cascade(level * slots_per_level + index);
+      }
+      std::uint32_t slot = std::uint32_t(current & (slots_per_level - 1));
+      while(heads[slot] != nil)
+      {
+        std::uint32_t i = heads[slot];
+        Node& n = node(i);
+        heads[slot] = n.next;
+        if(n.next != nil)
+        {
+          node(n.next).prev = nil;
+        }
+        ++n.generation;
+        n.slot = nil;
+        --active;
+        n.get().template visit<void>(vis);
+        free_node(i);
+        ++fired;
+      }
+    }
+    return fired;
+  }
+};
@@ -0,0 +1,73 @@
+#include "../bench/bench.hpp"
+#include "../tuple/tupleio.hpp"
+#include "topk.hpp"
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using Row = Tuple<int, double, std::string>; // (id, score, name)
+
+std::vector<Row> make_rows(std::size_t n)
+{
+  std::mt19937_64 rng(7);
+  std::uniform_real_distribution<double> score(0.0, 1e6);
+  std::vector<Row> rows;
+  rows.reserve(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    rows.emplace_back(static_cast<int>(i), score(rng), "item-" + std::to_string(i % 100000));
+  }
+  return rows;
+}
+
+// what the dashboards do today: copy the rows, then partially sort the copies
+std::vector<Row> partial_sort_copy_top(std::vector<Row> const& rows, std::size_t k)
+{
+  std::vector<Row> copy(rows);
+  k = std::min(k, copy.size());
+  std::partial_sort(copy.begin(), copy.begin() + k, copy.end(), [](Row const& a, Row const& b) {
+    return get<1>(b) < get<1>(a);
+  });
+  copy.resize(k);
+  return copy;
+}
+
+int main(int argc, char** argv)
+{
+  std::vector<Row> small{
+    {1, 4.5, "a"}, {2, 9.0, "b"}, {3, 1.0, "c"}, {4, 7.25, "d"}, {5, 8.0, "e"}};
+  std::cout << "top 3 by score:" << std::endl;
+  for(Row const& row : top_k<1>(small, 3))
+  {
+    std::cout << "  " << row << std::endl;
+  }
+  std::cout << "2 smallest ids, through the projection -id:" << std::endl;
+  for(Row const& row : top_k(small, 2, [](Row const& r) { return -get<0>(r); }))
+  {
+    std::cout << "  " << row << std::endl;
+  }
+
+  std::size_t n = size_arg(argc, argv, 10'000'000);
+  std::size_t k = size_arg(argc, argv, 100, 2);
+  std::vector<Row> rows = make_rows(n);
+  std::cout << "benchmark: top " << k << " of " << n << " rows by score" << std::endl;
+
+  std::vector<Row> expected;
+  double base = time_ms([&] { expected = partial_sort_copy_top(rows, k); });
+  std::cout << "  std::partial_sort on Tuple copies: " << base << " ms" << std::endl;
+  for(unsigned threads : thread_counts())
+  {
+    std::vector<Row> result;
+    double ms = time_ms([&] { result = top_k<1>(rows, k, TopKOptions{threads}); });
+    bool same = std::equal(result.begin(),
+                           result.end(),
+                           expected.begin(),
+                           expected.end(),
+                           [](Row const& a, Row const& b) { return get<1>(a) == get<1>(b); });
+    std::cout << "  top_k, " << threads << " thread(s): " << ms << " ms, " << base / ms
+              << "x faster" << (same ? "" : " (MISMATCH)") << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+    Once the top-K heap is full, almost every row is worse than the current threshold (for random
+    input only about K * ln(N / K) rows ever enter the heap). It is therefore cheaper to compare a
+    whole block of keys against the threshold at once, and to look at the few survivors one by one,
+    than to run the heap comparison for every row.
+    greater_mask() returns a bitmask with bit j set if keys[j] > threshold. The generic version is a
+    simple loop the compiler can vectorize; the overloads below spell out SSE2 for the most common
+    numeric key types.
+*/
+
+constexpr std::size_t prefilter_block = 16;
+
+template <typename T>
+std::uint32_t greater_mask(T const* keys, T threshold)
+{
+  std::uint32_t mask = 0;
+  for(std::size_t j = 0; j < prefilter_block; ++j)
+  {
+    mask |= std::uint32_t(threshold < keys[j]) << j;
+  }
+  return mask;
+}
+
+#if defined(__SSE2__)
+inline std::uint32_t greater_mask(double const* keys, double threshold)
+{
+  __m128d t = _mm_set1_pd(threshold);
+  std::uint32_t mask = 0;
+  for(std::size_t j = 0; j < prefilter_block; j += 2)
+  {
+    mask |= std::uint32_t(_mm_movemask_pd(_mm_cmpgt_pd(_mm_loadu_pd(keys + j), t))) << j;
+  }
+  return mask;
+}
+
+inline std::uint32_t greater_mask(float const* keys, float threshold)
+{
+  __m128 t = _mm_set1_ps(threshold);
+  std::uint32_t mask = 0;
+  for(std::size_t j = 0; j < prefilter_block; j += 4)
+  {
+    mask |= std::uint32_t(_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(keys + j), t))) << j;
+  }
+  return mask;
+}
+
+inline std::uint32_t greater_mask(std::int32_t const* keys, std::int32_t threshold)
+{
+  __m128i t = _mm_set1_epi32(threshold);
+  std::uint32_t mask = 0;
+  for(std::size_t j = 0; j < prefilter_block; j += 4)
+  {
+    __m128i gt = _mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(keys + j)), t);
+    mask |= std::uint32_t(_mm_movemask_ps(_mm_castsi128_ps(gt))) << j;
+  }
+  return mask;
+}
+#endif
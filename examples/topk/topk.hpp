@@ -0,0 +1,216 @@
+#pragma once
+#include "../parallel/runonthreads.hpp"
+#include "../tuple/tuple.hpp"
+#include "prefilter.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+    Streaming top-K selection: the K rows with the largest key, where the key is either a field of
+    the row Tuple (top_k<I>(rows, k)) or any projection of it (top_k(rows, k, proj)).
+    The K best keys seen so far live in a bounded min-heap, so the root is the threshold a new key
+    must beat to enter. Only the key and the position of the row are kept in the heap: rows are
+    copied once, at the very end, instead of being shuffled around as std::partial_sort does.
+*/
+
+template <typename Key>
+class TopKHeap
+{
+  // min-heap stored as two parallel arrays: moving a (key, id) pair only touches small values
+  std::vector<Key> keys;
+  std::vector<std::size_t> ids;
+  std::size_t k;
+
+  void sift_up(std::size_t i, Key key, std::size_t id)
+  {
+    while(i > 0)
+    {
+      std::size_t parent = (i - 1) / 2;
+      if(!(key < keys[parent]))
+      {
+        break;
+      }
+      keys[i] = keys[parent];
+      ids[i] = ids[parent];
+      i = parent;
+    }
+    keys[i] = key;
+    ids[i] = id;
+  }
+
+  void sift_down(Key key, std::size_t id)
+  {
+    std::size_t i = 0, n = keys.size();
+    for(std::size_t l = 1; l < n; l = 2 * i + 1)
+    {
+      // pick the smaller child without a branch: the right child is read only if it exists
+      std::size_t r = std::min(l + 1, n - 1);
+      std::size_t c = l + std::size_t(keys[r] < keys[l]);
+      if(!(keys[c] < key))
+      {
+        break;
+      }
+      keys[i] = keys[c];
+      ids[i] = ids[c];
+      i = c;
+    }
+    keys[i] = key;
+    ids[i] = id;
+  }
+
+  public:
+  // k must not be 0
+  explicit TopKHeap(std::size_t k)
+    : k(k)
+  {
+    keys.reserve(k);
+    ids.reserve(k);
+  }
+
+  bool full() const
+  {
+    return keys.size() == k;
+  }
+
+  // the key to beat once the heap is full
+  Key const& threshold() const
+  {
+    return keys.front();
+  }
+
+  void push(Key const& key, std::size_t id)
+  {
+    if(!full())
+    {
+      keys.push_back(key);
+      ids.push_back(id);
+      sift_up(keys.size() - 1, key, id);
+    }
+    else if(keys.front() < key)
+    {
+      sift_down(key, id);
+    }
+  }
+
+  void merge(TopKHeap const& other)
+  {
+    for(std::size_t i = 0; i < other.keys.size(); ++i)
+    {
+      push(other.keys[i], other.ids[i]);
+    }
+  }
+
+  // row positions sorted from the largest key to the smallest (ties by position)
+  std::vector<std::size_t> sorted_ids() const
+  {
+    std::vector<std::size_t> order(keys.size());
+    for(std::size_t i = 0; i < order.size(); ++i)
+    {
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+      return keys[b] < keys[a] || (!(keys[a] < keys[b]) && ids[a] < ids[b]);
+    });
+    for(std::size_t& i : order)
+    {
+      i = ids[i];
+    }
+    return order;
+  }
+};
+
+struct TopKOptions
+{
+  unsigned threads = std::thread::hardware_concurrency();
+};
+
+// feeds rows [begin, end) to the heap, prefiltering blocks of keys against the threshold
+template <typename Row, typename Proj, typename Key>
+void top_k_scan(std::vector<Row> const& rows,
+                std::size_t begin,
+                std::size_t end,
+                Proj const& proj,
+                TopKHeap<Key>& heap)
+{
+  std::size_t i = begin;
+  // until the heap is full every key enters it
+  for(; i < end && !heap.full(); ++i)
+  {
+    heap.push(proj(rows[i]), i);
+  }
+
+  if constexpr(std::is_arithmetic_v<Key>)
+  {
+    Key block[prefilter_block];
+    for(; i + prefilter_block <= end; i += prefilter_block)
+    {
+      for(std::size_t j = 0; j < prefilter_block; ++j)
+      {
+        block[j] = proj(rows[i + j]);
+      }
+      // the threshold only grows, so rechecking each survivor in push() is enough
+      for(std::uint32_t mask = greater_mask(block, heap.threshold()); mask; mask &= mask - 1)
+      {
+        std::size_t j = std::countr_zero(mask);
+        heap.push(block[j], i + j);
+      }
+    }
+  }
+  for(; i < end; ++i)
+  {
+    heap.push(proj(rows[i]), i);
+  }
+}
+
+// positions of the k rows with the largest proj(row), best first
+template <typename Row, typename Proj>
+std::vector<std::size_t> top_k_indices(std::vector<Row> const& rows,
+                                       std::size_t k,
+                                       Proj proj,
+                                       TopKOptions const& opts = {})
+{
+  using Key = std::decay_t<std::invoke_result_t<Proj&, Row const&>>;
+  if(k == 0)
+  {
+    return {};
+  }
+  unsigned threads = std::max(1u, opts.threads);
+  // every thread keeps its own heap: they are merged once all the slices have been scanned
+  std::vector<TopKHeap<Key>> heaps(threads, TopKHeap<Key>(k));
+  run_on_threads(threads, [&](unsigned t) {
+    top_k_scan(rows, rows.size() * t / threads, rows.size() * (t + 1) / threads, proj, heaps[t]);
+  });
+  for(unsigned t = 1; t < threads; ++t)
+  {
+    heaps[0].merge(heaps[t]);
+  }
+  return heaps[0].sorted_ids();
+}
+
+// copies of the k rows with the largest proj(row), best first
+template <typename Row, typename Proj>
+std::vector<Row> top_k(std::vector<Row> const& rows,
+                       std::size_t k,
+                       Proj proj,
+                       TopKOptions const& opts = {})
+{
+  std::vector<Row> result;
+  for(std::size_t i : top_k_indices(rows, k, proj, opts))
+  {
+    result.push_back(rows[i]);
+  }
+  return result;
+}
+
+// copies of the k rows with the largest field I, best first
+template <unsigned I, typename Row>
+std::vector<Row> top_k(std::vector<Row> const& rows, std::size_t k, TopKOptions const& opts = {})
+{
+  return top_k(rows, k, [](Row const& row) -> decltype(auto) { return get<I>(row); }, opts);
+}
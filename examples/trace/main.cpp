@@ -0,0 +1,144 @@
+#include "../bench/bench.hpp"
+#include "../parallel/runonthreads.hpp"
+#include "../tuple/tuple.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+/*
+    Built twice from this same file: book_examples_trace, and book_examples_trace_disabled with
+    TRACE_DISABLED defined, where the same TRACE_ macros compile to nothing.
+    The first part traces a small tuple pipeline on a few threads and exports it (to the file named by
+    the second argument, if any); the second measures what a span costs in a tight loop.
+*/
+
+using Row = Tuple<std::uint32_t, double>; // key, value
+
+std::vector<Row> generate(std::size_t n, unsigned seed)
+{
+  TRACE_SCOPE_ARG("generate", "rows", n);
+  std::mt19937 rng(seed);
+  std::vector<Row> rows;
+  rows.reserve(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    rows.push_back(Row(std::uint32_t(rng() % 1000), double(rng() % 10'000) / 100));
+  }
+  return rows;
+}
+
+// sums of the values per key, from rows sorted by key
+std::vector<Row> aggregate(std::vector<Row>& rows)
+{
+  {
+    TRACE_SCOPE_ARG("sort", "rows", rows.size());
+    std::sort(rows.begin(), rows.end(), [](Row const& a, Row const& b) { return get<0>(a) < get<0>(b); });
+  }
+  TRACE_SCOPE("sum");
+  std::vector<Row> sums;
+  for(Row const& row : rows)
+  {
+    if(sums.empty() || get<0>(sums.back()) != get<0>(row))
+    {
+      sums.push_back(row);
+    }
+    else
+    {
+      sums.back() = Row(get<0>(row), get<1>(sums.back()) + get<1>(row));
+    }
+  }
+  return sums;
+}
+
+void pipeline(unsigned threads, std::size_t rows_per_chunk)
+{
+  run_on_threads(threads, [&](unsigned t) {
+    TRACE_SCOPE_ARG("worker", "thread", t);
+    for(unsigned chunk = 0; chunk < 4; ++chunk)
+    {
+      TRACE_SCOPE_ARG("chunk", "chunk", chunk);
+      std::vector<Row> rows = generate(rows_per_chunk, t * 4 + chunk);
+      do_not_optimize(aggregate(rows).size());
+    }
+  });
+}
+
+[[gnu::noinline]] std::uint64_t untraced(std::size_t n)
+{
+  std::uint64_t sum = 0;
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    sum += i * 7;
+    do_not_optimize(sum);
+  }
+  return sum;
+}
+
+[[gnu::noinline]] std::uint64_t traced(std::size_t n)
+{
+  std::uint64_t sum = 0;
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    TRACE_SCOPE("span");
+    sum += i * 7;
+    do_not_optimize(sum);
+  }
+  return sum;
+}
+
+[[gnu::noinline]] std::uint64_t traced_arg(std::size_t n)
+{
+  std::uint64_t sum = 0;
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    TRACE_SCOPE_ARG("span with argument", "i", i);
+    sum += i * 7;
+    do_not_optimize(sum);
+  }
+  return sum;
+}
+
+int main(int argc, char** argv)
+{
+#if defined(TRACE_DISABLED)
+  std::cout << "tracing compiled out" << std::endl;
+#endif
+  std::size_t n = size_arg(argc, argv, 10'000'000);
+
+  pipeline(std::min(4u, hardware_threads()), std::max<std::size_t>(n / 100, 1000));
+  std::ostringstream json;
+  write_chrome_trace(json);
+  std::cout << "pipeline: " << TraceRegistry::instance().events() << " events, "
+            << json.str().size() << " bytes of trace JSON" << std::endl;
+  if(argc > 2)
+  {
+    std::ofstream(argv[2]) << json.str();
+    std::cout << "written to " << argv[2] << std::endl;
+  }
+
+  double ticks_ms = time_ms([&] {
+    for(std::size_t i = 0; i < n; ++i)
+    {
+      do_not_optimize(trace_ticks());
+    }
+  });
+  double clock_ms = time_ms([&] {
+    for(std::size_t i = 0; i < n; ++i)
+    {
+      do_not_optimize(std::chrono::steady_clock::now());
+    }
+  });
+  double base_ms = time_ms([&] { do_not_optimize(untraced(n)); });
+  double span_ms = time_ms([&] { do_not_optimize(traced(n)); });
+  double arg_ms = time_ms([&] { do_not_optimize(traced_arg(n)); });
+  std::cout << n << " spans, ns each: timestamp " << ticks_ms * 1e6 / double(n) << " (steady_clock "
+            << clock_ms * 1e6 / double(n) << "), span " << (span_ms - base_ms) * 1e6 / double(n)
+            << ", span with argument " << (arg_ms - base_ms) * 1e6 / double(n) << std::endl;
+  return 0;
+}
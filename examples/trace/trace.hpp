@@ -0,0 +1,279 @@
+#pragma once
+#include "../tuple/tuple.hpp"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+    Scoped tracing for hot paths. TRACE_SCOPE("name") at the top of a block records one span, from
+    there to the end of the block, in a ring buffer owned by the calling thread; write_chrome_trace()
+    later exports every ring as Chrome trace_event JSON, to be opened in chrome://tracing or Perfetto.
+    A span costs two timestamps and one 32-byte store into memory no other thread writes:
+    - timestamps are the time stamp counter (rdtsc) where there is one, converted to time only at
+      export, or steady_clock ticks elsewhere;
+    - names are registered once per call site, in a function-local static, and events carry a
+      16-bit name id;
+    - an event is a trivially copyable Tuple, written with a plain copy, and the ring publishes it
+      with a release store of its head. Nothing is locked or allocated on the way, except once per
+      thread when its ring is created.
+    A ring keeps the last trace_ring_capacity events of its thread, overwriting the oldest. Rings are
+    owned by the registry, so the events of finished threads can still be exported; the export is
+    meant for when the traced work is done, as events written meanwhile may be read half-written.
+    Defining TRACE_DISABLED compiles the TRACE_ macros to nothing.
+*/
+
+// start (ticks), duration (ticks), argument, thread, name id
+using TraceEvent = Tuple<std::uint64_t, std::uint64_t, std::int64_t, std::uint32_t, std::uint16_t>;
+
+static_assert(std::is_trivially_copyable_v<TraceEvent> && sizeof(TraceEvent) == 32);
+
+inline std::uint64_t trace_ticks() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+constexpr std::size_t trace_ring_capacity = std::size_t(1) << 16;
+
+class TraceRing
+{
+  std::unique_ptr<TraceEvent[]> events;
+  std::atomic<std::uint64_t> head{0}; // events ever pushed
+  std::uint32_t thread;
+
+  public:
+  explicit TraceRing(std::uint32_t thread)
+    : events(new TraceEvent[trace_ring_capacity])
+    , thread(thread)
+  { }
+
+  std::uint32_t thread_id() const noexcept
+  {
+    return thread;
+  }
+
+  // called by the owning thread only
+  void push(TraceEvent const& event) noexcept
+  {
+    std::uint64_t h = head.load(std::memory_order_relaxed);
+    events[h & (trace_ring_capacity - 1)] = event;
+    head.store(h + 1, std::memory_order_release);
+  }
+
+  // f(event) for the events still in the ring, oldest first
+  template <typename F>
+  void for_each(F&& f) const
+  {
+    std::uint64_t h = head.load(std::memory_order_acquire);
+    std::uint64_t first = h > trace_ring_capacity ? h - trace_ring_capacity : 0;
+    for(std::uint64_t i = first; i < h; ++i)
+    {
+      f(events[i & (trace_ring_capacity - 1)]);
+    }
+  }
+
+  // events ever pushed, the overwritten ones included
+  std::uint64_t pushed() const noexcept
+  {
+    return head.load(std::memory_order_acquire);
+  }
+};
+
+class TraceRegistry
+{
+  struct Name
+  {
+    std::string name;
+    std::string arg; // empty for spans without an argument
+  };
+
+  std::mutex mutex;
+  std::vector<Name> names;
+  std::vector<std::unique_ptr<TraceRing>> rings;
+  // the same instant in ticks and in steady_clock time, to convert ticks at export
+  std::uint64_t origin_ticks = trace_ticks();
+  std::chrono::steady_clock::time_point origin_time = std::chrono::steady_clock::now();
+
+  TraceRegistry() = default;
+
+  static void write_string(std::ostream& os, std::string const& s)
+  {
+    os << '"';
+    for(char c : s)
+    {
+      if(c == '"' || c == '\\')
+      {
+        os << '\\';
+      }
+      os << c;
+    }
+    os << '"';
+  }
+
+  public:
+  TraceRegistry(TraceRegistry const&) = delete;
+  TraceRegistry& operator=(TraceRegistry const&) = delete;
+
+  static TraceRegistry& instance()
+  {
+    static TraceRegistry registry;
+    return registry;
+  }
+
+  // the id of a span name, with the name of its argument if it has one
+  std::uint16_t name(char const* name, char const* arg = nullptr)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    assert(names.size() < 65536);
+    names.push_back({name, arg ? arg : ""});
+    return std::uint16_t(names.size() - 1);
+  }
+
+  TraceRing& add_ring()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    rings.push_back(std::make_unique<TraceRing>(std::uint32_t(rings.size() + 1)));
+    return *rings.back();
+  }
+
+  std::uint64_t events()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::uint64_t n = 0;
+    for(auto const& ring : rings)
+    {
+      n += ring->pushed();
+    }
+    return n;
+  }
+
+  // nanoseconds per tick, measured between the creation of the registry and now
+  double ns_per_tick()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    auto elapsed = std::chrono::steady_clock::now() - origin_time;
+    if(elapsed < std::chrono::milliseconds(10))
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10) - elapsed);
+    }
+    std::uint64_t ticks = trace_ticks();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - origin_time)
+                  .count();
+    return ns / double(ticks - origin_ticks);
+#else
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::duration(1)).count();
+#endif
+  }
+
+  // every event of every ring, as complete ("X") events with times in microseconds, to the ns: with
+  // the default 6 significant digits, timestamps past 1s would lose the order of short spans
+  void write_chrome_trace(std::ostream& os)
+  {
+    double scale = ns_per_tick() / 1e3;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+    os << "{\"traceEvents\":[";
+    char const* separator = "\n";
+    for(auto const& ring : rings)
+    {
+      ring->for_each([&](TraceEvent const& e) {
+        Name const& name = names[get<4>(e)];
+        os << separator << "{\"name\":";
+        write_string(os, name.name);
+        os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << get<3>(e)
+           << ",\"ts\":" << double(get<0>(e) - origin_ticks) * scale
+           << ",\"dur\":" << double(get<1>(e)) * scale;
+        if(!name.arg.empty())
+        {
+          os << ",\"args\":{";
+          write_string(os, name.arg);
+          os << ":" << get<2>(e) << "}";
+        }
+        os << "}";
+        separator = ",\n";
+      });
+    }
+    os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    os.flags(flags);
+    os.precision(precision);
+  }
+};
+
+// the ring of the calling thread, created on first use
+inline TraceRing& trace_ring()
+{
+  thread_local TraceRing* ring = nullptr;
+  if(ring == nullptr)
+  {
+    ring = &TraceRegistry::instance().add_ring();
+  }
+  return *ring;
+}
+
+class TraceSpan
+{
+  std::uint64_t start;
+  std::int64_t arg;
+  std::uint16_t name;
+
+  public:
+  explicit TraceSpan(std::uint16_t name, std::int64_t arg = 0) noexcept
+    : start(trace_ticks())
+    , arg(arg)
+    , name(name)
+  { }
+
+  TraceSpan(TraceSpan const&) = delete;
+  TraceSpan& operator=(TraceSpan const&) = delete;
+
+  ~TraceSpan()
+  {
+    std::uint64_t end = trace_ticks();
+    TraceRing& ring = trace_ring();
+    ring.push(TraceEvent(start, end - start, arg, ring.thread_id(), name));
+  }
+};
+
+inline void write_chrome_trace(std::ostream& os)
+{
+  TraceRegistry::instance().write_chrome_trace(os);
+}
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+#if defined(TRACE_DISABLED)
+#define TRACE_SCOPE(label) ((void)0)
+#define TRACE_SCOPE_ARG(label, arg_name, value) ((void)0)
+#else
+// a span named label (a string literal) from here to the end of the enclosing block
+#define TRACE_SCOPE(label)                                                                         \
+  static std::uint16_t const TRACE_CONCAT(trace_name_, __LINE__) =                                 \
+    TraceRegistry::instance().name(label);                                                         \
+  TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(TRACE_CONCAT(trace_name_, __LINE__))
+// the same with an integer argument, shown as args.arg_name in the trace
+#define TRACE_SCOPE_ARG(label, arg_name, value)                                                    \
+  static std::uint16_t const TRACE_CONCAT(trace_name_, __LINE__) =                                 \
+    TraceRegistry::instance().name(label, arg_name);                                               \
+  TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(                                                   \
+    TRACE_CONCAT(trace_name_, __LINE__), std::int64_t(value))
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+/*
+    IsTriviallyCopyable<T> tells whether a T can be copied, written out and read back as its raw bytes.
+    It defaults to std::is_trivially_copyable, and Tuple, Tuple3, Tuple4 and Variant specialize it to
+    hold whenever all of their element types do. For Variant this is the whole point: its copy
+    operations are user-provided, so the standard trait is always false, yet with trivially copyable
+    alternatives they reduce to copying the buffer and the discriminator. For the tuples it keeps the
+    answer independent of how their own special members happen to be declared.
+    copy_rows() and BinaryWriter/BinaryReader use it to move whole arrays with one memcpy.
+*/
+template <typename T>
+struct IsTriviallyCopyable : std::is_trivially_copyable<T>
+{ };
+
+// whether sizeof(T) bytes from outside (a file, another process) are the representation of a valid
+// T, to check before copying them into one: any bytes are, unless a specialization says otherwise
+template <typename T>
+struct RepresentationCheck
+{
+  static bool valid(void const*) noexcept
+  {
+    return true;
+  }
+};
+
+// a bool other than 0 or 1 is undefined behavior to read
+template <>
+struct RepresentationCheck<bool>
+{
+  static bool valid(void const* bytes) noexcept
+  {
+    return *static_cast<unsigned char const*>(bytes) <= 1;
+  }
+};
+
+template <typename... Types>
+constexpr bool all_trivially_copyable = (IsTriviallyCopyable<Types>::value && ...);
+
+// copies n rows over n existing rows; one memcpy when the rows are trivially copyable
+template <typename Row>
+void copy_rows(Row const* src, std::size_t n, Row* dst)
+{
+  if constexpr(IsTriviallyCopyable<Row>::value)
+  {
+    std::memcpy(static_cast<void*>(dst), static_cast<void const*>(src), n * sizeof(Row));
+  }
+  else
+  {
+    std::copy(src, src + n, dst);
+  }
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "triviallycopyable.hpp"
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+    IsTriviallyRelocatable<T> tells whether moving a T to a new address and destroying the original
+    can be done by copying its bytes (and then forgetting the original). This is a much weaker
+    requirement than trivial copyability: a std::unique_ptr or a std::vector cannot be copied bitwise,
+    since the copy and the original would both own the same memory, but they can be relocated bitwise,
+    since the original is never destroyed. What breaks it is a pointer into the object itself, or an
+    address registered somewhere else.
+    The trait is opt-in: it holds for trivially copyable types, for the standard types below, and for
+    Tuple, Tuple3, Tuple4 and Variant when it holds for all their elements. Notably it does not hold
+    for std::string in libstdc++, whose short strings point into the object's own buffer; it does in
+    libc++, whose short strings do not.
+*/
+template <typename T>
+struct IsTriviallyRelocatable : IsTriviallyCopyable<T>
+{ };
+
+template <typename... Types>
+constexpr bool all_trivially_relocatable = (IsTriviallyRelocatable<Types>::value && ...);
+
+template <typename T, typename D>
+struct IsTriviallyRelocatable<std::unique_ptr<T, D>> : IsTriviallyRelocatable<D>
+{ };
+
+template <typename T>
+struct IsTriviallyRelocatable<std::shared_ptr<T>> : std::true_type
+{ };
+
+template <typename T>
+struct IsTriviallyRelocatable<std::weak_ptr<T>> : std::true_type
+{ };
+
+template <typename T, typename A>
+struct IsTriviallyRelocatable<std::vector<T, A>> : IsTriviallyRelocatable<A>
+{ };
+
+template <typename T>
+struct IsTriviallyRelocatable<std::allocator<T>> : std::true_type
+{ };
+
+template <typename T>
+struct IsTriviallyRelocatable<std::pmr::polymorphic_allocator<T>> : std::true_type
+{ };
+
+#if defined(_LIBCPP_VERSION)
+template <typename C, typename Traits, typename A>
+struct IsTriviallyRelocatable<std::basic_string<C, Traits, A>> : IsTriviallyRelocatable<A>
+{ };
+#endif
+
+/*
+    Relocates the n objects at src to the uninitialized storage at dst: afterwards the objects live at
+    dst and src is raw storage again. The ranges may overlap, as when a vector opens or closes a gap.
+    For trivially relocatable types this is a single memmove; otherwise every object is
+    move-constructed and then destroyed, in the order that is safe for overlapping ranges.
+*/
+template <typename T>
+void relocate(T* src, std::size_t n, T* dst) noexcept(IsTriviallyRelocatable<T>::value ||
+                                                      std::is_nothrow_move_constructible_v<T>)
+{
+  if(n == 0 || src == dst)
+  {
+    return;
+  }
+  if constexpr(IsTriviallyRelocatable<T>::value)
+  {
+    std::memmove(static_cast<void*>(dst), static_cast<void const*>(src), n * sizeof(T));
+  }
+  else if(dst < src)
+  {
+    for(std::size_t i = 0; i < n; ++i)
+    {
+      ::new(static_cast<void*>(dst + i)) T(std::move(src[i]));
+      src[i].~T();
+    }
+  }
+  else
+  {
+    for(std::size_t i = n; i-- > 0;)
+    {
+      ::new(static_cast<void*>(dst + i)) T(std::move(src[i]));
+      src[i].~T();
+    }
+  }
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "../typelist/typelist.hpp"
+#include "../typelist/value.hpp"
 
 template <unsigned N, typename Result = ValueList<unsigned>>
 struct MakeIndexListT : MakeIndexListT<N - 1, PushFront<CTValue<unsigned, N - 1>, Result>>
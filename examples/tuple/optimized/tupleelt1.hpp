@@ -1,4 +1,6 @@
 #pragma once
+#include <memory>
+#include <type_traits>
 #include <utility>
 
 template <unsigned Height, typename T>
@@ -9,9 +11,14 @@ class TupleElt
   public:
   TupleElt() = default;
   template <typename U>
-  TupleElt(U&& other)
+  TupleElt(U&& other) noexcept(std::is_nothrow_constructible_v<T, U&&>)
     : value(std::forward<U>(other))
   { }
+  // uses-allocator construction of the value (see Tuple)
+  template <typename Alloc, typename... Args>
+  TupleElt(std::allocator_arg_t, Alloc const& alloc, Args&&... args)
+    : value(std::make_obj_using_allocator<T>(alloc, std::forward<Args>(args)...))
+  { }
   T& get()
   {
     return value;
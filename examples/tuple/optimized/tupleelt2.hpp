@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <type_traits>
 #include <utility>
 
@@ -14,9 +15,13 @@ class TupleElt2<Height, T, false>
   public:
   TupleElt2() = default;
   template <typename U>
-  TupleElt2(U&& other)
+  TupleElt2(U&& other) noexcept(std::is_nothrow_constructible_v<T, U&&>)
     : value(std::forward<U>(other))
   { }
+  template <typename Alloc, typename... Args>
+  TupleElt2(std::allocator_arg_t, Alloc const& alloc, Args&&... args)
+    : value(std::make_obj_using_allocator<T>(alloc, std::forward<Args>(args)...))
+  { }
   T& get()
   {
     return value;
@@ -33,9 +38,13 @@ class TupleElt2<Height, T, true> : private T
   public:
   TupleElt2() = default;
   template <typename U>
-  TupleElt2(U&& other)
+  TupleElt2(U&& other) noexcept(std::is_nothrow_constructible_v<T, U&&>)
     : T(std::forward<U>(other))
   { }
+  template <typename Alloc, typename... Args>
+  TupleElt2(std::allocator_arg_t, Alloc const& alloc, Args&&... args)
+    : T(std::make_obj_using_allocator<T>(alloc, std::forward<Args>(args)...))
+  { }
   T& get()
   {
     return *this;
@@ -1,5 +1,8 @@
 #pragma once
+#include "../../traits/triviallyrelocatable.hpp"
 #include "tupleelt1.hpp"
+#include <memory>
+#include <type_traits>
 #include <utility>
 
 /* With this solution, we can produce a Tuple that applies the EBCO while maintaining initialization
@@ -15,21 +18,58 @@ class Tuple3<Head, Tail...> : private TupleElt<sizeof...(Tail), Head>, private T
   using HeadElt = TupleElt<sizeof...(Tail), Head>;
 
   public:
-  Tuple3() { }
+  // as in Tuple: the implicit copy and move operations are noexcept when the elements' are
+  Tuple3() noexcept(std::is_nothrow_default_constructible_v<Head> &&
+                    std::is_nothrow_default_constructible_v<Tuple3<Tail...>>)
+  { }
 
-  Tuple3(Head const& head, Tuple3<Tail...> const& tail)
+  Tuple3(Head const& head, Tuple3<Tail...> const& tail) noexcept(
+    std::is_nothrow_copy_constructible_v<Head> &&
+    std::is_nothrow_copy_constructible_v<Tuple3<Tail...>>)
     : HeadElt(head)
     , Tuple3<Tail...>(tail)
   { }
 
   template <typename VHead,
             typename... VTail,
-            typename = std::enable_if_t<sizeof...(VTail) == sizeof...(Tail)>>
-  Tuple3(VHead&& vhead, VTail&&... vtail)
+            typename = std::enable_if_t<sizeof...(VTail) == sizeof...(Tail) &&
+                                        !std::is_same_v<std::decay_t<VHead>, std::allocator_arg_t>>>
+  Tuple3(VHead&& vhead, VTail&&... vtail) noexcept(
+    std::is_nothrow_constructible_v<Head, VHead&&> &&
+    std::is_nothrow_constructible_v<Tuple3<Tail...>, VTail&&...>)
     : HeadElt(std::forward<VHead>(vhead))
     , Tuple3<Tail...>(std::forward<VTail>(vtail)...)
   { }
 
+  // allocator-extended constructors, as in Tuple
+  template <typename Alloc>
+  Tuple3(std::allocator_arg_t, Alloc const& alloc)
+    : HeadElt(std::allocator_arg, alloc)
+    , Tuple3<Tail...>(std::allocator_arg, alloc)
+  { }
+
+  template <typename Alloc,
+            typename VHead,
+            typename... VTail,
+            typename = std::enable_if_t<sizeof...(VTail) == sizeof...(Tail) &&
+                                        !std::is_same_v<std::decay_t<VHead>, Tuple3>>>
+  Tuple3(std::allocator_arg_t, Alloc const& alloc, VHead&& vhead, VTail&&... vtail)
+    : HeadElt(std::allocator_arg, alloc, std::forward<VHead>(vhead))
+    , Tuple3<Tail...>(std::allocator_arg, alloc, std::forward<VTail>(vtail)...)
+  { }
+
+  template <typename Alloc>
+  Tuple3(std::allocator_arg_t, Alloc const& alloc, Tuple3 const& other)
+    : HeadElt(std::allocator_arg, alloc, other.get_head())
+    , Tuple3<Tail...>(std::allocator_arg, alloc, other.get_tail())
+  { }
+
+  template <typename Alloc>
+  Tuple3(std::allocator_arg_t, Alloc const& alloc, Tuple3&& other)
+    : HeadElt(std::allocator_arg, alloc, std::move(other.get_head()))
+    , Tuple3<Tail...>(std::allocator_arg, alloc, std::move(other.get_tail()))
+  { }
+
   template <typename VHead,
             typename... VTail,
             typename = std::enable_if_t<sizeof...(VTail) == sizeof...(Tail)>>
@@ -60,4 +100,28 @@ template <>
 class Tuple3<>
 {
   // no storage required
-};
\ No newline at end of file
+  public:
+  Tuple3() = default;
+
+  template <typename Alloc>
+  Tuple3(std::allocator_arg_t, Alloc const&)
+  { }
+
+  template <typename Alloc>
+  Tuple3(std::allocator_arg_t, Alloc const&, Tuple3 const&)
+  { }
+};
+
+template <typename... Types, typename Alloc>
+struct std::uses_allocator<Tuple3<Types...>, Alloc>
+  : std::bool_constant<(std::uses_allocator_v<Types, Alloc> || ...)>
+{ };
+
+template <typename... Types>
+struct IsTriviallyCopyable<Tuple3<Types...>> : std::bool_constant<all_trivially_copyable<Types...>>
+{ };
+
+template <typename... Types>
+struct IsTriviallyRelocatable<Tuple3<Types...>>
+  : std::bool_constant<all_trivially_relocatable<Types...>>
+{ };
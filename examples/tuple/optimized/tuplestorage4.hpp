@@ -1,5 +1,8 @@
 #pragma once
+#include "../../traits/triviallyrelocatable.hpp"
 #include "tupleelt2.hpp"
+#include <memory>
+#include <type_traits>
 #include <utility>
 
 /* Same as Tuple3, but uses TupleElt2 */
@@ -14,21 +17,58 @@ class Tuple4<Head, Tail...> : private TupleElt2<sizeof...(Tail), Head>, private
   using HeadElt = TupleElt2<sizeof...(Tail), Head>;
 
   public:
-  Tuple4() { }
+  // as in Tuple: the implicit copy and move operations are noexcept when the elements' are
+  Tuple4() noexcept(std::is_nothrow_default_constructible_v<Head> &&
+                    std::is_nothrow_default_constructible_v<Tuple4<Tail...>>)
+  { }
 
-  Tuple4(Head const& head, Tuple4<Tail...> const& tail)
+  Tuple4(Head const& head, Tuple4<Tail...> const& tail) noexcept(
+    std::is_nothrow_copy_constructible_v<Head> &&
+    std::is_nothrow_copy_constructible_v<Tuple4<Tail...>>)
     : HeadElt(head)
     , Tuple4<Tail...>(tail)
   { }
 
   template <typename VHead,
             typename... VTail,
-            typename = std::enable_if_t<sizeof...(VTail) == sizeof...(Tail)>>
-  Tuple4(VHead&& vhead, VTail&&... vtail)
+            typename = std::enable_if_t<sizeof...(VTail) == sizeof...(Tail) &&
+                                        !std::is_same_v<std::decay_t<VHead>, std::allocator_arg_t>>>
+  Tuple4(VHead&& vhead, VTail&&... vtail) noexcept(
+    std::is_nothrow_constructible_v<Head, VHead&&> &&
+    std::is_nothrow_constructible_v<Tuple4<Tail...>, VTail&&...>)
     : HeadElt(std::forward<VHead>(vhead))
     , Tuple4<Tail...>(std::forward<VTail>(vtail)...)
   { }
 
+  // allocator-extended constructors, as in Tuple
+  template <typename Alloc>
+  Tuple4(std::allocator_arg_t, Alloc const& alloc)
+    : HeadElt(std::allocator_arg, alloc)
+    , Tuple4<Tail...>(std::allocator_arg, alloc)
+  { }
+
+  template <typename Alloc,
+            typename VHead,
+            typename... VTail,
+            typename = std::enable_if_t<sizeof...(VTail) == sizeof...(Tail) &&
+                                        !std::is_same_v<std::decay_t<VHead>, Tuple4>>>
+  Tuple4(std::allocator_arg_t, Alloc const& alloc, VHead&& vhead, VTail&&... vtail)
+    : HeadElt(std::allocator_arg, alloc, std::forward<VHead>(vhead))
+    , Tuple4<Tail...>(std::allocator_arg, alloc, std::forward<VTail>(vtail)...)
+  { }
+
+  template <typename Alloc>
+  Tuple4(std::allocator_arg_t, Alloc const& alloc, Tuple4 const& other)
+    : HeadElt(std::allocator_arg, alloc, other.get_head())
+    , Tuple4<Tail...>(std::allocator_arg, alloc, other.get_tail())
+  { }
+
+  template <typename Alloc>
+  Tuple4(std::allocator_arg_t, Alloc const& alloc, Tuple4&& other)
+    : HeadElt(std::allocator_arg, alloc, std::move(other.get_head()))
+    , Tuple4<Tail...>(std::allocator_arg, alloc, std::move(other.get_tail()))
+  { }
+
   template <typename VHead,
             typename... VTail,
             typename = std::enable_if_t<sizeof...(VTail) == sizeof...(Tail)>>
@@ -62,4 +102,28 @@ template <>
 class Tuple4<>
 {
   // no storage required
-};
\ No newline at end of file
+  public:
+  Tuple4() = default;
+
+  template <typename Alloc>
+  Tuple4(std::allocator_arg_t, Alloc const&)
+  { }
+
+  template <typename Alloc>
+  Tuple4(std::allocator_arg_t, Alloc const&, Tuple4 const&)
+  { }
+};
+
+template <typename... Types, typename Alloc>
+struct std::uses_allocator<Tuple4<Types...>, Alloc>
+  : std::bool_constant<(std::uses_allocator_v<Types, Alloc> || ...)>
+{ };
+
+template <typename... Types>
+struct IsTriviallyCopyable<Tuple4<Types...>> : std::bool_constant<all_trivially_copyable<Types...>>
+{ };
+
+template <typename... Types>
+struct IsTriviallyRelocatable<Tuple4<Types...>>
+  : std::bool_constant<all_trivially_relocatable<Types...>>
+{ };
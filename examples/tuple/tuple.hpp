@@ -1,4 +1,6 @@
 #pragma once
+#include "../traits/triviallyrelocatable.hpp"
+#include <memory>
 #include <type_traits>
 #include <utility>
 
@@ -13,21 +15,67 @@ class Tuple<Head, Tail...>
   Tuple<Tail...> tail;
 
   public:
-  Tuple() { }
+  /*
+    The copy and move operations are the implicit ones, so they are already noexcept exactly when
+    those of all the elements are. The constructors written by hand say so explicitly.
+  */
+  Tuple() noexcept(std::is_nothrow_default_constructible_v<Head> &&
+                   std::is_nothrow_default_constructible_v<Tuple<Tail...>>)
+  { }
 
-  Tuple(Head const& head, Tuple<Tail...> const& tail)
+  Tuple(Head const& head, Tuple<Tail...> const& tail) noexcept(
+    std::is_nothrow_copy_constructible_v<Head> &&
+    std::is_nothrow_copy_constructible_v<Tuple<Tail...>>)
     : head(head)
     , tail(tail)
   { }
 
   template <typename VHead,
             typename... VTail,
-            typename = std::enable_if_t<sizeof...(VTail) == sizeof...(Tail)>>
-  Tuple(VHead&& vhead, VTail&&... vtail)
+            typename = std::enable_if_t<sizeof...(VTail) == sizeof...(Tail) &&
+                                        !std::is_same_v<std::decay_t<VHead>, std::allocator_arg_t>>>
+  Tuple(VHead&& vhead, VTail&&... vtail) noexcept(
+    std::is_nothrow_constructible_v<Head, VHead&&> &&
+    std::is_nothrow_constructible_v<Tuple<Tail...>, VTail&&...>)
     : head(std::forward<VHead>(vhead))
     , tail(std::forward<VTail>(vtail)...)
   { }
 
+  /*
+    Allocator-extended constructors, as for std::tuple: every element that uses the allocator (a
+    std::pmr::string, a std::vector<T, Alloc>, a nested Tuple of those...) is built with it, the others
+    ignore it. std::make_obj_using_allocator picks the right calling convention for each element.
+    Together with the std::uses_allocator specialization below, this is what lets a
+    std::pmr::vector<Tuple<...>> place the strings of its rows in the same memory resource.
+  */
+  template <typename Alloc>
+  Tuple(std::allocator_arg_t, Alloc const& alloc)
+    : head(std::make_obj_using_allocator<Head>(alloc))
+    , tail(std::allocator_arg, alloc)
+  { }
+
+  template <typename Alloc,
+            typename VHead,
+            typename... VTail,
+            typename = std::enable_if_t<sizeof...(VTail) == sizeof...(Tail) &&
+                                        !std::is_same_v<std::decay_t<VHead>, Tuple>>>
+  Tuple(std::allocator_arg_t, Alloc const& alloc, VHead&& vhead, VTail&&... vtail)
+    : head(std::make_obj_using_allocator<Head>(alloc, std::forward<VHead>(vhead)))
+    , tail(std::allocator_arg, alloc, std::forward<VTail>(vtail)...)
+  { }
+
+  template <typename Alloc>
+  Tuple(std::allocator_arg_t, Alloc const& alloc, Tuple const& other)
+    : head(std::make_obj_using_allocator<Head>(alloc, other.head))
+    , tail(std::allocator_arg, alloc, other.tail)
+  { }
+
+  template <typename Alloc>
+  Tuple(std::allocator_arg_t, Alloc const& alloc, Tuple&& other)
+    : head(std::make_obj_using_allocator<Head>(alloc, std::move(other.head)))
+    , tail(std::allocator_arg, alloc, std::move(other.tail))
+  { }
+
   template <typename VHead,
             typename... VTail,
             typename = std::enable_if_t<sizeof...(VTail) == sizeof...(Tail)>>
@@ -57,13 +105,41 @@ class Tuple<Head, Tail...>
 // basis case
 template <>
 class Tuple<>
+{
+  public:
+  Tuple() = default;
+
+  template <typename Alloc>
+  Tuple(std::allocator_arg_t, Alloc const&)
+  { }
+
+  template <typename Alloc>
+  Tuple(std::allocator_arg_t, Alloc const&, Tuple const&)
+  { }
+};
+
+// a tuple takes an allocator when at least one of its elements does
+template <typename... Types, typename Alloc>
+struct std::uses_allocator<Tuple<Types...>, Alloc>
+  : std::bool_constant<(std::uses_allocator_v<Types, Alloc> || ...)>
+{ };
+
+// a tuple is copied element by element, so its bytes can be copied when those of every element can
+template <typename... Types>
+struct IsTriviallyCopyable<Tuple<Types...>> : std::bool_constant<all_trivially_copyable<Types...>>
+{ };
+
+// and its elements can be moved bitwise when each of them can
+template <typename... Types>
+struct IsTriviallyRelocatable<Tuple<Types...>>
+  : std::bool_constant<all_trivially_relocatable<Types...>>
 { };
 
 template <unsigned N>
 struct TupleGet
 {
   template <typename Head, typename... Tail>
-  static auto apply(Tuple<Head, Tail...> const& t)
+  static decltype(auto) apply(Tuple<Head, Tail...> const& t)
   {
     return TupleGet<N - 1>::apply(t.get_tail());
   }
@@ -83,10 +159,12 @@ struct TupleGet<0>
 /* Note that the function template get is simply a thin wrapper over a call to a static member function
 of TupleGet. This technique is effectively a workaround for the lack of partial specialization of
 function templates (discussed in Section 17.3 on page 356), which we use to specialize on the value
-of N.*/
+of N.
+Both return decltype(auto) so that get<N>() yields a reference to the stored element instead of a
+copy: with plain auto every access to a std::string element would allocate.*/
 
 template <unsigned N, typename... Types>
-auto get(Tuple<Types...> const& t)
+decltype(auto) get(Tuple<Types...> const& t)
 {
   return TupleGet<N>::apply(t);
 }
@@ -0,0 +1,78 @@
+#pragma once
+#include "tuple.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+// finalizer of MurmurHash3: spreads every input bit over the whole 64-bit word. It matters because
+// std::hash of integral types is usually the identity, which is a poor input for a hash table.
+inline std::uint64_t hash_mix(std::uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// hash of the object representation of n bytes, 8 bytes at a time; only meaningful for types where
+// equal values have equal bytes (no padding, no pointers to the actual data). Each word costs a
+// multiply and a shift, the full mix is applied once at the end.
+inline std::uint64_t hash_bytes(void const* data, std::size_t n, std::uint64_t seed = 0)
+{
+  constexpr std::uint64_t k = 0x9e3779b97f4a7c15ULL;
+  auto const* p = static_cast<unsigned char const*>(data);
+  std::uint64_t h = seed ^ (n * k);
+  for(; n >= 8; n -= 8, p += 8)
+  {
+    std::uint64_t word;
+    std::memcpy(&word, p, 8);
+    h = (h ^ word) * k;
+    h ^= h >> 32;
+  }
+  if(n > 0)
+  {
+    std::uint64_t word = 0;
+    std::memcpy(&word, p, n);
+    h = (h ^ word) * k;
+  }
+  return hash_mix(h);
+}
+
+// basis case
+inline std::uint64_t hash_tuple(Tuple<> const&, std::uint64_t seed = 0)
+{
+  return seed;
+}
+
+// recursive case: fold the hash of each element into the seed, from head to tail
+template <typename Head, typename... Tail>
+std::uint64_t hash_tuple(Tuple<Head, Tail...> const& t, std::uint64_t seed = 0)
+{
+  seed = hash_mix(seed ^ (std::hash<Head>{}(t.get_head()) + 0x9e3779b97f4a7c15ULL));
+  return hash_tuple(t.get_tail(), seed);
+}
+
+struct TupleHash
+{
+  template <typename... Types>
+  std::size_t operator()(Tuple<Types...> const& t) const
+  {
+    return hash_tuple(t);
+  }
+};
+
+// Hashes a column of tuples, one hash_tuple() per row. The loop itself is plain scalar code (the
+// 64-bit multiplies of the mix have no AVX2 instruction); the gain is for the consumer, which gets
+// the hashes of a whole group before probing a table or a filter, and so can issue its memory
+// accesses back to back instead of interleaving them with the hashing.
+template <typename... Types>
+void hash_tuple_batch(Tuple<Types...> const* keys, std::size_t n, std::uint64_t* out)
+{
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    out[i] = hash_tuple(keys[i]);
+  }
+}
@@ -15,7 +15,17 @@ void print_tuple(std::ostream& strm, Tuple<Head, Tail...> const& t, bool isFirst
   print_tuple(strm, t.get_tail(), false);
 }
 
+/* The template template parameter makes this operator match any class template instance, e.g.
+std::basic_string<char, ...>, which would make printing a string ambiguous wherever this operator
+is visible. Hence it is restricted to Tuple-like types: empty or providing get_head()/get_tail(). */
+template <typename T>
+concept TupleLike = requires(T const& t) {
+  t.get_head();
+  t.get_tail();
+};
+
 template <template<typename...> class Tuple, typename... Types>
+  requires(sizeof...(Types) == 0 || TupleLike<Tuple<Types...>>)
 std::ostream& operator<<(std::ostream& strm, Tuple<Types...> const& t)
 {
   print_tuple(strm, t);
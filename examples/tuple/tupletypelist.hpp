@@ -1,6 +1,12 @@
 #pragma once
+#include "../typelist/front.hpp"
+#include "../typelist/isempty.hpp"
+#include "../typelist/nthelement.hpp"
+#include "../typelist/popfront.hpp"
+#include "../typelist/pushfront.hpp"
 #include "../typelist/typelist.hpp"
 #include "tuple.hpp"
+#include <type_traits>
 
 template <>
 struct IsEmpty<Tuple<>>
@@ -30,4 +36,8 @@ class PushFrontT<Element, Tuple<Types...>>
 {
   public:
   using Type = Tuple<Element, Types...>;
-};
\ No newline at end of file
+};
+
+// the (decayed) type of the I-th element of a Tuple, e.g. of the I-th column of a table of rows
+template <typename Row, unsigned I>
+using FieldType = std::decay_t<NthElement<Row, I>>;
@@ -1,5 +1,21 @@
 #pragma once
+#include <cstdlib>
 #include <exception>
 
 class EmptyVariant : public std::exception
-{ };
\ No newline at end of file
+{ };
+
+/*
+    get() and visit() report an empty variant by throwing EmptyVariant. In a build without exceptions
+    (-fno-exceptions, which leaves __cpp_exceptions undefined) there is nothing to throw, and reaching
+    an empty variant there is a bug that aborts; code that has to handle empty variants uses the
+    exception-free get_if() and try_visit() instead.
+*/
+[[noreturn]] inline void throw_empty_variant()
+{
+#if defined(__cpp_exceptions)
+  throw EmptyVariant();
+#else
+  std::abort();
+#endif
+}
@@ -0,0 +1,257 @@
+#pragma once
+#include "../typelist/front.hpp"
+#include "../typelist/typelist.hpp"
+#include "emptyvariant.hpp"
+#include "findindexof.hpp"
+#include "variant.hpp"
+#include "variantvisitimpl.hpp"
+#include "visitexpected.hpp"
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+/*
+    A second storage policy for Variant: NaN boxing, as in the value representation of many script
+    engines. The variant is a single 64-bit word. A double is stored as itself; every other alternative
+    is stored in the payload of a NaN that no arithmetic ever produces: the top 16 bits hold a tag
+    (0xFFF9 for the empty variant, then 0xFFFA, 0xFFFB... for the alternatives in list order) and the
+    low 48 bits the value. That fits an int32_t, a bool, or a pointer, since user-space pointers on
+    x86-64 and AArch64 have their top 16 bits clear. A double NaN whose bits would collide with a tag
+    is replaced by the canonical quiet NaN when stored.
+    So a Variant<double, int32_t, bool, Object*> takes 8 bytes instead of 16, is trivially copyable,
+    and is passed and returned in a register.
+    The layout is selected per list of alternatives: specializing VariantUsesNanBox for the TypeList
+    switches Variant<Types...> over to the specialization below. It keeps is<T>(), get<T>(), visit(),
+    try_visit() and emplace(), with one difference: a boxed value is not an object in memory, so get<T>()
+    returns it by value, and visitors receive values (a visitor taking auto& does not compile, auto
+    const& and auto do), and there is no get_if().
+*/
+template <typename List>
+struct VariantUsesNanBox : std::false_type
+{ };
+
+template <typename T>
+constexpr bool nan_boxable_alternative =
+  std::is_same_v<T, double> || std::is_same_v<T, std::int32_t> || std::is_same_v<T, bool> ||
+  (std::is_pointer_v<T> && std::is_object_v<std::remove_pointer_t<T>>);
+
+// a double and at most five other alternatives, each fitting in 48 bits
+template <typename... Types>
+constexpr bool nan_boxable = sizeof...(Types) <= 6 && (nan_boxable_alternative<Types> && ...) &&
+                             (std::is_same_v<Types, double> + ...) == 1;
+
+template <typename... Types>
+class NanBoxStorage
+{
+  static constexpr unsigned tag_shift = 48;
+  static constexpr std::uint64_t payload_mask = (std::uint64_t(1) << tag_shift) - 1;
+  static constexpr std::uint64_t empty_tag = 0xFFF9;
+  static constexpr std::uint64_t canonical_nan = 0x7FF8'0000'0000'0000;
+
+  template <typename T>
+  static constexpr std::uint64_t tag = empty_tag + 1 + FindIndexOfT<TypeList<Types...>, T>::value;
+
+  std::uint64_t bits = empty_tag << tag_shift;
+
+  public:
+  template <typename T>
+  static std::uint64_t encode(T value) noexcept
+  {
+    if constexpr(std::is_same_v<T, double>)
+    {
+      auto b = std::bit_cast<std::uint64_t>(value);
+      return (b >> tag_shift) >= empty_tag ? canonical_nan : b;
+    }
+    else if constexpr(std::is_pointer_v<T>)
+    {
+      auto address = reinterpret_cast<std::uintptr_t>(value);
+      assert((address & ~payload_mask) == 0);
+      return tag<T> << tag_shift | address;
+    }
+    else
+    {
+      // int32_t and bool, zero-extended
+      return tag<T> << tag_shift | std::uint32_t(value);
+    }
+  }
+
+  template <typename T>
+  static T decode(std::uint64_t b) noexcept
+  {
+    if constexpr(std::is_same_v<T, double>)
+    {
+      return std::bit_cast<double>(b);
+    }
+    else if constexpr(std::is_pointer_v<T>)
+    {
+      return reinterpret_cast<T>(std::uintptr_t(b & payload_mask));
+    }
+    else if constexpr(std::is_same_v<T, bool>)
+    {
+      return (b & 1) != 0;
+    }
+    else
+    {
+      return std::int32_t(std::uint32_t(b));
+    }
+  }
+
+  template <typename T>
+  bool holds() const noexcept
+  {
+    if constexpr(std::is_same_v<T, double>)
+    {
+      return (bits >> tag_shift) < empty_tag;
+    }
+    else
+    {
+      return (bits >> tag_shift) == tag<T>;
+    }
+  }
+
+  template <typename T>
+  T load() const noexcept
+  {
+    return decode<T>(bits);
+  }
+
+  template <typename T>
+  void store(T value) noexcept
+  {
+    bits = encode<T>(value);
+  }
+
+  bool holds_nothing() const noexcept
+  {
+    return (bits >> tag_shift) == empty_tag;
+  }
+
+  void clear() noexcept
+  {
+    bits = empty_tag << tag_shift;
+  }
+
+  // the word itself, for hashing and bitwise comparison
+  std::uint64_t raw_bits() const noexcept
+  {
+    return bits;
+  }
+};
+
+// the visitors get values, so a computed result type T&& (see VisitResult) is a T
+template <typename R>
+using NanBoxVisitResult = std::conditional_t<std::is_rvalue_reference_v<R>, std::remove_cvref_t<R>, R>;
+
+// the constructor and assignment from one alternative T; with at most six alternatives, one base per
+// alternative costs little (compare VariantChoice)
+template <typename T, typename... Types>
+class NanBoxChoice
+{
+  using Derived = Variant<Types...>;
+  Derived& get_derived()
+  {
+    return static_cast<Derived&>(*this);
+  }
+
+  public:
+  NanBoxChoice() noexcept { }
+
+  NanBoxChoice(T value) noexcept
+  {
+    get_derived().template store<T>(value);
+  }
+
+  Derived& operator=(T value) noexcept
+  {
+    get_derived().template store<T>(value);
+    return get_derived();
+  }
+};
+
+template <typename... Types>
+  requires VariantUsesNanBox<TypeList<Types...>>::value
+class Variant<Types...> : private NanBoxStorage<Types...>, private NanBoxChoice<Types, Types...>...
+{
+  static_assert(nan_boxable<Types...>, "NaN boxing needs a double and int32_t, bool or pointers");
+
+  template <typename T, typename... OtherTypes>
+  friend class NanBoxChoice;
+
+  public:
+  using NanBoxChoice<Types, Types...>::NanBoxChoice...;
+  using NanBoxChoice<Types, Types...>::operator=...;
+
+  Variant() noexcept
+  {
+    this->store(Front<TypeList<Types...>>());
+  }
+
+  template <typename T>
+  bool is() const noexcept
+  {
+    return this->template holds<T>();
+  }
+
+  template <typename T>
+  T get() const
+  {
+    if(empty())
+    {
+      throw_empty_variant();
+    }
+    assert(is<T>());
+    return this->template load<T>();
+  }
+
+  bool empty() const noexcept
+  {
+    return this->holds_nothing();
+  }
+
+  void destroy() noexcept
+  {
+    this->clear();
+  }
+
+  template <typename T>
+  T emplace(T value) noexcept
+  {
+    this->store(value);
+    return value;
+  }
+
+  std::uint64_t raw_bits() const noexcept
+  {
+    return NanBoxStorage<Types...>::raw_bits();
+  }
+
+  template <typename R = ComputedResultType, typename Visitor>
+  NanBoxVisitResult<VisitResult<R, Visitor, Types...>> visit(Visitor&& vis) const
+  {
+    using Result = NanBoxVisitResult<VisitResult<R, Visitor, Types...>>;
+    return variant_visit_impl<Result>(*this, std::forward<Visitor>(vis), TypeList<Types...>());
+  }
+
+  template <typename R = ComputedResultType, typename Visitor>
+  VisitExpectedFor<VisitResult<R, Visitor, Types...>> try_visit(Visitor&& vis) const
+  {
+    using Result = typename VisitExpectedFor<VisitResult<R, Visitor, Types...>>::value_type;
+    if(empty())
+    {
+      return {};
+    }
+    if constexpr(std::is_void_v<Result>)
+    {
+      variant_visit_impl<Result>(*this, std::forward<Visitor>(vis), TypeList<Types...>());
+      return VisitExpected<void>(std::in_place);
+    }
+    else
+    {
+      return {std::in_place, [&]() -> Result {
+                return variant_visit_impl<Result>(*this, std::forward<Visitor>(vis), TypeList<Types...>());
+              }};
+    }
+  }
+};
@@ -1,16 +1,29 @@
 #pragma once
 
+#include "../traits/triviallyrelocatable.hpp"
 #include "emptyvariant.hpp"
+#include "findindexof.hpp"
 #include "variantchoice.hpp"
 #include "variantstorage.hpp"
 #include "variantvisitimpl.hpp"
+#include "visitexpected.hpp"
 #include <cassert>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 template <typename... Types>
-class Variant : private VariantStorage<Types...>, private VariantChoice<Types, Types...>...
+class Variant
+  : private VariantStorage<Types...>
+  , private VariantChoices<TypeList<Types...>, std::index_sequence_for<Types...>>
 {
-  template <typename T, typename... OtherTypes>
-  friend class VariantChoice;
+  using Choices = VariantChoices<TypeList<Types...>, std::index_sequence_for<Types...>>;
+
+  // the discriminator of T; FindIndexOfT fails to compile if T is not an alternative
+  template <typename T>
+  static constexpr unsigned discriminator_of = FindIndexOfT<TypeList<Types...>, T>::value + 1;
 
   public:
   template <typename T>
@@ -22,8 +35,29 @@ class Variant : private VariantStorage<Types...>, private VariantChoice<Types, T
   template <typename T>
   T const& get() const&;
 
-  using VariantChoice<Types, Types...>::VariantChoice...;
-  Variant()
+  // lets visit() on an rvalue variant move the value out, as needed for move-only alternatives
+  template <typename T>
+  T&& get() &&;
+
+  /*
+    Constructs and assigns the alternative that value converts to, picked by overload resolution
+    among the choose() overloads of the VariantChoice bases, so that Variant<int, std::string>
+    holds an int after = 'a' and a std::string after = "text".
+  */
+  template <typename U, typename Choice = ChosenAlternative<Choices, U>>
+    requires(!is_variant<std::remove_cvref_t<U>>)
+  Variant(U&& value) noexcept(nothrow_constructible<typename Choice::Type, U&&>)
+  {
+    construct_alternative<typename Choice::Type>(
+      this->get_raw_buff(), this->get_storage_allocator(), std::forward<U>(value));
+    this->set_discriminator(Choice::discriminator);
+  }
+
+  template <typename U, typename Choice = ChosenAlternative<Choices, U>>
+    requires(!is_variant<std::remove_cvref_t<U>>)
+  Variant& operator=(U&& value) noexcept(nothrow_assignable<typename Choice::Type, U&&>);
+
+  Variant() noexcept(nothrow_default)
   {
     /*
     making this the default initialization behavior would promote the
@@ -35,19 +69,18 @@ class Variant : private VariantStorage<Types...>, private VariantChoice<Types, T
     *this = Front<TypeList<Types...>>();
   }
 
-  Variant(Variant const& source);
-  Variant(Variant&& source);
+  Variant(Variant const& source) noexcept(nothrow_copy);
+  Variant(Variant&& source) noexcept(nothrow_move);
 
-  using VariantChoice<Types, Types...>::operator=...;
-  Variant& operator=(Variant const& source);
-  Variant& operator=(Variant&& source);
+  Variant& operator=(Variant const& source) noexcept(nothrow_copy_assign);
+  Variant& operator=(Variant&& source) noexcept(nothrow_move_assign);
 
   bool empty() const;
   ~Variant()
   {
     destroy();
   }
-  void destroy();
+  void destroy() noexcept;
 
   // visitors
   template <typename R = ComputedResultType, typename Visitor>
@@ -57,20 +90,159 @@ class Variant : private VariantStorage<Types...>, private VariantChoice<Types, T
   template <typename R = ComputedResultType, typename Visitor>
   VisitResult<R, Visitor, Types&&...> visit(Visitor&& vis) &&;
 
+  /*
+    Exception-free access, for code built with -fno-exceptions or that simply must not unwind:
+    get_if<T>() returns a pointer to the value when the variant holds a T and nullptr otherwise (empty
+    included), try_visit() returns a VisitExpected holding either the result of the visitor or the
+    EmptyVariant error, and emplace<T>() constructs a T in place and is noexcept when that construction
+    is. None of them has a path that throws.
+  */
+  template <typename T>
+  T* get_if() noexcept;
+  template <typename T>
+  T const* get_if() const noexcept;
+
+  template <typename R = ComputedResultType, typename Visitor>
+  VisitExpectedFor<VisitResult<R, Visitor, Types&...>> try_visit(Visitor&& vis) &;
+  template <typename R = ComputedResultType, typename Visitor>
+  VisitExpectedFor<VisitResult<R, Visitor, Types const&...>> try_visit(Visitor&& vis) const&;
+  template <typename R = ComputedResultType, typename Visitor>
+  VisitExpectedFor<VisitResult<R, Visitor, Types&&...>> try_visit(Visitor&& vis) &&;
+
+  template <typename T, typename... Args>
+  T& emplace(Args&&... args) noexcept(
+    VariantStorage<Types...>::template nothrow_constructible<T, Args&&...>);
+
   // templated constructors
   template <typename... SourceTypes>
   Variant(Variant<SourceTypes...> const& source);
   template <typename... SourceTypes>
   Variant(Variant<SourceTypes...>&& source);
+
+  /*
+    Allocator-extended constructors, available when some alternative takes a
+    std::pmr::polymorphic_allocator (see VariantStorage). The allocator is kept for the lifetime of the
+    variant: every value assigned later is built with it too. As for the std::pmr containers, a copy
+    gets the default resource, a move keeps the source's allocator, and assignment never changes it.
+  */
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  Variant(std::allocator_arg_t, allocator_type const& alloc)
+    requires variant_uses_resource<Types...>
+    : VariantStorage<Types...>(alloc)
+  {
+    *this = Front<TypeList<Types...>>();
+  }
+
+  // the alternative is chosen as by the converting constructor, so that uses-allocator construction
+  // accepts whatever that one does (a string literal for a std::pmr::string alternative)
+  template <typename U, typename Choice = ChosenAlternative<Choices, U>>
+    requires variant_uses_resource<Types...> && (!is_variant<std::remove_cvref_t<U>>)
+  Variant(std::allocator_arg_t, allocator_type const& alloc, U&& value)
+    : VariantStorage<Types...>(alloc)
+  {
+    construct_alternative<typename Choice::Type>(
+      this->get_raw_buff(), this->get_storage_allocator(), std::forward<U>(value));
+    this->set_discriminator(Choice::discriminator);
+  }
+
+  Variant(std::allocator_arg_t, allocator_type const& alloc, Variant const& source)
+    requires variant_uses_resource<Types...>
+    : VariantStorage<Types...>(alloc)
+  {
+    *this = source;
+  }
+
+  Variant(std::allocator_arg_t, allocator_type const& alloc, Variant&& source)
+    requires variant_uses_resource<Types...>
+    : VariantStorage<Types...>(alloc)
+  {
+    *this = std::move(source);
+  }
+
+  allocator_type get_allocator() const
+    requires variant_uses_resource<Types...>
+  {
+    return this->get_storage_allocator();
+  }
+
+  private:
+  /*
+    Each special member is noexcept when what it does to every alternative is, so that
+    std::vector<Variant<...>> moves its elements when it grows (std::move_if_noexcept) instead of
+    copying them. The move constructor moves the value with its own move constructor, allocator and
+    all, so only that has to be noexcept; the assignments go through operator=(U&&).
+    Assigning a T may construct one (when the variant held another type) or assign one (when it held
+    a T already).
+  */
+  template <typename T, typename U>
+  static constexpr bool nothrow_constructible =
+    VariantStorage<Types...>::template nothrow_constructible<T, U>;
+  template <typename T, typename U>
+  static constexpr bool nothrow_assignable =
+    nothrow_constructible<T, U> && std::is_nothrow_assignable_v<T&, U>;
+
+  static constexpr bool nothrow_default =
+    std::is_nothrow_default_constructible_v<Front<TypeList<Types...>>> &&
+    nothrow_assignable<Front<TypeList<Types...>>, Front<TypeList<Types...>>&&>;
+  static constexpr bool nothrow_copy = (nothrow_constructible<Types, Types const&> && ...);
+  static constexpr bool nothrow_move = (std::is_nothrow_move_constructible_v<Types> && ...);
+  static constexpr bool nothrow_copy_assign = (nothrow_assignable<Types, Types const&> && ...);
+  static constexpr bool nothrow_move_assign = (nothrow_assignable<Types, Types&&> && ...);
+
+  /*
+    Visiting tests the alternatives one after the other, which inlines into a short chain of compares
+    for a few alternatives. Past eight, it indexes a table of visit_alternative() calls instead:
+    one indirect call, and no recursion instantiating a function per alternative named after the
+    whole variant.
+  */
+  static constexpr bool visit_by_table = sizeof...(Types) > 8;
+
+  // T with the value category of the variant Self
+  template <typename Self, typename T>
+  using Qualified =
+    std::conditional_t<std::is_lvalue_reference_v<Self>,
+                       std::conditional_t<std::is_const_v<std::remove_reference_t<Self>>, T const&, T&>,
+                       T&&>;
+
+  template <typename R, typename Self, typename Visitor>
+  static R visit_checked(Self&& self, Visitor&& vis);
+
+  // visits a variant known not to be empty: the last alternative needs no check
+  template <typename R, typename Self, typename Visitor, typename Head, typename... Tail>
+  static R visit_nonempty(Self&& self, Visitor&& vis, TypeList<Head, Tail...>);
+
+  // with trivially copyable alternatives, copying the storage (buffer and discriminator) is a copy
+  static constexpr bool trivial_copy = all_trivially_copyable<Types...>;
+  void copy_storage(Variant const& source)
+  {
+    static_cast<VariantStorage<Types...>&>(*this) = source;
+  }
 };
 
+template <typename... Types>
+struct IsTriviallyCopyable<Variant<Types...>> : std::bool_constant<all_trivially_copyable<Types...>>
+{ };
+
+// relocating a variant relocates its active alternative; the discriminator is just a number
+template <typename... Types>
+struct IsTriviallyRelocatable<Variant<Types...>>
+  : std::bool_constant<all_trivially_relocatable<Types...>>
+{ };
+
+template <typename... Types, typename Alloc>
+struct std::uses_allocator<Variant<Types...>, Alloc>
+  : std::bool_constant<variant_uses_resource<Types...> &&
+                       std::is_convertible_v<Alloc, std::pmr::polymorphic_allocator<>>>
+{ };
+
 template <typename... Types>
 template <typename T>
 T& Variant<Types...>::get() &
 {
   if(empty())
   {
-    throw EmptyVariant();
+    throw_empty_variant();
   }
 
   assert(is<T>());
@@ -83,31 +255,76 @@ const T& Variant<Types...>::get() const&
 {
   if(empty())
   {
-    throw EmptyVariant();
+    throw_empty_variant();
   }
 
   assert(is<T>());
   return *(this->template get_buff_as<T>());
 }
 
+template <typename... Types>
+template <typename T>
+T&& Variant<Types...>::get() &&
+{
+  if(empty())
+  {
+    throw_empty_variant();
+  }
+
+  assert(is<T>());
+  return std::move(*(this->template get_buff_as<T>()));
+}
+
+template <typename... Types>
+template <typename T>
+T* Variant<Types...>::get_if() noexcept
+{
+  return is<T>() ? this->template get_buff_as<T>() : nullptr;
+}
+
+template <typename... Types>
+template <typename T>
+T const* Variant<Types...>::get_if() const noexcept
+{
+  return is<T>() ? this->template get_buff_as<T>() : nullptr;
+}
+
+template <typename... Types>
+template <typename T, typename... Args>
+T& Variant<Types...>::emplace(Args&&... args) noexcept(
+  VariantStorage<Types...>::template nothrow_constructible<T, Args&&...>)
+{
+  // if the construction throws, the variant is left empty, as by an assignment
+  destroy();
+  this->template construct<T>(std::forward<Args>(args)...);
+  this->set_discriminator(discriminator_of<T>);
+  return *this->template get_buff_as<T>();
+}
+
 template <typename... Types>
 template <typename T>
 bool Variant<Types...>::is() const
 {
   /*
-    If the type we’re looking for (T) is not found in the list, the VariantChoice base class will fail
+    If the type we’re looking for (T) is not found in the list, discriminator_of<T> will fail
     to instantiate because FindIndexOfT will not contain a value member, causing an (intentional)
     compilation failure in is<T>(). This prevents user errors where the user is asking for a type that
     cannot possibly be stored in the variant.
     */
-  return this->get_discriminator() == VariantChoice<T, Types...>::discriminator;
+  return this->get_discriminator() == discriminator_of<T>;
 }
 
 template <typename... Types>
-void Variant<Types...>::destroy()
+void Variant<Types...>::destroy() noexcept
 {
-  // call destroy() on each VariantChoice base class; at most one will succeed:
-  (VariantChoice<Types, Types...>::destroy(), ...);
+  /*
+    Destroys the active alternative, if any, with a fold over the alternatives in this one function
+    rather than a function per alternative. The copies, moves and assignments below do the same: no
+    function is instantiated per alternative whose name mentions the whole variant.
+  */
+  unsigned char d = this->get_discriminator();
+  ((d == discriminator_of<Types> && (std::destroy_at(&alternative_at<Types>(this->get_raw_buff())), true)) ||
+   ...);
 
   // indicate that the variant does not store a value
   this->set_discriminator(0);
@@ -119,12 +336,41 @@ bool Variant<Types...>::empty() const
   return this->get_discriminator() == 0;
 }
 
+/*
+    If the destruction of the existing value completes but the initialization of the new value throws an
+    exception, what is the state of the variant? In our implementation, Variant::destroy() resets
+    the discriminator value to 0. In nonexceptional cases, the discriminator will be set appropriately
+    after initialization completes. When an exception occurs during initialization of the new value, the
+    discriminator remains 0 to indicate that the variant does not store a value.
+*/
+template <typename... Types>
+template <typename U, typename Choice>
+  requires(!is_variant<std::remove_cvref_t<U>>)
+Variant<Types...>& Variant<Types...>::operator=(U&& value) noexcept(
+  nothrow_assignable<typename Choice::Type, U&&>)
+{
+  using T = typename Choice::Type;
+  if(this->get_discriminator() == Choice::discriminator)
+  {
+    // assign new value of same type:
+    alternative_at<T>(this->get_raw_buff()) = std::forward<U>(value);
+  }
+  else
+  {
+    // assign new value of different type, with the variant's allocator:
+    destroy();
+    construct_alternative<T>(this->get_raw_buff(), this->get_storage_allocator(), std::forward<U>(value));
+    this->set_discriminator(Choice::discriminator);
+  }
+  return *this;
+}
+
 template <typename... Types>
 template <typename R, typename Visitor>
 VisitResult<R, Visitor, Types&...> Variant<Types...>::visit(Visitor&& vis) &
 {
   using Result = VisitResult<R, Visitor, Types&...>;
-  return variant_visit_impl<Result>(*this, std::forward<Visitor>(vis), TypeList<Types...>{});
+  return visit_checked<Result>(*this, std::forward<Visitor>(vis));
 }
 
 template <typename... Types>
@@ -132,7 +378,7 @@ template <typename R, typename Visitor>
 VisitResult<R, Visitor, Types const&...> Variant<Types...>::visit(Visitor&& vis) const&
 {
   using Result = VisitResult<R, Visitor, Types const&...>;
-  return variant_visit_impl<Result>(*this, std::forward<Visitor>(vis), TypeList<Types...>{});
+  return visit_checked<Result>(*this, std::forward<Visitor>(vis));
 }
 
 template <typename... Types>
@@ -140,34 +386,165 @@ template <typename R, typename Visitor>
 VisitResult<R, Visitor, Types&&...> Variant<Types...>::visit(Visitor&& vis) &&
 {
   using Result = VisitResult<R, Visitor, Types&&...>;
-  return variant_visit_impl<Result>(
-    std::move(*this), std::forward<Visitor>(vis), TypeList<Types...>{});
+  return visit_checked<Result>(std::move(*this), std::forward<Visitor>(vis));
+}
+
+template <typename... Types>
+template <typename R, typename Self, typename Visitor>
+R Variant<Types...>::visit_checked(Self&& self, Visitor&& vis)
+{
+  if constexpr(visit_by_table)
+  {
+    if(self.empty())
+    {
+      throw_empty_variant();
+    }
+    return visit_nonempty<R>(std::forward<Self>(self), std::forward<Visitor>(vis), TypeList<Types...>());
+  }
+  else
+  {
+    return variant_visit_impl<R>(std::forward<Self>(self), std::forward<Visitor>(vis), TypeList<Types...>());
+  }
+}
+
+template <typename... Types>
+template <typename R, typename Self, typename Visitor, typename Head, typename... Tail>
+R Variant<Types...>::visit_nonempty(Self&& self, Visitor&& vis, TypeList<Head, Tail...>)
+{
+  if constexpr(visit_by_table)
+  {
+    using Call = R (*)(void*, Visitor&&);
+    static constexpr Call table[] = {&visit_alternative<R, Qualified<Self, Types>, Visitor>...};
+    return table[self.get_discriminator() - 1](
+      const_cast<void*>(self.get_raw_buff()), std::forward<Visitor>(vis));
+  }
+  else
+  {
+    if constexpr(sizeof...(Tail) > 0)
+    {
+      if(!self.template is<Head>())
+      {
+        return visit_nonempty<R>(std::forward<Self>(self), std::forward<Visitor>(vis), TypeList<Tail...>());
+      }
+    }
+    if constexpr(std::is_lvalue_reference_v<Self>)
+    {
+      return static_cast<R>(std::forward<Visitor>(vis)(*self.template get_buff_as<Head>()));
+    }
+    else
+    {
+      return static_cast<R>(std::forward<Visitor>(vis)(std::move(*self.template get_buff_as<Head>())));
+    }
+  }
+}
+
+template <typename... Types>
+template <typename R, typename Visitor>
+VisitExpectedFor<VisitResult<R, Visitor, Types&...>> Variant<Types...>::try_visit(Visitor&& vis) &
+{
+  using Result = typename VisitExpectedFor<VisitResult<R, Visitor, Types&...>>::value_type;
+  if(empty())
+  {
+    return {};
+  }
+  if constexpr(std::is_void_v<Result>)
+  {
+    visit_nonempty<Result>(*this, std::forward<Visitor>(vis), TypeList<Types...>());
+    return VisitExpected<void>(std::in_place);
+  }
+  else
+  {
+    return {std::in_place, [&]() -> Result {
+              return visit_nonempty<Result>(*this, std::forward<Visitor>(vis), TypeList<Types...>());
+            }};
+  }
+}
+
+template <typename... Types>
+template <typename R, typename Visitor>
+VisitExpectedFor<VisitResult<R, Visitor, Types const&...>> Variant<Types...>::try_visit(
+  Visitor&& vis) const&
+{
+  using Result = typename VisitExpectedFor<VisitResult<R, Visitor, Types const&...>>::value_type;
+  if(empty())
+  {
+    return {};
+  }
+  if constexpr(std::is_void_v<Result>)
+  {
+    visit_nonempty<Result>(*this, std::forward<Visitor>(vis), TypeList<Types...>());
+    return VisitExpected<void>(std::in_place);
+  }
+  else
+  {
+    return {std::in_place, [&]() -> Result {
+              return visit_nonempty<Result>(*this, std::forward<Visitor>(vis), TypeList<Types...>());
+            }};
+  }
+}
+
+template <typename... Types>
+template <typename R, typename Visitor>
+VisitExpectedFor<VisitResult<R, Visitor, Types&&...>> Variant<Types...>::try_visit(Visitor&& vis) &&
+{
+  using Result = typename VisitExpectedFor<VisitResult<R, Visitor, Types&&...>>::value_type;
+  if(empty())
+  {
+    return {};
+  }
+  if constexpr(std::is_void_v<Result>)
+  {
+    visit_nonempty<Result>(std::move(*this), std::forward<Visitor>(vis), TypeList<Types...>());
+    return VisitExpected<void>(std::in_place);
+  }
+  else
+  {
+    return {std::in_place, [&]() -> Result {
+              return visit_nonempty<Result>(
+                std::move(*this), std::forward<Visitor>(vis), TypeList<Types...>());
+            }};
+  }
 }
 
 template <typename... Types>
-Variant<Types...>::Variant(Variant const& source)
+Variant<Types...>::Variant(Variant const& source) noexcept(nothrow_copy)
 {
+  if constexpr(trivial_copy)
+  {
+    copy_storage(source);
+    return;
+  }
+
   /*
   To copy a source variant, we need to determine
   which type it is currently storing, copy-construct that value into the buffer, and set that discrimi-
-  nator. Fortunately, visit() handles decoding the active value of the source variant, and the copy-
-  assignment operator inherited from VariantChoice will copy-construct a value into the buffer, 
-  leading to a compact implementation.
+  nator. If the copy throws, the discriminator is still 0 and the variant is empty.
   */
-
-  if(!source.empty())
-  {
-    source.visit([&](auto const& value) { *this = value; });
-  }
+  unsigned char d = source.get_discriminator();
+  ((d == discriminator_of<Types> &&
+    (construct_alternative<Types>(
+       this->get_raw_buff(), this->get_storage_allocator(), alternative_at<Types>(source.get_raw_buff())),
+     true)) ||
+   ...);
+  this->set_discriminator(d);
 }
 
 template <typename... Types>
-Variant<Types...>::Variant(Variant&& source)
+Variant<Types...>::Variant(Variant&& source) noexcept(nothrow_move)
+  : VariantStorage<Types...>(source.get_storage_allocator())
 {
-  if(!source.empty())
+  if constexpr(trivial_copy)
   {
-    std::move(source).visit([&](auto&& value) { *this = std::move(value); });
+    copy_storage(source);
+    return;
   }
+
+  // a plain move: the value keeps the source's allocator, which is now this variant's too
+  unsigned char d = source.get_discriminator();
+  ((d == discriminator_of<Types> &&
+    (new(this->get_raw_buff()) Types(std::move(alternative_at<Types>(source.get_raw_buff()))), true)) ||
+   ...);
+  this->set_discriminator(d);
 }
 
 template <typename... Types>
@@ -186,34 +563,76 @@ Variant<Types...>::Variant(Variant<SourceTypes...>&& source)
 {
   if(!source.empty())
   {
-    std::move(source).visit([&](auto&& value) { *this = std::move(value); });
+    std::move(source).visit([&](auto&& value) -> void { *this = std::move(value); });
   }
 }
 
 template <typename... Types>
-Variant<Types...>& Variant<Types...>::operator=(Variant const& source)
+Variant<Types...>& Variant<Types...>::operator=(Variant const& source) noexcept(nothrow_copy_assign)
 {
-  if(!source.empty())
+  if constexpr(trivial_copy)
   {
-    source.visit([&](auto const& value) { *this = value; });
+    copy_storage(source);
+    return *this;
+  }
+
+  // as an assignment of the source's value (see operator=(U&&))
+  unsigned char d = source.get_discriminator();
+  if(d == 0)
+  {
+    destroy();
+  }
+  else if(d == this->get_discriminator())
+  {
+    ((d == discriminator_of<Types> &&
+      (alternative_at<Types>(this->get_raw_buff()) = alternative_at<Types>(source.get_raw_buff()), true)) ||
+     ...);
   }
   else
   {
     destroy();
+    ((d == discriminator_of<Types> &&
+      (construct_alternative<Types>(
+         this->get_raw_buff(), this->get_storage_allocator(), alternative_at<Types>(source.get_raw_buff())),
+       true)) ||
+     ...);
+    this->set_discriminator(d);
   }
   return *this;
 }
 
 template <typename... Types>
-Variant<Types...>& Variant<Types...>::operator=(Variant&& source)
+Variant<Types...>& Variant<Types...>::operator=(Variant&& source) noexcept(nothrow_move_assign)
 {
-  if(!source.empty())
+  if constexpr(trivial_copy)
+  {
+    copy_storage(source);
+    return *this;
+  }
+
+  unsigned char d = source.get_discriminator();
+  if(d == 0)
+  {
+    destroy();
+  }
+  else if(d == this->get_discriminator())
   {
-    std::move(source).visit([&](auto&& value) { *this = std::move(value); });
+    ((d == discriminator_of<Types> &&
+      (alternative_at<Types>(this->get_raw_buff()) =
+         std::move(alternative_at<Types>(source.get_raw_buff())),
+       true)) ||
+     ...);
   }
   else
   {
     destroy();
+    ((d == discriminator_of<Types> &&
+      (construct_alternative<Types>(this->get_raw_buff(),
+                                    this->get_storage_allocator(),
+                                    std::move(alternative_at<Types>(source.get_raw_buff()))),
+       true)) ||
+     ...);
+    this->set_discriminator(d);
   }
   return *this;
 }
\ No newline at end of file
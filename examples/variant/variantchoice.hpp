@@ -1,111 +1,51 @@
 #pragma once
-#include "findindexof.hpp"
+#include "../typelist/typelist.hpp"
+#include <cstddef>
 #include <utility>
 
 template <typename... Types>
 class Variant;
 
-template <typename T, typename... Types>
-class VariantChoice
-{
-  using Derived = Variant<Types...>;
-  Derived& get_derived()
-  {
-    return static_cast<Derived&>(*this);
-  }
+template <typename T>
+constexpr bool is_variant = false;
 
-  const Derived& get_derived() const
-  {
-    return static_cast<Derived const&>(*this);
-  }
+template <typename... Types>
+constexpr bool is_variant<Variant<Types...>> = true;
 
-  protected:
-  /*
+/*
+    The per-alternative base of Variant. It used to be VariantChoice<T, Types...>, with the constructor,
+    the assignments and destroy() for T, reaching the variant with a CRTP cast. Every one of those
+    bases and members repeated the whole Types... pack in its mangled name, and every destroy() was
+    instantiated: a Variant of N alternatives cost O(N^2) bytes of symbol names and N functions
+    whether they were used or not.
+    Now a base is keyed by the alternative and its discriminator only, and has no member functions:
+    it declares the two overloads of choose() for T, which are never defined. Variant inherits all of
+    them and asks overload resolution which alternative a value converts to, as the inherited
+    constructors did (decltype(choose(value)) is the VariantChoice of the winner); the single template
+    constructor and assignment of Variant then do the work, and are instantiated only for the types of
+    values actually stored.
     The discriminator value 0 is reserved for cases where the variant contains no value, which is an
     odd state that can only be observed when an exception is thrown during assignment.
-  */
-  constexpr static unsigned discriminator = FindIndexOfT<TypeList<Types...>, T>::value + 1;
-
-  public:
-  VariantChoice() { }
-  VariantChoice(T const& value);
-  VariantChoice(T&& value);
-  Derived& operator=(T const& value);
-  Derived& operator=(T&& value);
-  bool destroy();
-};
-
-// constructor
-template <typename T, typename... Types>
-VariantChoice<T, Types...>::VariantChoice(T const& value)
-{
-  // place value in buffer and set type discriminator:
-  new(get_derived().get_raw_buff()) T(value);
-  get_derived().set_discriminator(discriminator);
-}
-
-template <typename T, typename... Types>
-VariantChoice<T, Types...>::VariantChoice(T&& value)
+*/
+template <typename T, unsigned D>
+struct VariantChoice
 {
-  // place moved value in buffer and set type discriminator:
-  new(get_derived().get_raw_buff()) T(std::move(value));
-  get_derived().set_discriminator(discriminator);
-}
+  using Type = T;
+  static constexpr unsigned discriminator = D;
 
-// destroy
-template <typename T, typename... Types>
-bool VariantChoice<T, Types...>::destroy()
-{
-  if(get_derived().get_discriminator() == discriminator)
-  {
-    // if type matches, call placement delete:
-    get_derived().template get_buff_as<T>()->~T();
-    return true;
-  }
-  return false;
-}
+  static VariantChoice choose(T const&);
+  static VariantChoice choose(T&&);
+};
 
-// assignment
-/*
-    If the destruction of the existing value completes but the initialization of the new value throws an
-    exception, what is the state of the variant? In our implementation, Variant::destroy() resets
-    the discriminator value to 0. In nonexceptional cases, the discriminator will be set appropriately
-    after initialization completes. When an exception occurs during initialization of the new value, the
-    discriminator remains 0 to indicate that the variant does not store a value.
-*/
+template <typename List, typename Indices>
+struct VariantChoices;
 
-template <typename T, typename... Types>
-auto VariantChoice<T, Types...>::operator=(T const& value) -> Derived&
+template <typename... Types, std::size_t... Is>
+struct VariantChoices<TypeList<Types...>, std::index_sequence<Is...>> : VariantChoice<Types, Is + 1>...
 {
-  if(get_derived().get_discriminator() == discriminator)
-  {
-    // assign new value of same type:
-    *get_derived().template get_buff_as<T>() = value;
-  }
-  else
-  {
-    // assign new value of different type:
-    get_derived().destroy(); // try destroy() for all types
-    new(get_derived().get_raw_buff()) T(value); // place new value
-    get_derived().set_discriminator(discriminator);
-  }
-  return get_derived();
-}
+  using VariantChoice<Types, Is + 1>::choose...;
+};
 
-template <typename T, typename... Types>
-auto VariantChoice<T, Types...>::operator=(T&& value) -> Derived&
-{
-  if(get_derived().get_discriminator() == discriminator)
-  {
-    // assign new value of same type:
-    *get_derived().template get_buff_as<T>() = std::move(value);
-  }
-  else
-  {
-    // assign new value of different type:
-    get_derived().destroy(); // try destroy() for all types
-    new(get_derived().get_raw_buff()) T(std::move(value)); // place new value
-    get_derived().set_discriminator(discriminator);
-  }
-  return get_derived();
-}
\ No newline at end of file
+// the alternative that a value of type U is stored as, if any
+template <typename Choices, typename U>
+using ChosenAlternative = decltype(Choices::choose(std::declval<U>()));
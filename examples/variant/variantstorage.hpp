@@ -1,19 +1,115 @@
 #pragma once
 #include "../typelist/genericlargesttype.hpp"
 #include "../typelist/typelist.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+    A variant has no allocator parameter of its own, so it follows the std::pmr containers: when at
+    least one alternative takes a std::pmr::polymorphic_allocator (a std::pmr::string, a Tuple holding
+    one...), the storage keeps the allocator it was constructed with and builds every value it ever
+    holds with it, assignments of a different alternative included. Otherwise there is nothing to
+    keep, and NoVariantAllocator takes no space.
+*/
+template <typename... Types>
+constexpr bool variant_uses_resource =
+  (std::uses_allocator_v<Types, std::pmr::polymorphic_allocator<>> || ...);
+
+struct NoVariantAllocator
+{ };
+
+/*
+    The operations on one alternative, as functions named after the alternative (and the allocator)
+    alone: Variant instantiates one of each per alternative, and a name repeating all the alternatives
+    would make that O(N^2) bytes of symbols.
+*/
+template <typename T>
+T& alternative_at(void* buffer)
+{
+  return *std::launder(static_cast<T*>(buffer));
+}
+
+template <typename T>
+T const& alternative_at(void const* buffer)
+{
+  return *std::launder(static_cast<T const*>(buffer));
+}
+
+// constructs a T in buffer, passing the allocator down when there is one
+template <typename T, typename Allocator, typename... Args>
+void construct_alternative(void* buffer, Allocator const& alloc, Args&&... args)
+{
+  if constexpr(std::is_same_v<Allocator, NoVariantAllocator>)
+  {
+    new(buffer) T(std::forward<Args>(args)...);
+  }
+  else
+  {
+    std::uninitialized_construct_using_allocator(
+      static_cast<T*>(buffer), alloc, std::forward<Args>(args)...);
+  }
+}
 
 template <typename... Types>
 class VariantStorage
 {
   using LargestT = LargestType<TypeList<Types...>>;
+  using Allocator = std::conditional_t<variant_uses_resource<Types...>,
+                                       std::pmr::polymorphic_allocator<>,
+                                       NoVariantAllocator>;
+  /*
+    The discriminator takes all of the padding that the alignment of the buffer leaves after it, up to
+    8 bytes, so it costs no space. What it buys is that the second word of a small variant, such as
+    the one a Result<long, Errc> is returned in, is written with a single store: a one-byte
+    discriminator gets stored alone and then reloaded as part of a wider word, which stalls store
+    forwarding.
+  */
+  static constexpr std::size_t buffer_align = std::max({alignof(Types)...});
+  static constexpr std::size_t padding = sizeof(LargestT) % buffer_align == 0 ? buffer_align : 1;
+  using Discriminator = std::conditional_t<
+    padding >= 8,
+    std::uint64_t,
+    std::conditional_t<padding >= 4,
+                       std::uint32_t,
+                       std::conditional_t<padding >= 2, std::uint16_t, std::uint8_t>>>;
+
   alignas(Types...) unsigned char buffer[sizeof(LargestT)];
-  unsigned char discriminator = 0;
+  Discriminator discriminator = 0;
+  [[no_unique_address]] Allocator alloc;
 
   public:
+  VariantStorage() = default;
+
+  explicit VariantStorage(Allocator const& alloc)
+    : alloc(alloc)
+  { }
+
+  Allocator const& get_storage_allocator() const
+  {
+    return alloc;
+  }
+
+  // whether construct<T>(args...) cannot throw: building with an allocator may always allocate
+  template <typename T, typename... Args>
+  static constexpr bool nothrow_constructible =
+    !std::uses_allocator_v<T, Allocator> && std::is_nothrow_constructible_v<T, Args...>;
+
+  // constructs a T in the buffer, passing the allocator down when there is one
+  template <typename T, typename... Args>
+  void construct(Args&&... args) noexcept(nothrow_constructible<T, Args&&...>)
+  {
+    construct_alternative<T>(buffer, alloc, std::forward<Args>(args)...);
+  }
+
   unsigned char get_discriminator() const
   {
-    return discriminator;
+    return static_cast<unsigned char>(discriminator);
   }
 
   void set_discriminator(unsigned char d)
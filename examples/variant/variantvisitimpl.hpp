@@ -3,6 +3,8 @@
 #include "../typelist/typelist.hpp"
 #include "commontype.hpp"
 #include "emptyvariant.hpp"
+#include "variantstorage.hpp"
+#include <type_traits>
 
 /*
     When calling a visitor that may produce different types for each of the variant’s element types, how
@@ -71,6 +73,18 @@ R variant_visit_impl(V&& variant, Visitor&& vis, TypeList<Head, Tail...>)
   }
   else
   {
-    throw EmptyVariant();
+    throw_empty_variant();
   }
-}
\ No newline at end of file
+}
+
+/*
+    A visitor called on the alternative stored in buffer, as Q (T&, T const& or T&&). The name of the
+    function mentions the alternative and the visitor but not the variant, so a table of them for a
+    variant of N alternatives costs O(N) bytes of symbol names, not O(N^2) as the recursion above does.
+*/
+template <typename R, typename Q, typename Visitor>
+R visit_alternative(void* buffer, Visitor&& vis)
+{
+  return static_cast<R>(
+    std::forward<Visitor>(vis)(static_cast<Q>(alternative_at<std::remove_reference_t<Q>>(buffer))));
+}
@@ -0,0 +1,174 @@
+#pragma once
+#include "emptyvariant.hpp"
+#include <cassert>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+/*
+    The result of Variant::try_visit(): either what the visitor returned, or the error that the variant
+    was empty, in the style of C++23's std::expected<R, EmptyVariant>. Nothing is thrown either way:
+    value() on an error is a precondition violation, checked by an assert, as operator* is for
+    std::expected.
+    A visitor returning a reference gives a VisitExpected holding a pointer, so that try_visit() can
+    hand out references into the variant as visit() does; VisitExpected<void> only says whether the
+    visitor ran.
+*/
+template <typename R>
+class VisitExpected
+{
+  static_assert(!std::is_rvalue_reference_v<R>, "a VisitExpected holds an rvalue result by value");
+  static constexpr bool by_reference = std::is_reference_v<R>;
+  using Stored = std::conditional_t<by_reference, std::remove_reference_t<R>*, R>;
+  std::optional<Stored> result;
+
+  public:
+  using value_type = R;
+  using error_type = EmptyVariant;
+
+  // the error
+  VisitExpected() = default;
+
+  // the value returned by f(), constructed in place
+  template <typename F>
+  VisitExpected(std::in_place_t, F&& f)
+  {
+    if constexpr(by_reference)
+    {
+      result.emplace(std::addressof(static_cast<std::remove_reference_t<R>&>(f())));
+    }
+    else
+    {
+      result.emplace(f());
+    }
+  }
+
+  bool has_value() const noexcept
+  {
+    return result.has_value();
+  }
+
+  explicit operator bool() const noexcept
+  {
+    return has_value();
+  }
+
+  decltype(auto) value() & noexcept
+  {
+    assert(has_value());
+    if constexpr(by_reference)
+    {
+      return static_cast<R>(**result);
+    }
+    else
+    {
+      return static_cast<R&>(*result);
+    }
+  }
+
+  decltype(auto) value() const& noexcept
+  {
+    assert(has_value());
+    if constexpr(by_reference)
+    {
+      return static_cast<R>(**result);
+    }
+    else
+    {
+      return static_cast<R const&>(*result);
+    }
+  }
+
+  decltype(auto) value() && noexcept
+  {
+    assert(has_value());
+    if constexpr(by_reference)
+    {
+      return static_cast<R>(**result);
+    }
+    else
+    {
+      return static_cast<R&&>(*result);
+    }
+  }
+
+  decltype(auto) operator*() & noexcept
+  {
+    return value();
+  }
+
+  decltype(auto) operator*() const& noexcept
+  {
+    return value();
+  }
+
+  decltype(auto) operator*() && noexcept
+  {
+    return std::move(*this).value();
+  }
+
+  auto operator->() noexcept
+  {
+    return std::addressof(value());
+  }
+
+  auto operator->() const noexcept
+  {
+    return std::addressof(value());
+  }
+
+  template <typename U>
+  std::remove_cvref_t<R> value_or(U&& fallback) const&
+  {
+    return has_value() ? std::remove_cvref_t<R>(value()) : std::remove_cvref_t<R>(std::forward<U>(fallback));
+  }
+
+  EmptyVariant error() const noexcept
+  {
+    assert(!has_value());
+    return EmptyVariant();
+  }
+};
+
+template <>
+class VisitExpected<void>
+{
+  bool ran = false;
+
+  public:
+  using value_type = void;
+  using error_type = EmptyVariant;
+
+  VisitExpected() = default;
+
+  explicit VisitExpected(std::in_place_t) noexcept
+    : ran(true)
+  { }
+
+  bool has_value() const noexcept
+  {
+    return ran;
+  }
+
+  explicit operator bool() const noexcept
+  {
+    return ran;
+  }
+
+  void value() const noexcept
+  {
+    assert(ran);
+  }
+
+  EmptyVariant error() const noexcept
+  {
+    assert(!ran);
+    return EmptyVariant();
+  }
+};
+
+// what try_visit() returns: a computed result type T&& (see VisitResult) is held as a T
+template <typename R>
+using VisitExpectedFor =
+  VisitExpected<std::conditional_t<std::is_rvalue_reference_v<R>, std::remove_cvref_t<R>, R>>;
@@ -0,0 +1,148 @@
+#include "../variant/variant.hpp"
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+#if __has_include(<elf.h>)
+#include <elf.h>
+#endif
+
+/*
+    Measures what a Variant with many alternatives leaves in the symbol table: the same code is
+    instantiated for a Variant of 25 alternatives (Small<0>...Small<24>) and one of 100 (Large<0>...
+    Large<99>), and the symbols of this executable mentioning each family are counted. Built without
+    optimization, as a debug build is, so that nothing is hidden by inlining.
+    With the per-alternative bases naming every alternative, 4 times the alternatives took about 12
+    times the symbol bytes. What still grows faster than linearly is the constructors, one per
+    alternative stored, each named after the whole variant; copies, assignments, destruction and
+    visits add a symbol per alternative that names that alternative only.
+*/
+
+template <unsigned I>
+struct Small
+{
+  std::string text;
+};
+
+template <unsigned I>
+struct Large
+{
+  std::string text;
+};
+
+template <template <unsigned> class Alternative, typename Indices>
+struct AlternativesT;
+
+template <template <unsigned> class Alternative, std::size_t... Is>
+struct AlternativesT<Alternative, std::index_sequence<Is...>>
+{
+  using Type = Variant<Alternative<Is>...>;
+};
+
+template <template <unsigned> class Alternative, std::size_t N>
+using Alternatives = typename AlternativesT<Alternative, std::make_index_sequence<N>>::Type;
+
+// what a program typically does with a variant: store each alternative, copy, assign, visit
+template <template <unsigned> class Alternative, std::size_t... Is>
+std::size_t exercise(std::index_sequence<Is...>)
+{
+  using V = Variant<Alternative<Is>...>;
+  std::vector<V> values;
+  (values.push_back(V(Alternative<Is>{std::to_string(Is)})), ...);
+  std::vector<V> copies = values;
+  for(std::size_t i = 0; i + 1 < copies.size(); ++i)
+  {
+    copies[i] = copies[i + 1];
+  }
+  std::size_t length = 0;
+  for(V const& v : copies)
+  {
+    length +=
+      v.template visit<std::size_t>([](auto const& alternative) { return alternative.text.size(); });
+  }
+  return length;
+}
+
+struct SymbolStats
+{
+  std::size_t symbols = 0;
+  std::size_t name_bytes = 0;
+  std::size_t code_bytes = 0;
+};
+
+// the symbols of this executable whose mangled name contains tag
+SymbolStats symbol_stats(char const* tag)
+{
+  SymbolStats stats;
+#if __has_include(<elf.h>)
+  std::ifstream in("/proc/self/exe", std::ios::binary);
+  std::vector<char> image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if(image.size() < sizeof(Elf64_Ehdr))
+  {
+    return stats;
+  }
+  Elf64_Ehdr header;
+  std::memcpy(&header, image.data(), sizeof(header));
+  std::vector<Elf64_Shdr> sections(header.e_shnum);
+  std::memcpy(sections.data(), image.data() + header.e_shoff, header.e_shnum * sizeof(Elf64_Shdr));
+  for(Elf64_Shdr const& s : sections)
+  {
+    if(s.sh_type != SHT_SYMTAB)
+    {
+      continue;
+    }
+    char const* names = image.data() + sections[s.sh_link].sh_offset;
+    for(std::size_t i = 0; i < s.sh_size / sizeof(Elf64_Sym); ++i)
+    {
+      Elf64_Sym symbol;
+      std::memcpy(&symbol, image.data() + s.sh_offset + i * sizeof(Elf64_Sym), sizeof(symbol));
+      char const* name = names + symbol.st_name;
+      if(std::strstr(name, tag) != nullptr)
+      {
+        ++stats.symbols;
+        stats.name_bytes += std::strlen(name);
+        if(ELF64_ST_TYPE(symbol.st_info) == STT_FUNC)
+        {
+          stats.code_bytes += symbol.st_size;
+        }
+      }
+    }
+  }
+#endif
+  return stats;
+}
+
+void print(char const* name, std::size_t alternatives, SymbolStats const& stats)
+{
+  std::cout << "  " << name << " (" << alternatives << " alternatives): " << stats.symbols
+            << " symbols, " << stats.name_bytes << " B of names, " << stats.code_bytes
+            << " B of code; per alternative " << stats.name_bytes / alternatives << " B of names"
+            << std::endl;
+}
+
+int main()
+{
+  static_assert(sizeof(Alternatives<Small, 25>) == sizeof(Alternatives<Large, 100>));
+
+  std::size_t length = exercise<Small>(std::make_index_sequence<25>()) +
+                       exercise<Large>(std::make_index_sequence<100>());
+  std::cout << "visited " << length << " characters" << std::endl;
+
+  SymbolStats small = symbol_stats("5SmallIL");
+  SymbolStats large = symbol_stats("5LargeIL");
+  if(small.symbols == 0)
+  {
+    std::cout << "no symbol table (stripped executable?)" << std::endl;
+    return 0;
+  }
+  std::cout << "symbols mentioning the alternatives:" << std::endl;
+  print("Small", 25, small);
+  print("Large", 100, large);
+  std::cout << "4 times the alternatives, " << double(large.name_bytes) / double(small.name_bytes)
+            << " times the symbol bytes" << std::endl;
+  return 0;
+}
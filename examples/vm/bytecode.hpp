@@ -0,0 +1,147 @@
+#pragma once
+#include "../typelist/nthelement.hpp"
+#include "../typelist/typelist.hpp"
+#include "../variant/findindexof.hpp"
+#include "value.hpp"
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+/*
+    The instruction set of the formula VM, a closed TypeList of opcode types. The opcode of an
+    instruction is the index of its type in the list, and the VM generates one handler per index (see
+    vm.hpp), so adding an instruction is adding a type here and an execute() overload there.
+    Every instruction has the same 5-byte register form: dst, a, b and c name registers, except for
+    LoadColumn and LoadConst, whose a is a column or constant index, and Return, which returns a. So a
+    program has at most 256 registers, constants and columns.
+*/
+struct LoadColumn
+{ };
+
+struct LoadConst
+{ };
+
+struct Add
+{
+  static Value apply(Value const& a, Value const& b)
+  {
+    return add(a, b);
+  }
+};
+
+struct Subtract
+{
+  static Value apply(Value const& a, Value const& b)
+  {
+    return subtract(a, b);
+  }
+};
+
+struct Multiply
+{
+  static Value apply(Value const& a, Value const& b)
+  {
+    return multiply(a, b);
+  }
+};
+
+struct Divide
+{
+  static Value apply(Value const& a, Value const& b)
+  {
+    return divide(a, b);
+  }
+};
+
+struct Less
+{
+  static Value apply(Value const& a, Value const& b)
+  {
+    return less(a, b);
+  }
+};
+
+struct Equal
+{
+  static Value apply(Value const& a, Value const& b)
+  {
+    return equal(a, b);
+  }
+};
+
+struct Concat
+{
+  static Value apply(Value const& a, Value const& b)
+  {
+    return concat(a, b);
+  }
+};
+
+// dst = a ? b : c
+struct Select
+{ };
+
+struct Return
+{ };
+
+// the opcodes computing dst from a and b with apply()
+template <typename Op>
+concept BinaryOpcode = requires(Value const& v) { Op::apply(v, v); };
+
+using Opcodes =
+  TypeList<LoadColumn, LoadConst, Add, Subtract, Multiply, Divide, Less, Equal, Concat, Select, Return>;
+
+template <typename List>
+struct OpcodeCount;
+
+template <typename... Ops>
+struct OpcodeCount<TypeList<Ops...>>
+{
+  static constexpr unsigned value = sizeof...(Ops);
+};
+
+constexpr unsigned opcode_count = OpcodeCount<Opcodes>::value;
+
+template <typename Op>
+constexpr std::uint8_t opcode = FindIndexOfT<Opcodes, Op>::value;
+
+template <unsigned I>
+using Opcode = NthElement<Opcodes, I>;
+
+struct Instruction
+{
+  std::uint8_t op;
+  std::uint8_t dst;
+  std::uint8_t a;
+  std::uint8_t b = 0;
+  std::uint8_t c = 0;
+};
+
+struct Program
+{
+  std::vector<Instruction> code;
+  std::vector<Value> constants;
+  unsigned registers = 0;
+
+  // appends an instruction writing a fresh register, and returns that register
+  template <typename Op>
+  std::uint8_t emit(std::uint8_t a, std::uint8_t b = 0, std::uint8_t c = 0)
+  {
+    assert(registers < 256);
+    auto dst = std::uint8_t(registers++);
+    code.push_back({opcode<Op>, dst, a, b, c});
+    return dst;
+  }
+
+  std::uint8_t constant(Value v)
+  {
+    assert(constants.size() < 256);
+    constants.push_back(v);
+    return std::uint8_t(constants.size() - 1);
+  }
+
+  void finish(std::uint8_t result)
+  {
+    code.push_back({opcode<Return>, 0, result});
+  }
+};
@@ -0,0 +1,114 @@
+#include "../bench/bench.hpp"
+#include "../tuple/tuple.hpp"
+#include "bytecode.hpp"
+#include "treewalker.hpp"
+#include "value.hpp"
+#include "vm.hpp"
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// an order line: price, quantity, currency, discount
+using Row = Tuple<double, std::int64_t, Text, double>;
+using F = Formula<Row>;
+
+std::ostream& operator<<(std::ostream& os, Value const& v)
+{
+  v.visit<void>([&](auto const& x) { os << x; });
+  return os;
+}
+
+std::vector<Row> make_rows(std::size_t n)
+{
+  char const* currencies[] = {"EUR", "USD", "GBP", "CHF"};
+  std::mt19937_64 rng(42);
+  std::vector<Row> rows;
+  rows.reserve(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    rows.push_back(Row(double(rng() % 10'000) / 100, std::int64_t(rng() % 20 + 1),
+                       Text(currencies[rng() % 4]), double(rng() % 30) / 100));
+  }
+  return rows;
+}
+
+// a checksum of the results, so that the interpreters can be compared
+double checksum(std::vector<Value> const& values)
+{
+  double sum = 0;
+  for(Value const& v : values)
+  {
+    sum += v.is<Text>() ? double(v.get<Text>().size()) : to_number(v);
+  }
+  return sum;
+}
+
+void bench(char const* name, F const& formula, std::vector<Row> const& rows)
+{
+  Program program = formula.compile();
+  std::vector<Value> out(rows.size());
+  FormulaVM<Row> vm(program);
+  BatchFormulaVM<Row> batch(program);
+
+  auto row_rate = [&](auto&& eval) {
+    double ms = time_ms([&] {
+      for(std::size_t i = 0; i < rows.size(); ++i)
+      {
+        out[i] = eval(rows[i]);
+      }
+      do_not_optimize(out.data());
+    });
+    return double(rows.size()) / ms / 1e3;
+  };
+  double tree = row_rate([&](Row const& row) { return formula.eval(row); });
+  double tree_sum = checksum(out);
+  double switched = row_rate([&](Row const& row) { return vm.run_switch(row); });
+  double switched_sum = checksum(out);
+  double threaded = row_rate([&](Row const& row) { return vm.run(row); });
+  double threaded_sum = checksum(out);
+  double batched_ms = time_ms([&] {
+    batch.run(rows.data(), rows.size(), out.data());
+    do_not_optimize(out.data());
+  });
+  double batched = double(rows.size()) / batched_ms / 1e3;
+  bool same = tree_sum == switched_sum && tree_sum == threaded_sum && tree_sum == checksum(out);
+
+  std::cout << "  " << name << " (" << program.code.size() << " instructions), million rows/s: tree "
+            << tree << ", switch " << switched << ", threaded " << threaded << ", batch " << batched
+            << (same ? "" : " (RESULTS DIFFER)") << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  F price = F::column(0);
+  F quantity = F::column(1);
+  F currency = F::column(2);
+  F discount = F::column(3);
+
+  // net amount, with shipping for small orders
+  F total = price * quantity * (1.0 - discount) + F::select(quantity < 5, 4.99, 0);
+  // converted to euros
+  F euros = F::select(currency == "EUR", total, F::select(currency == "USD", total * 0.92, total * 1.15));
+  // a label such as "12xEUR"
+  F label = F::concat(F::concat(quantity, "x"), currency);
+  // integer arithmetic only: no division, which always gives a double
+  F units = quantity * 12 - quantity + 1;
+
+  Row row(19.99, 3, Text("USD"), 0.1);
+  Program euros_program = euros.compile();
+  FormulaVM<Row> vm(euros_program);
+  std::cout << "euros: tree " << euros.eval(row) << ", vm " << vm.run(row) << std::endl;
+  Program label_program = label.compile();
+  std::cout << "label: " << FormulaVM<Row>(label_program).run_switch(row) << std::endl;
+  std::cout << "units: " << units.eval(row) << std::endl;
+
+  std::size_t n = size_arg(argc, argv, 1'000'000);
+  std::vector<Row> rows = make_rows(n);
+  std::cout << n << " rows:" << std::endl;
+  bench("total", total, rows);
+  bench("euros", euros, rows);
+  bench("label", label, rows);
+  bench("units", units, rows);
+  return 0;
+}
@@ -0,0 +1,245 @@
+#pragma once
+#include "bytecode.hpp"
+#include "value.hpp"
+#include "vm.hpp"
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+/*
+    Formulas as expression trees, the classic way of interpreting them: each node is an object with a
+    virtual eval(), and evaluating a formula is a recursive walk with one virtual call per node per
+    row. This is the baseline the bytecode VMs are measured against; the same tree also compiles itself
+    to a Program, one register per node, in post-order.
+    A formula reusing a subformula shares its node, so the tree is really a DAG. The walk evaluates a
+    shared node once per use, while the Compiler emits its code once and reuses its register.
+*/
+template <typename Row>
+class Compiler;
+
+template <typename Row>
+class Node
+{
+  public:
+  virtual ~Node() = default;
+  virtual Value eval(Row const& row) const = 0;
+  // the code computing the node, given the registers of its operands
+  virtual std::uint8_t emit(Compiler<Row>& compiler) const = 0;
+};
+
+template <typename Row>
+class Compiler
+{
+  std::unordered_map<Node<Row> const*, std::uint8_t> compiled;
+
+  public:
+  Program program;
+
+  std::uint8_t compile(Node<Row> const& node)
+  {
+    auto found = compiled.find(&node);
+    if(found != compiled.end())
+    {
+      return found->second;
+    }
+    std::uint8_t r = node.emit(*this);
+    compiled.emplace(&node, r);
+    return r;
+  }
+};
+
+template <typename Row>
+class ColumnNode : public Node<Row>
+{
+  std::uint8_t column;
+
+  public:
+  explicit ColumnNode(std::uint8_t column)
+    : column(column)
+  { }
+
+  Value eval(Row const& row) const override
+  {
+    return Columns<Row>::load_table[column](row);
+  }
+
+  std::uint8_t emit(Compiler<Row>& compiler) const override
+  {
+    return compiler.program.template emit<LoadColumn>(column);
+  }
+};
+
+template <typename Row>
+class ConstantNode : public Node<Row>
+{
+  Value value;
+
+  public:
+  explicit ConstantNode(Value value)
+    : value(value)
+  { }
+
+  Value eval(Row const&) const override
+  {
+    return value;
+  }
+
+  std::uint8_t emit(Compiler<Row>& compiler) const override
+  {
+    Program& program = compiler.program;
+    return program.template emit<LoadConst>(program.constant(value));
+  }
+};
+
+template <typename Row, BinaryOpcode Op>
+class BinaryNode : public Node<Row>
+{
+  std::shared_ptr<Node<Row> const> lhs;
+  std::shared_ptr<Node<Row> const> rhs;
+
+  public:
+  BinaryNode(std::shared_ptr<Node<Row> const> lhs, std::shared_ptr<Node<Row> const> rhs)
+    : lhs(std::move(lhs))
+    , rhs(std::move(rhs))
+  { }
+
+  Value eval(Row const& row) const override
+  {
+    return Op::apply(lhs->eval(row), rhs->eval(row));
+  }
+
+  std::uint8_t emit(Compiler<Row>& compiler) const override
+  {
+    std::uint8_t a = compiler.compile(*lhs);
+    std::uint8_t b = compiler.compile(*rhs);
+    return compiler.program.template emit<Op>(a, b);
+  }
+};
+
+// both branches are evaluated, as in the VM, which has no jumps
+template <typename Row>
+class SelectNode : public Node<Row>
+{
+  std::shared_ptr<Node<Row> const> condition;
+  std::shared_ptr<Node<Row> const> then;
+  std::shared_ptr<Node<Row> const> otherwise;
+
+  public:
+  SelectNode(std::shared_ptr<Node<Row> const> condition, std::shared_ptr<Node<Row> const> then,
+             std::shared_ptr<Node<Row> const> otherwise)
+    : condition(std::move(condition))
+    , then(std::move(then))
+    , otherwise(std::move(otherwise))
+  { }
+
+  Value eval(Row const& row) const override
+  {
+    Value c = condition->eval(row);
+    Value t = then->eval(row);
+    Value o = otherwise->eval(row);
+    return truthy(c) ? t : o;
+  }
+
+  std::uint8_t emit(Compiler<Row>& compiler) const override
+  {
+    std::uint8_t a = compiler.compile(*condition);
+    std::uint8_t b = compiler.compile(*then);
+    std::uint8_t c = compiler.compile(*otherwise);
+    return compiler.program.template emit<Select>(a, b, c);
+  }
+};
+
+/*
+    A handle on a tree with the operators of the language, so that formulas are written as
+    expressions: Formula<Row>::column(0) * Formula<Row>::column(1) + 1, with literals converted to
+    constants.
+*/
+template <typename Row>
+class Formula
+{
+  std::shared_ptr<Node<Row> const> node;
+
+  explicit Formula(std::shared_ptr<Node<Row> const> node)
+    : node(std::move(node))
+  { }
+
+  template <typename Op>
+  static Formula binary(Formula const& lhs, Formula const& rhs)
+  {
+    return Formula(std::make_shared<BinaryNode<Row, Op>>(lhs.node, rhs.node));
+  }
+
+  public:
+  // literals: integers, doubles and strings
+  template <std::integral T>
+  Formula(T value)
+    : Formula(std::make_shared<ConstantNode<Row>>(Value(std::int64_t(value))))
+  { }
+
+  Formula(double value)
+    : Formula(std::make_shared<ConstantNode<Row>>(Value(value)))
+  { }
+
+  Formula(char const* value)
+    : Formula(std::make_shared<ConstantNode<Row>>(Value(Text(value))))
+  { }
+
+  static Formula column(std::uint8_t index)
+  {
+    return Formula(std::make_shared<ColumnNode<Row>>(index));
+  }
+
+  static Formula select(Formula const& condition, Formula const& then, Formula const& otherwise)
+  {
+    return Formula(std::make_shared<SelectNode<Row>>(condition.node, then.node, otherwise.node));
+  }
+
+  static Formula concat(Formula const& lhs, Formula const& rhs)
+  {
+    return binary<Concat>(lhs, rhs);
+  }
+
+  Value eval(Row const& row) const
+  {
+    return node->eval(row);
+  }
+
+  Program compile() const
+  {
+    Compiler<Row> compiler;
+    compiler.program.finish(compiler.compile(*node));
+    return std::move(compiler.program);
+  }
+
+  friend Formula operator+(Formula const& lhs, Formula const& rhs)
+  {
+    return binary<Add>(lhs, rhs);
+  }
+
+  friend Formula operator-(Formula const& lhs, Formula const& rhs)
+  {
+    return binary<Subtract>(lhs, rhs);
+  }
+
+  friend Formula operator*(Formula const& lhs, Formula const& rhs)
+  {
+    return binary<Multiply>(lhs, rhs);
+  }
+
+  friend Formula operator/(Formula const& lhs, Formula const& rhs)
+  {
+    return binary<Divide>(lhs, rhs);
+  }
+
+  friend Formula operator<(Formula const& lhs, Formula const& rhs)
+  {
+    return binary<Less>(lhs, rhs);
+  }
+
+  friend Formula operator==(Formula const& lhs, Formula const& rhs)
+  {
+    return binary<Equal>(lhs, rhs);
+  }
+};
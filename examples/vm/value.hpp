@@ -0,0 +1,136 @@
+#pragma once
+#include "../inlinestring/inlinestring.hpp"
+#include "../variant/variant.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+/*
+    The values of the formula language: 64-bit integers, doubles and short strings. All three
+    alternatives are trivially copyable (the strings are InlineStrings), so a Value is copied with a
+    plain memcpy and a register file of Values never allocates.
+    The operations follow the usual spreadsheet rules: integers stay integers until they overflow,
+    mixing an integer and a double gives a double, and arithmetic on a string gives NaN rather than an
+    error. They are shared by the bytecode VM and the tree walker, so that both compute the same thing.
+*/
+using Text = InlineString<15>;
+using Value = Variant<std::int64_t, double, Text>;
+
+inline double to_number(Value const& v)
+{
+  if(v.is<double>())
+  {
+    return v.get<double>();
+  }
+  if(v.is<std::int64_t>())
+  {
+    return double(v.get<std::int64_t>());
+  }
+  return std::numeric_limits<double>::quiet_NaN();
+}
+
+inline bool truthy(Value const& v)
+{
+  if(v.is<std::int64_t>())
+  {
+    return v.get<std::int64_t>() != 0;
+  }
+  if(v.is<double>())
+  {
+    return v.get<double>() != 0;
+  }
+  return !v.get<Text>().empty();
+}
+
+inline Value add(Value const& a, Value const& b)
+{
+  std::int64_t r;
+  if(a.is<std::int64_t>() && b.is<std::int64_t>() &&
+     !__builtin_add_overflow(a.get<std::int64_t>(), b.get<std::int64_t>(), &r))
+  {
+    return r;
+  }
+  return to_number(a) + to_number(b);
+}
+
+inline Value subtract(Value const& a, Value const& b)
+{
+  std::int64_t r;
+  if(a.is<std::int64_t>() && b.is<std::int64_t>() &&
+     !__builtin_sub_overflow(a.get<std::int64_t>(), b.get<std::int64_t>(), &r))
+  {
+    return r;
+  }
+  return to_number(a) - to_number(b);
+}
+
+inline Value multiply(Value const& a, Value const& b)
+{
+  std::int64_t r;
+  if(a.is<std::int64_t>() && b.is<std::int64_t>() &&
+     !__builtin_mul_overflow(a.get<std::int64_t>(), b.get<std::int64_t>(), &r))
+  {
+    return r;
+  }
+  return to_number(a) * to_number(b);
+}
+
+// always a double, as 7 / 2 is 3.5 in a spreadsheet
+inline Value divide(Value const& a, Value const& b)
+{
+  return to_number(a) / to_number(b);
+}
+
+// 1 or 0; strings compare with strings, numbers with numbers, and a string with a number is false
+inline Value less(Value const& a, Value const& b)
+{
+  if(a.is<Text>() || b.is<Text>())
+  {
+    return std::int64_t(a.is<Text>() && b.is<Text>() && a.get<Text>() < b.get<Text>());
+  }
+  if(a.is<std::int64_t>() && b.is<std::int64_t>())
+  {
+    return std::int64_t(a.get<std::int64_t>() < b.get<std::int64_t>());
+  }
+  return std::int64_t(to_number(a) < to_number(b));
+}
+
+inline Value equal(Value const& a, Value const& b)
+{
+  if(a.is<Text>() || b.is<Text>())
+  {
+    return std::int64_t(a.is<Text>() && b.is<Text>() && a.get<Text>() == b.get<Text>());
+  }
+  if(a.is<std::int64_t>() && b.is<std::int64_t>())
+  {
+    return std::int64_t(a.get<std::int64_t>() == b.get<std::int64_t>());
+  }
+  return std::int64_t(to_number(a) == to_number(b));
+}
+
+// appends the text of v to buffer, up to its end
+inline char* append_text(Value const& v, char* out, char* end)
+{
+  if(v.is<Text>())
+  {
+    std::string_view s = v.get<Text>().view();
+    std::size_t n = std::min<std::size_t>(s.size(), std::size_t(end - out));
+    return std::copy_n(s.data(), n, out);
+  }
+  char digits[32];
+  std::to_chars_result r = v.is<std::int64_t>() ? std::to_chars(digits, digits + 32, v.get<std::int64_t>())
+                                                 : std::to_chars(digits, digits + 32, v.get<double>());
+  std::size_t n = std::min<std::size_t>(std::size_t(r.ptr - digits), std::size_t(end - out));
+  return std::copy_n(digits, n, out);
+}
+
+// the texts of a and b one after the other, cut to the capacity of a Text
+inline Value concat(Value const& a, Value const& b)
+{
+  char buffer[Text::capacity()];
+  char* end = buffer + Text::capacity();
+  char* out = append_text(b, append_text(a, buffer, end), end);
+  return Text(std::string_view(buffer, std::size_t(out - buffer)));
+}
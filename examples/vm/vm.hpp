@@ -0,0 +1,328 @@
+#pragma once
+#include "../tuple/makeindexlist.hpp"
+#include "../tuple/tuple.hpp"
+#include "bytecode.hpp"
+#include "value.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/*
+    Reads the columns of Tuple rows as Values: integers become int64_t, floating point numbers double,
+    and anything else a Text. load_table[i] loads column i of one row, gather_table[i] column i of a
+    whole batch of rows, in a loop with the column index known at compile time.
+*/
+template <typename T>
+Value to_value(T const& x)
+{
+  if constexpr(std::is_integral_v<T>)
+  {
+    return std::int64_t(x);
+  }
+  else if constexpr(std::is_floating_point_v<T>)
+  {
+    return double(x);
+  }
+  else if constexpr(std::is_same_v<T, Text>)
+  {
+    return x;
+  }
+  else
+  {
+    return Text(std::string_view(x));
+  }
+}
+
+template <typename Row>
+struct Columns;
+
+template <typename... Cols>
+struct Columns<Tuple<Cols...>>
+{
+  using Row = Tuple<Cols...>;
+  using Load = Value (*)(Row const&);
+  using Gather = void (*)(Row const*, std::size_t, Value*);
+
+  template <unsigned I>
+  static Value load(Row const& row)
+  {
+    return to_value(get<I>(row));
+  }
+
+  template <unsigned I>
+  static void gather(Row const* rows, std::size_t n, Value* out)
+  {
+    for(std::size_t k = 0; k < n; ++k)
+    {
+      out[k] = to_value(get<I>(rows[k]));
+    }
+  }
+
+  template <unsigned... I>
+  static constexpr std::array<Load, sizeof...(I)> make_loads(ValueList<unsigned, I...>)
+  {
+    return {&load<I>...};
+  }
+
+  template <unsigned... I>
+  static constexpr std::array<Gather, sizeof...(I)> make_gathers(ValueList<unsigned, I...>)
+  {
+    return {&gather<I>...};
+  }
+
+  static constexpr std::array<Load, sizeof...(Cols)> load_table =
+    make_loads(MakeIndexList<sizeof...(Cols)>());
+  static constexpr std::array<Gather, sizeof...(Cols)> gather_table =
+    make_gathers(MakeIndexList<sizeof...(Cols)>());
+};
+
+/*
+    The handlers of both VMs are generated from the opcode list: one per index up to 16, of which
+    those past the end of the list are never reached. X(I) is expanded for every index.
+*/
+#define FORMULA_VM_OPCODES(X)                                                                      \
+  X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15)
+
+static_assert(opcode_count <= 16, "FORMULA_VM_OPCODES needs more handlers");
+
+/*
+    A register is written by one instruction only (Program::emit() takes a fresh one each time), so a
+    LoadConst gives its register the same value for every row. The VMs load the constants once, with
+    load(), and run the rest of the code, which is copied to code.
+*/
+template <typename Load>
+void hoist_constants(Program const& program, std::vector<Instruction>& code, Load load)
+{
+  for(Instruction const& in : program.code)
+  {
+    if(in.op == opcode<LoadConst>)
+    {
+      load(in);
+    }
+    else
+    {
+      code.push_back(in);
+    }
+  }
+}
+
+/*
+    Evaluates a program on one row at a time. The register file is allocated once, in the
+    constructor, with the constants already loaded, and reused for every row.
+    run_switch() dispatches with a switch in a loop: every instruction goes back to the same indirect
+    jump, whose target the branch predictor can only guess from the previous one. run_threaded()
+    uses the labels-as-values extension of GCC and Clang for threaded code: each handler ends with its
+    own indirect jump to the next handler, so each gets its own prediction history, and the loop
+    back-edge and the bounds check of the switch are gone. run() uses threaded code where the compiler
+    supports it, or the switch.
+*/
+template <typename Row>
+class FormulaVM
+{
+  Program const& program;
+  std::vector<Instruction> code;
+  std::vector<Value> registers;
+
+  void execute(LoadColumn, Instruction const& in, Value* r, Row const& row) const
+  {
+    r[in.dst] = Columns<Row>::load_table[in.a](row);
+  }
+
+  void execute(LoadConst, Instruction const& in, Value* r, Row const&) const
+  {
+    r[in.dst] = program.constants[in.a];
+  }
+
+  template <BinaryOpcode Op>
+  void execute(Op, Instruction const& in, Value* r, Row const&) const
+  {
+    r[in.dst] = Op::apply(r[in.a], r[in.b]);
+  }
+
+  void execute(Select, Instruction const& in, Value* r, Row const&) const
+  {
+    r[in.dst] = truthy(r[in.a]) ? r[in.b] : r[in.c];
+  }
+
+  // the handler of opcode I; Return is handled by the dispatch loops
+  template <unsigned I>
+  void step(Instruction const& in, Value* r, Row const& row) const
+  {
+    if constexpr(I < opcode_count && I != opcode<Return>)
+    {
+      execute(Opcode<I>(), in, r, row);
+    }
+  }
+
+  public:
+  explicit FormulaVM(Program const& program)
+    : program(program)
+    , registers(program.registers)
+  {
+    hoist_constants(program, code, [&](Instruction const& in) {
+      registers[in.dst] = program.constants[in.a];
+    });
+  }
+
+  Value run_switch(Row const& row)
+  {
+    Value* r = registers.data();
+    for(Instruction const* pc = code.data();; ++pc)
+    {
+      switch(pc->op)
+      {
+#define FORMULA_VM_CASE(I)                                                                         \
+  case I:                                                                                          \
+    if(I == opcode<Return>)                                                                        \
+    {                                                                                              \
+      return r[pc->a];                                                                             \
+    }                                                                                              \
+    step<I>(*pc, r, row);                                                                          \
+    break;
+        FORMULA_VM_OPCODES(FORMULA_VM_CASE)
+#undef FORMULA_VM_CASE
+      }
+    }
+  }
+
+#if defined(__GNUC__)
+  Value run_threaded(Row const& row)
+  {
+#define FORMULA_VM_LABEL(I) &&op_##I,
+    static void* const handlers[] = {FORMULA_VM_OPCODES(FORMULA_VM_LABEL)};
+#undef FORMULA_VM_LABEL
+    Value* r = registers.data();
+    Instruction const* pc = code.data();
+    goto* handlers[pc->op];
+#define FORMULA_VM_HANDLER(I)                                                                      \
+  op_##I:                                                                                          \
+    if(I == opcode<Return>)                                                                        \
+    {                                                                                              \
+      return r[pc->a];                                                                             \
+    }                                                                                              \
+    step<I>(*pc, r, row);                                                                          \
+    ++pc;                                                                                          \
+    goto* handlers[pc->op];
+    FORMULA_VM_OPCODES(FORMULA_VM_HANDLER)
+#undef FORMULA_VM_HANDLER
+  }
+#endif
+
+  Value run(Row const& row)
+  {
+#if defined(__GNUC__)
+    return run_threaded(row);
+#else
+    return run_switch(row);
+#endif
+  }
+};
+
+/*
+    Evaluates a program column at a time: every register holds a column of `batch` values, and each
+    instruction runs over the whole batch in a tight loop before the next one is dispatched. Dispatch
+    is paid once per instruction per batch instead of once per instruction per row, the loops over
+    the batch have no indirect calls, and LoadColumn gathers a column with the column index known at
+    compile time. 256 rows per batch keeps the register columns of a typical formula in L1/L2.
+*/
+template <typename Row>
+class BatchFormulaVM
+{
+  static constexpr std::size_t batch = 256;
+
+  Program const& program;
+  std::vector<Instruction> code;
+  std::vector<Value> registers; // program.registers columns of batch values
+
+  Value* column(std::uint8_t r)
+  {
+    return registers.data() + std::size_t(r) * batch;
+  }
+
+  void execute(LoadColumn, Instruction const& in, Row const* rows, std::size_t n)
+  {
+    Columns<Row>::gather_table[in.a](rows, n, column(in.dst));
+  }
+
+  void execute(LoadConst, Instruction const& in, Row const*, std::size_t n)
+  {
+    std::fill_n(column(in.dst), n, program.constants[in.a]);
+  }
+
+  template <BinaryOpcode Op>
+  void execute(Op, Instruction const& in, Row const*, std::size_t n)
+  {
+    Value* d = column(in.dst);
+    Value const* a = column(in.a);
+    Value const* b = column(in.b);
+    for(std::size_t k = 0; k < n; ++k)
+    {
+      d[k] = Op::apply(a[k], b[k]);
+    }
+  }
+
+  void execute(Select, Instruction const& in, Row const*, std::size_t n)
+  {
+    Value* d = column(in.dst);
+    Value const* a = column(in.a);
+    Value const* b = column(in.b);
+    Value const* c = column(in.c);
+    for(std::size_t k = 0; k < n; ++k)
+    {
+      d[k] = truthy(a[k]) ? b[k] : c[k];
+    }
+  }
+
+  template <unsigned I>
+  void step(Instruction const& in, Row const* rows, std::size_t n)
+  {
+    if constexpr(I < opcode_count && I != opcode<Return>)
+    {
+      execute(Opcode<I>(), in, rows, n);
+    }
+  }
+
+  // at most batch rows
+  void run_batch(Row const* rows, std::size_t n, Value* out)
+  {
+    for(Instruction const* pc = code.data();; ++pc)
+    {
+      switch(pc->op)
+      {
+#define FORMULA_VM_CASE(I)                                                                         \
+  case I:                                                                                          \
+    if(I == opcode<Return>)                                                                        \
+    {                                                                                              \
+      std::copy_n(column(pc->a), n, out);                                                          \
+      return;                                                                                      \
+    }                                                                                              \
+    step<I>(*pc, rows, n);                                                                         \
+    break;
+        FORMULA_VM_OPCODES(FORMULA_VM_CASE)
+#undef FORMULA_VM_CASE
+      }
+    }
+  }
+
+  public:
+  explicit BatchFormulaVM(Program const& program)
+    : program(program)
+    , registers(program.registers * batch)
+  {
+    hoist_constants(program, code, [&](Instruction const& in) {
+      std::fill_n(column(in.dst), batch, program.constants[in.a]);
+    });
+  }
+
+  // out[i] = the value of the formula on rows[i]
+  void run(Row const* rows, std::size_t n, Value* out)
+  {
+    for(std::size_t first = 0; first < n; first += batch)
+    {
+      run_batch(rows + first, std::min(batch, n - first), out + first);
+    }
+  }
+};